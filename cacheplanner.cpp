@@ -0,0 +1,53 @@
+#include "cacheplanner.h"
+#include "vercmp.h"
+#include <QHash>
+#include <algorithm>
+
+QStringList CacheCleanupPlan::filePaths() const
+{
+    QStringList paths;
+    paths.reserve(removals.size() * 2);
+    for (const CachedPackage& pkg : removals) {
+        paths << pkg.path;
+        if (pkg.hasSignature) paths << pkg.path + ".sig";
+    }
+    return paths;
+}
+
+CacheCleanupPlan CachePlanner::plan(const QList<CachedPackage>& cache, const CacheRetentionPolicy& policy, const QSet<QString>& installedNames)
+{
+    // paccache tells candidates apart by name and arch, so an i686 and an x86_64 build each keep their own N
+    QHash<QString, QList<qsizetype>> groups;
+    for (qsizetype i = 0; i < cache.size(); ++i) {
+        groups[cache[i].name + '\n' + cache[i].arch].append(i);
+    }
+
+    CacheCleanupPlan result;
+    for (auto it = groups.begin(); it != groups.end(); ++it) {
+        QList<qsizetype>& versions = it.value();
+        std::sort(versions.begin(), versions.end(), [&cache](qsizetype a, qsizetype b){
+            return vercmp(cache[a].version, cache[b].version) > 0;
+        });
+
+        const QString& name = cache[versions.first()].name;
+        int keep = policy.keepVersions;
+        if (policy.keepUninstalled >= 0 && !installedNames.contains(name)) keep = qMin(keep, policy.keepUninstalled);
+        keep = qMax(0, keep);
+
+        for (qsizetype rank = 0; rank < versions.size(); ++rank) {
+            const CachedPackage& pkg = cache[versions[rank]];
+            if (rank < keep) {
+                ++result.keptCount;
+                continue;
+            }
+            result.removals.append(pkg);
+            result.reclaimableBytes += pkg.size + (pkg.hasSignature ? pkg.signatureSize : 0);
+        }
+    }
+
+    // Stable, readable order for the preview
+    std::sort(result.removals.begin(), result.removals.end(), [](const CachedPackage& a, const CachedPackage& b){
+        return a.fileName < b.fileName;
+    });
+    return result;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include "cachescanner.h"
+
+// How many versions of each package to keep, the way paccache counts them
+struct CacheRetentionPolicy {
+    int keepVersions = 3;       // paccache -rk N
+    int keepUninstalled = -1;   // paccache -ruk N for packages no longer installed; -1 treats them like the rest
+};
+
+struct CacheCleanupPlan {
+    QList<CachedPackage> removals;
+    qint64 reclaimableBytes = 0;    // packages and their signatures
+    int keptCount = 0;
+
+    bool isEmpty() const { return removals.isEmpty(); }
+    // Every file to delete, signatures included
+    QStringList filePaths() const;
+};
+
+namespace CachePlanner {
+    // Groups the cache by name and arch across all CacheDirs, newest version first by vercmp,
+    // and marks everything past the policy's limit for removal
+    CacheCleanupPlan plan(const QList<CachedPackage>& cache, const CacheRetentionPolicy& policy, const QSet<QString>& installedNames);
+}
@@ -0,0 +1,77 @@
+#include "cachescanner.h"
+#include <QFile>
+#include <QHash>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool CacheScanner::parseFileName(const QString& fileName, CachedPackage* package)
+{
+    qsizetype extensionStart = fileName.lastIndexOf(".pkg.tar");
+    if (extensionStart <= 0) return false;
+
+    QString extension = fileName.mid(extensionStart);
+    // Only ".pkg.tar" plus at most one compression suffix, which rules out ".sig" and ".part"
+    if (extension.count('.') > 3) return false;
+
+    // Three dashes from the right separate arch, pkgrel and pkgver; names may contain dashes themselves
+    QString base = fileName.left(extensionStart);
+    qsizetype archDash = base.lastIndexOf('-');
+    qsizetype relDash = archDash > 0 ? base.lastIndexOf('-', archDash - 1) : -1;
+    qsizetype verDash = relDash > 0 ? base.lastIndexOf('-', relDash - 1) : -1;
+    if (verDash <= 0) return false;
+
+    package->fileName = fileName;
+    package->name = base.left(verDash);
+    package->version = base.mid(verDash + 1, archDash - verDash - 1);
+    package->arch = base.mid(archDash + 1);
+    package->extension = extension;
+    return true;
+}
+
+QList<CachedPackage> CacheScanner::scan(const QStringList& cacheDirs)
+{
+    QList<CachedPackage> packages;
+
+    for (const QString& cacheDir : cacheDirs) {
+        DIR* dir = opendir(QFile::encodeName(cacheDir).constData());
+        if (!dir) continue;
+        int dirFd = dirfd(dir);
+        QString prefix = cacheDir.endsWith('/') ? cacheDir : cacheDir + "/";
+
+        qsizetype firstInDir = packages.size();
+        QHash<QString, qint64> signatures;
+
+        while (struct dirent* entry = readdir(dir)) {
+            // d_type spares a stat for subdirectories (pacman's download-* dirs); some filesystems leave it unknown
+            if (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN) continue;
+
+            struct stat st;
+            if (fstatat(dirFd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISREG(st.st_mode)) continue;
+
+            QString fileName = QFile::decodeName(entry->d_name);
+            if (fileName.endsWith(".sig")) {
+                signatures.insert(fileName.chopped(4), st.st_size);
+                continue;
+            }
+
+            CachedPackage package;
+            if (!parseFileName(fileName, &package)) continue;
+            package.path = prefix + fileName;
+            package.size = st.st_size;
+            package.modified = st.st_mtim.tv_sec;
+            packages.append(package);
+        }
+        closedir(dir);
+
+        // Signatures only ever belong to a package in the same directory
+        for (qsizetype i = firstInDir; i < packages.size(); ++i) {
+            auto it = signatures.constFind(packages[i].fileName);
+            if (it == signatures.constEnd()) continue;
+            packages[i].hasSignature = true;
+            packages[i].signatureSize = it.value();
+        }
+    }
+    return packages;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+struct CachedPackage {
+    QString path;               // absolute, for deleting
+    QString fileName;
+    QString name;
+    QString version;            // [epoch:]pkgver-pkgrel
+    QString arch;
+    QString extension;          // ".pkg.tar.zst" and friends
+    qint64 size = 0;            // bytes
+    qint64 modified = 0;        // seconds since the epoch
+    bool hasSignature = false;  // a matching .sig sits next to it
+    qint64 signatureSize = 0;
+};
+
+// Reads pacman's package caches directly: one readdir pass per CacheDir, each entry
+// stat'ed relative to the open directory, no shell or external tool involved.
+namespace CacheScanner {
+    // Splits "<name>-<pkgver>-<pkgrel>-<arch>.pkg.tar[.ext]"; false for anything else
+    // (partial downloads, signatures, stray files)
+    bool parseFileName(const QString& fileName, CachedPackage* package);
+
+    // Every package file in the given directories, in directory order; unreadable directories are skipped
+    QList<CachedPackage> scan(const QStringList& cacheDirs);
+}
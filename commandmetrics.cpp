@@ -0,0 +1,109 @@
+#include "commandmetrics.h"
+#include <QJsonArray>
+#include <QMap>
+#include <algorithm>
+
+QJsonObject CommandMetrics::toJson() const
+{
+    QJsonObject obj;
+    obj["description"] = description;
+    obj["command"] = command;
+    obj["startedAt"] = startedAt.toString(Qt::ISODateWithMs);
+    obj["headless"] = headless;
+    obj["viaHelper"] = viaHelper;
+    obj["wallMs"] = wallMs;
+    obj["firstOutputMs"] = firstOutputMs;
+    obj["authWaitMs"] = authWaitMs;
+    obj["exitCode"] = exitCode;
+    obj["capturedBytes"] = capturedBytes;
+    obj["userCpuSec"] = userCpuSec;
+    obj["systemCpuSec"] = systemCpuSec;
+    obj["maxRssKb"] = maxRssKb;
+    obj["signalLatencyUs"] = signalLatencyUs;
+    return obj;
+}
+
+CommandMetricsLog::CommandMetricsLog(int capacity)
+{
+    m_ring.resize(qMax(1, capacity));
+}
+
+void CommandMetricsLog::record(const CommandMetrics& metrics)
+{
+    m_ring[m_next] = metrics;
+    m_next = (m_next + 1) % m_ring.size();
+    if (m_count < m_ring.size()) ++m_count;
+}
+
+void CommandMetricsLog::clear()
+{
+    m_ring.fill(CommandMetrics());
+    m_next = 0;
+    m_count = 0;
+}
+
+QList<CommandMetrics> CommandMetricsLog::entries() const
+{
+    QList<CommandMetrics> result;
+    result.reserve(m_count);
+    int start = (m_next - m_count + m_ring.size()) % m_ring.size();
+    for (int i = 0; i < m_count; ++i) {
+        result.append(m_ring[(start + i) % m_ring.size()]);
+    }
+    return result;
+}
+
+// Median of the measured values only; -1 if nothing was measured
+template<typename T>
+static T median(QList<T> values)
+{
+    values.removeIf([](T v){ return v < 0; });
+    if (values.isEmpty()) return T(-1);
+    auto mid = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), mid, values.end());
+    return *mid;
+}
+
+QJsonObject CommandMetricsLog::toJson() const
+{
+    const QList<CommandMetrics> runs = entries();
+
+    QJsonArray runArray;
+    QMap<QString, QList<CommandMetrics>> grouped;
+    for (const CommandMetrics& run : runs) {
+        runArray.append(run.toJson());
+        grouped[run.description].append(run);
+    }
+
+    QJsonObject byDescription;
+    for (auto it = grouped.constBegin(); it != grouped.constEnd(); ++it) {
+        QList<qint64> wall, firstOutput, authWait, rss;
+        QList<double> cpu;
+        int failures = 0;
+        for (const CommandMetrics& run : it.value()) {
+            wall << run.wallMs;
+            firstOutput << run.firstOutputMs;
+            authWait << run.authWaitMs;
+            rss << run.maxRssKb;
+            cpu << (run.userCpuSec < 0 ? -1 : run.userCpuSec + qMax(0.0, run.systemCpuSec));
+            if (run.exitCode != 0) ++failures;
+        }
+
+        QJsonObject summary;
+        summary["count"] = it.value().size();
+        summary["failures"] = failures;
+        summary["lastWallMs"] = it.value().last().wallMs;
+        summary["medianWallMs"] = median(wall);
+        summary["maxWallMs"] = *std::max_element(wall.cbegin(), wall.cend());
+        summary["medianFirstOutputMs"] = median(firstOutput);
+        summary["medianAuthWaitMs"] = median(authWait);
+        summary["medianCpuSec"] = median(cpu);
+        summary["maxRssKb"] = *std::max_element(rss.cbegin(), rss.cend());
+        byDescription[it.key()] = summary;
+    }
+
+    QJsonObject root;
+    root["runs"] = runArray;
+    root["byDescription"] = byDescription;
+    return root;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QDateTime>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+// What one command cost. Durations are in milliseconds; -1 means "not measured"
+// (no output seen, no authentication step, or no rusage available for that path).
+struct CommandMetrics {
+    QString description;
+    QString command;
+    QDateTime startedAt;
+    bool headless = false;
+    bool viaHelper = false;
+    qint64 wallMs = -1;
+    qint64 firstOutputMs = -1;
+    qint64 authWaitMs = -1;
+    int exitCode = -1;
+    qint64 capturedBytes = 0;
+    double userCpuSec = -1;
+    double systemCpuSec = -1;
+    qint64 maxRssKb = -1;
+    qint64 signalLatencyUs = -1;
+
+    QJsonObject toJson() const;
+};
+
+// Fixed-size ring of the most recent commands; the oldest entry is overwritten first
+class CommandMetricsLog
+{
+public:
+    explicit CommandMetricsLog(int capacity = 512);
+
+    void record(const CommandMetrics& metrics);
+    void clear();
+
+    // Oldest first
+    QList<CommandMetrics> entries() const;
+    int size() const { return m_count; }
+
+    // {"runs": [...], "byDescription": {"<description>": {count, wall/cpu/rss aggregates}}}
+    QJsonObject toJson() const;
+
+private:
+    QList<CommandMetrics> m_ring;
+    int m_next = 0;
+    int m_count = 0;
+};
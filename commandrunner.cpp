@@ -1,46 +1,343 @@
 #include "commandrunner.h"
 #include "terminalwindow.h"
-#include <QFileSystemWatcher>
+#include "helpersession.h"
+#include <QSocketNotifier>
+#include <QProcess>
 #include <QFile>
 #include <QTextStream>
+#include <QTimer>
+#include <chrono>
+#include <memory>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Control records written by the wrapped shell, one per line:
+//   S <serial> <pid>           command is about to start in subshell <pid>, its process group leader
+//   A <serial>                 pkexec authentication succeeded (written by the root shell)
+//   X <serial> <exit code>     command returned
+//   R <serial> <real> <user> <sys>  bash `time` report for the command, in seconds
+//   E <serial> <epochrealtime> subshell is exiting
+// Each record is far below PIPE_BUF, so writes from the shell are atomic.
+// Captured output travels separately through the output FIFO.
+
+static int openFifo(const QString& path)
+{
+    // Held open read-write so the FIFO never reports EOF between commands
+    if (mkfifo(QFile::encodeName(path).constData(), 0600) != 0) return -1;
+    return ::open(QFile::encodeName(path).constData(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+}
+
+// Time each cancellation stage gets before the next, harsher signal
+static const int kEscalationMs = 3000;
+
+// Runs in the forked child before exec. It forks once more and stays behind as a
+// thin parent that reaps the real command with wait4(), writes the rusage to
+// reportFd and then exits the way the command did. Only async-signal-safe calls.
+static void forkForRusage(int reportFd)
+{
+    pid_t pid = fork();
+    if (pid <= 0) return;
+
+    // Cancelling signals the whole group, the command included. The reaper has to outlive
+    // the command, or a command that ignores SIGINT would run on unwatched after the first
+    // stage; only SIGKILL takes it down early, and that takes the command with it.
+    struct sigaction ignore {};
+    ignore.sa_handler = SIG_IGN;
+    sigemptyset(&ignore.sa_mask);
+    static const int cancelSignals[] = { SIGINT, SIGTERM, SIGHUP, SIGQUIT };
+    for (int sig : cancelSignals) sigaction(sig, &ignore, nullptr);
+
+    // Close what exec would have closed, QProcess's start-up pipe included, so the
+    // parent still sees the start (or the exec failure) of the grandchild
+    long maxFd = sysconf(_SC_OPEN_MAX);
+    for (int fd = 3; fd < maxFd; ++fd) {
+        if (fd == reportFd) continue;
+        int flags = fcntl(fd, F_GETFD);
+        if (flags != -1 && (flags & FD_CLOEXEC)) ::close(fd);
+    }
+
+    int status = 0;
+    struct rusage usage {};
+    while (wait4(pid, &status, 0, &usage) < 0) {
+        if (errno != EINTR) _exit(127);
+    }
+    (void)!::write(reportFd, &usage, sizeof(usage));
+
+    if (WIFSIGNALED(status)) {
+        signal(WTERMSIG(status), SIG_DFL);
+        raise(WTERMSIG(status));
+    }
+    _exit(WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+}
+
+static void drainFd(int fd, QByteArray& buffer)
+{
+    char chunk[16384];
+    for (;;) {
+        ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n > 0) {
+            buffer.append(chunk, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        break;
+    }
+}
 
 CommandRunner::CommandRunner(TerminalWindow* terminal, QObject* parent)
 : QObject(parent), m_terminal(terminal), m_isBusy(false)
 {
+    m_deadlineTimer = new QTimer(this);
+    m_deadlineTimer->setSingleShot(true);
+    connect(m_deadlineTimer, &QTimer::timeout, this, [this](){ stopTerminalJob(TimedOutExitCode); });
+
     if (m_tempDir.isValid()) {
-        m_startSignalFile = m_tempDir.filePath("uptater-start-signal");
-        m_endSignalFile = m_tempDir.filePath("uptater-end-signal");
-        m_outputFile = m_tempDir.filePath("output.txt");
-        m_exitCodeFile = m_tempDir.filePath("exitcode.txt");
+        m_controlFifo = m_tempDir.filePath("control");
+        m_outputFifo = m_tempDir.filePath("output");
+
+        m_helper = new HelperSession(m_tempDir.path(), this);
+
+        m_controlFd = openFifo(m_controlFifo);
+        m_outputFd = openFifo(m_outputFifo);
 
-        m_watcher = new QFileSystemWatcher(this);
-        m_watcher->addPath(m_tempDir.path());
-        connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &CommandRunner::onDirectoryChanged);
+        if (m_controlFd >= 0) {
+            m_controlNotifier = new QSocketNotifier(m_controlFd, QSocketNotifier::Read, this);
+            connect(m_controlNotifier, &QSocketNotifier::activated, this, &CommandRunner::onControlReadyRead);
+        }
+        if (m_outputFd >= 0) {
+            m_outputNotifier = new QSocketNotifier(m_outputFd, QSocketNotifier::Read, this);
+            connect(m_outputNotifier, &QSocketNotifier::activated, this, &CommandRunner::onOutputReadyRead);
+        }
     }
 }
 
+CommandRunner::~CommandRunner()
+{
+    if (m_controlFd >= 0) ::close(m_controlFd);
+    if (m_outputFd >= 0) ::close(m_outputFd);
+}
+
+quint64 CommandRunner::enqueue(CommandJob job)
+{
+    job.id = m_nextJobId++;
+
+    if (job.headless && !job.requiresRoot) {
+        startHeadless(job);
+        return job.id;
+    }
+
+    // Read-only shell queries skip the queue when the terminal is taken
+    if (job.readOnly && !job.requiresRoot && m_isBusy) {
+        startHeadless(job);
+        return job.id;
+    }
+
+    // Stable insert: after every queued job of equal or higher priority
+    qsizetype pos = m_queue.size();
+    while (pos > 0 && m_queue[pos - 1].priority < job.priority) --pos;
+    m_queue.insert(pos, job);
+
+    scheduleNext();
+    emit queueChanged();
+    return job.id;
+}
+
 void CommandRunner::run(const QString& command, const QString& description, bool captureOutput, bool requiresRoot, std::function<void(QString, int)> callback)
 {
-    if (m_isBusy) return;
+    CommandJob job;
+    job.command = command;
+    job.description = description;
+    job.captureOutput = captureOutput;
+    job.requiresRoot = requiresRoot;
+    job.callback = callback;
+    enqueue(job);
+}
+
+void CommandRunner::cancel(quint64 jobId)
+{
+    stopJob(jobId, CancelledExitCode);
+}
+
+void CommandRunner::cancelAll()
+{
+    // Queued work goes first so nothing new starts while the running jobs wind down
+    while (!m_queue.isEmpty()) stopJob(m_queue.first().id, CancelledExitCode);
+    for (quint64 id : m_queries.keys()) stopJob(id, CancelledExitCode);
+    if (m_isBusy) stopTerminalJob(CancelledExitCode);
+}
+
+void CommandRunner::stopJob(quint64 jobId, int exitCode)
+{
+    for (qsizetype i = 0; i < m_queue.size(); ++i) {
+        if (m_queue[i].id != jobId) continue;
+        CommandJob job = m_queue.takeAt(i);
+        emit queueChanged();
+        if (job.callback) job.callback(QString(), exitCode);
+        return;
+    }
+
+    if (m_isBusy && m_currentJob.id == jobId) {
+        stopTerminalJob(exitCode);
+        return;
+    }
+
+    QProcess* process = m_queries.value(jobId);
+    if (!process || m_queryStopCodes.value(jobId)) return;
+    m_queryStopCodes.insert(jobId, exitCode);
+
+    // The process leads its own group (see startHeadless), so the whole query tree gets the
+    // signal. The group is kept by id and the timer by the runner: whatever in it survives the
+    // leader is still signalled after QProcess has reported it finished and gone away.
+    pid_t group = static_cast<pid_t>(process->processId());
+    if (group <= 0) return;
+    QTimer* timer = startEscalation(this, [group](int sig){ ::kill(-group, sig); });
+    connect(timer, &QTimer::timeout, timer, [timer, group](){
+        if (timer->isActive() && !(::kill(-group, 0) != 0 && errno == ESRCH)) return;
+        timer->stop();
+        timer->deleteLater();
+    });
+}
+
+void CommandRunner::stopTerminalJob(int exitCode)
+{
+    if (!m_isBusy || m_stopCode) return;
+    m_stopCode = exitCode;
+    m_deadlineTimer->stop();
+
+    // A job that ignores even SIGKILL's aftermath (no end record) must not hold the terminal forever
+    m_escalationTimer = startEscalation(this, [this](int sig){ signalTerminalJob(sig); }, [this](){
+        if (m_isBusy) finishCommand();
+    });
+}
+
+void CommandRunner::signalTerminalJob(int sig)
+{
+    // Ctrl+C through the pty reaches the foreground group whoever owns it, pkexec'd root processes included
+    if (sig == SIGINT) {
+        m_terminal->sendInterrupt();
+        return;
+    }
+    if (m_terminalPid <= 0) return;
+
+    // Only signal the group if the subshell really leads one; otherwise it is the interactive shell's
+    pid_t target = getpgid(m_terminalPid) == m_terminalPid ? -m_terminalPid : m_terminalPid;
+    ::kill(target, sig);
+}
+
+QTimer* CommandRunner::startEscalation(QObject* owner, std::function<void(int)> sendSignal, std::function<void()> afterKill)
+{
+    auto *timer = new QTimer(owner);
+    auto stage = std::make_shared<int>(0);
+
+    auto step = [timer, stage, sendSignal, afterKill](){
+        static const int stages[] = { SIGINT, SIGTERM, SIGKILL };
+        if (*stage < 3) {
+            sendSignal(stages[(*stage)++]);
+            return;
+        }
+        timer->stop();
+        if (afterKill) afterKill();
+    };
+
+    connect(timer, &QTimer::timeout, owner, step);
+    timer->start(kEscalationMs);
+    step();
+    return timer;
+}
+
+QStringList CommandRunner::queuedDescriptions() const
+{
+    QStringList descriptions;
+    for (const CommandJob& job : m_queue) descriptions << job.description;
+    return descriptions;
+}
+
+void CommandRunner::scheduleNext()
+{
+    if (m_isBusy || m_queue.isEmpty()) return;
+
+    // The first helper-eligible root job of a session starts the helper ahead of itself
+    const CommandJob& next = m_queue.first();
+    if (next.requiresRoot && next.allowHelper && m_helper && m_helper->state() == HelperSession::State::Stopped) {
+        m_launchingHelper = true;
+        startTerminalJob(helperLaunchJob(next.id));
+        return;
+    }
+
+    startTerminalJob(m_queue.takeFirst());
+}
+
+CommandJob CommandRunner::helperLaunchJob(quint64 waitingJobId)
+{
+    CommandJob job;
+    job.command = m_helper->launchCommand();
+    job.description = "Authenticating for this session...";
+    job.callback = [this, waitingJobId](QString, int exitCode){
+        if (exitCode == 0 && m_helper->attach()) return;
+
+        // pkexec reports a dismissed or failed authentication as 126/127: the job that asked for the
+        // helper is cancelled, as it is when the prompt itself was cancelled or timed out. Looked up
+        // by id, since higher-priority work may have been queued ahead of it meanwhile, or it may
+        // already have been cancelled.
+        if (exitCode == 126 || exitCode == 127 || exitCode == CancelledExitCode || exitCode == TimedOutExitCode) {
+            stopJob(waitingJobId, exitCode);
+            return;
+        }
+
+        // Anything else means the helper can't run here; fall back to one pkexec per command
+        m_helper->markUnavailable();
+    };
+    return job;
+}
 
+void CommandRunner::startTerminalJob(const CommandJob& job)
+{
+    m_currentJob = job;
+    if (!m_currentJob.id) m_currentJob.id = m_nextJobId++;
     m_isBusy = true;
-    m_callback = callback;
+    m_exitCode = 1;
+    m_stopCode = 0;
+    m_terminalPid = 0;
+    ++m_serial;
+
+    m_outputBuffer.clear();
+    m_capturedOutput.clear();
+
+    bool viaHelper = job.requiresRoot && job.allowHelper && m_helper && m_helper->isReady();
 
-    QFile::remove(m_startSignalFile);
-    QFile::remove(m_endSignalFile);
-    QFile::remove(m_outputFile);
-    QFile::remove(m_exitCodeFile);
+    m_currentMetrics = CommandMetrics();
+    m_currentMetrics.description = job.description;
+    m_currentMetrics.command = job.command;
+    m_currentMetrics.startedAt = QDateTime::currentDateTime();
+    m_currentMetrics.viaHelper = viaHelper;
+    m_startRecordMs = -1;
+    m_jobTimer.start();
+
+    if (job.timeoutMs > 0) m_deadlineTimer->start(job.timeoutMs);
 
     emit commandStarted();
 
     QString historyBlock = !m_keepBashHistory ? " set +o history; export HISTFILE=/dev/null; " : "";
 
-    QString finalCmd = command;
-    if (requiresRoot) {
-        if (finalCmd.startsWith("sudo ")) {
-            finalCmd = finalCmd.mid(5);
-        }
-        QString escapedCmd = historyBlock + finalCmd;
+    QString finalCmd = job.command;
+    if (job.requiresRoot && finalCmd.startsWith("sudo ")) {
+        finalCmd = finalCmd.mid(5);
+    }
+
+    if (viaHelper) {
+        finalCmd = m_helper->environmentPrefix() + " " + finalCmd;
+    }
+    else if (job.requiresRoot) {
+        // The first thing the root shell does marks the end of the authentication wait
+        QString authRecord = QString("printf 'A %1\\n' > \"%2\"; ").arg(m_serial).arg(m_controlFifo);
+        // uptater-op runs operations itself when there is no helper to forward them to
+        QString pathPrefix = m_helper ? m_helper->pathPrefix() + " " : QString();
+        QString escapedCmd = authRecord + historyBlock + pathPrefix + finalCmd;
         escapedCmd.replace("'", "'\\''");
         finalCmd = "pkexec sh -c '" + escapedCmd + "'";
     }
@@ -52,59 +349,282 @@ void CommandRunner::run(const QString& command, const QString& description, bool
 
     out << "set +H; " << historyBlock << "(";
     out << " export LC_ALL=C;";
-    out << " trap 'touch \"" << m_endSignalFile << "\"' EXIT;";
+    out << " TIMEFORMAT='R " << m_serial << " %3R %3U %3S';";
+    out << " trap 'printf \"E " << m_serial << " %s\\n\" \"$EPOCHREALTIME\" > \"" << m_controlFifo << "\"' EXIT;";
 
-    QString escapedDesc = description;
+    QString escapedDesc = job.description;
     escapedDesc.replace("\"", "\\\"");
     out << " echo -e \"\\n\\033[1;36m>>> " << escapedDesc << "\\033[0m\";";
-    out << " touch \"" << m_startSignalFile << "\";";
+    out << " printf 'S " << m_serial << " %d\\n' $BASHPID > \"" << m_controlFifo << "\";";
 
-    if (captureOutput) {
-        out << " { " << finalCmd << " 2>&1 | tee \"" << m_outputFile << "\"; } ; echo ${PIPESTATUS[0]} > \"" << m_exitCodeFile << "\";";
+    // `time` reports to the outer group's stderr (the control FIFO); the command's own stderr goes to fd 3, the terminal
+    out << " { time {";
+    if (job.captureOutput) {
+        out << " { " << finalCmd << " 2>&1 | tee \"" << m_outputFifo << "\"; } ; printf 'X " << m_serial << " %d\\n' ${PIPESTATUS[0]} > \"" << m_controlFifo << "\";";
     } else {
-        out << " { " << finalCmd << "; } ; echo $? > \"" << m_exitCodeFile << "\";";
+        out << " { " << finalCmd << "; } ; printf 'X " << m_serial << " %d\\n' $? > \"" << m_controlFifo << "\";";
     }
+    out << " } 2>&3; } 3>&2 2> \"" << m_controlFifo << "\";";
 
     out << " )";
 
     m_terminal->runCommand(compositeCmd);
 }
 
-void CommandRunner::onDirectoryChanged(const QString& /*path*/)
+void CommandRunner::startHeadless(const CommandJob& job)
 {
-    if (QFile::exists(m_startSignalFile)) {
-        QFile::remove(m_startSignalFile);
-        emit terminalReady();
+    auto *process = new QProcess(this);
+    auto buffer = std::make_shared<QByteArray>();
+    auto captured = std::make_shared<QString>();
+    auto metrics = std::make_shared<CommandMetrics>();
+    auto timer = std::make_shared<QElapsedTimer>();
+
+    metrics->description = job.description;
+    metrics->command = job.command;
+    metrics->headless = true;
+
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert("LC_ALL", "C");
+    for (const QString& entry : job.environment) env.insert(entry.section('=', 0, 0), entry.section('=', 1));
+    process->setProcessEnvironment(env);
+    process->setProcessChannelMode(QProcess::MergedChannels);
+
+    // rusage comes back over this pipe from the reaper left behind by forkForRusage()
+    int rusagePipe[2] = { -1, -1 };
+    if (pipe2(rusagePipe, O_CLOEXEC | O_NONBLOCK) == 0) {
+        int reportFd = rusagePipe[1];
+        process->setChildProcessModifier([reportFd](){
+            // Own process group, so cancelling reaches everything the query started
+            setpgid(0, 0);
+            forkForRusage(reportFd);
+        });
+    }
+    else {
+        process->setChildProcessModifier([](){ setpgid(0, 0); });
     }
-    else if (QFile::exists(m_endSignalFile)) {
-        QFile::remove(m_endSignalFile);
+    int rusageFd = rusagePipe[0];
 
-        QString output;
-        if (QFile::exists(m_outputFile)) {
-            QFile file(m_outputFile);
-            if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                output = QTextStream(&file).readAll();
-            }
+    auto deliver = [job, captured](const QByteArray& line){
+        QString text = QString::fromUtf8(line.endsWith('\r') ? line.chopped(1) : line);
+        if (job.captureOutput && !job.lineCallback) {
+            *captured += text;
+            *captured += '\n';
         }
+        if (job.lineCallback) job.lineCallback(text);
+    };
+
+    auto readChunk = [process, buffer, metrics, timer](){
+        QByteArray chunk = process->readAllStandardOutput();
+        if (chunk.isEmpty()) return;
+        if (metrics->firstOutputMs < 0) metrics->firstOutputMs = timer->elapsed();
+        metrics->capturedBytes += chunk.size();
+        buffer->append(chunk);
+    };
 
-        int exitCode = 1;
-        if (QFile::exists(m_exitCodeFile)) {
-            QFile file(m_exitCodeFile);
-            if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                QString codeStr = QTextStream(&file).readAll().trimmed();
-                if (!codeStr.isEmpty()) exitCode = codeStr.toInt();
+    connect(process, &QProcess::readyReadStandardOutput, this, [buffer, deliver, readChunk](){
+        readChunk();
+        qsizetype lineStart = 0;
+        qsizetype newline;
+        while ((newline = buffer->indexOf('\n', lineStart)) != -1) {
+            deliver(buffer->mid(lineStart, newline - lineStart));
+            lineStart = newline + 1;
+        }
+        buffer->remove(0, lineStart);
+    });
+
+    auto finish = [this, process, buffer, captured, deliver, readChunk, job, metrics, timer, rusageFd](int exitCode){
+        // Stopped queries report why they stopped, unless they managed to succeed anyway
+        int stopCode = m_queryStopCodes.take(job.id);
+        if (stopCode && exitCode != 0) exitCode = stopCode;
+        m_queries.remove(job.id);
+
+        readChunk();
+        for (const QByteArray& line : buffer->split('\n')) {
+            if (!line.isEmpty()) deliver(line);
+        }
+        buffer->clear();
+
+        metrics->wallMs = timer->elapsed();
+        metrics->exitCode = exitCode;
+        if (rusageFd >= 0) {
+            struct rusage usage {};
+            if (::read(rusageFd, &usage, sizeof(usage)) == static_cast<ssize_t>(sizeof(usage))) {
+                metrics->userCpuSec = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+                metrics->systemCpuSec = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+                metrics->maxRssKb = usage.ru_maxrss;
             }
+            ::close(rusageFd);
         }
+        recordMetrics(*metrics);
+
+        process->deleteLater();
+        --m_activeQueries;
+        emit queueChanged();
+
+        if (job.callback) job.callback(*captured, exitCode);
+    };
+
+    connect(process, &QProcess::finished, this, [finish](int exitCode, QProcess::ExitStatus status){
+        finish(status == QProcess::NormalExit ? exitCode : 1);
+    });
+    connect(process, &QProcess::errorOccurred, this, [finish](QProcess::ProcessError error){
+        if (error == QProcess::FailedToStart) finish(127);
+    });
+
+    m_queries.insert(job.id, process);
+    if (job.timeoutMs > 0) {
+        QTimer::singleShot(job.timeoutMs, process, [this, id = job.id](){ stopJob(id, TimedOutExitCode); });
+    }
 
-        m_isBusy = false;
+    ++m_activeQueries;
+    emit queueChanged();
 
-        auto cb = m_callback;
-        m_callback = nullptr;
+    metrics->startedAt = QDateTime::currentDateTime();
+    timer->start();
 
-        emit commandFinished();
+    // Shell-string queries that overflowed the busy terminal still need sh; true headless jobs do not
+    if (job.program.isEmpty()) process->start("sh", {"-c", job.command});
+    else process->start(job.program, job.arguments);
+
+    if (rusagePipe[1] >= 0) ::close(rusagePipe[1]);
+}
+
+void CommandRunner::onControlReadyRead()
+{
+    drainFd(m_controlFd, m_controlBuffer);
+
+    qsizetype newline;
+    while ((newline = m_controlBuffer.indexOf('\n')) != -1) {
+        QByteArray record = m_controlBuffer.left(newline);
+        m_controlBuffer.remove(0, newline + 1);
+        handleControlRecord(record);
+    }
+}
+
+void CommandRunner::onOutputReadyRead()
+{
+    drainFd(m_outputFd, m_outputBuffer);
 
-        if (cb) {
-            cb(output, exitCode);
+    // Only the unterminated tail is kept, so memory is bounded by the longest line
+    qsizetype lineStart = 0;
+    qsizetype newline;
+    while ((newline = m_outputBuffer.indexOf('\n', lineStart)) != -1) {
+        flushOutputLine(m_outputBuffer.mid(lineStart, newline - lineStart));
+        lineStart = newline + 1;
+    }
+    m_outputBuffer.remove(0, lineStart);
+}
+
+void CommandRunner::flushOutputLine(const QByteArray& line)
+{
+    if (!m_isBusy) return;
+
+    if (m_currentMetrics.firstOutputMs < 0) m_currentMetrics.firstOutputMs = m_jobTimer.elapsed();
+    m_currentMetrics.capturedBytes += line.size() + 1;
+
+    QString text = QString::fromUtf8(line.endsWith('\r') ? line.chopped(1) : line);
+    if (m_currentJob.captureOutput && !m_currentJob.lineCallback) {
+        m_capturedOutput += text;
+        m_capturedOutput += '\n';
+    }
+    if (m_currentJob.lineCallback) m_currentJob.lineCallback(text);
+}
+
+void CommandRunner::handleControlRecord(const QByteArray& record)
+{
+    const QList<QByteArray> fields = record.split(' ');
+    if (fields.size() < 2) return;
+
+    // Records from an earlier, abandoned command are ignored
+    if (fields[1].toULongLong() != m_serial || !m_isBusy) return;
+
+    const QByteArray& type = fields[0];
+    if (type == "S") {
+        if (fields.size() >= 3) m_terminalPid = static_cast<pid_t>(fields[2].toLongLong());
+        m_startRecordMs = m_jobTimer.elapsed();
+        emit terminalReady();
+    }
+    else if (type == "A") {
+        if (m_startRecordMs >= 0) m_currentMetrics.authWaitMs = m_jobTimer.elapsed() - m_startRecordMs;
+    }
+    else if (type == "X" && fields.size() >= 3) {
+        bool ok = false;
+        int code = fields[2].toInt(&ok);
+        if (ok) m_exitCode = code;
+
+        // Launching the helper is one pkexec prompt from start to finish
+        if (m_launchingHelper && m_startRecordMs >= 0) m_currentMetrics.authWaitMs = m_jobTimer.elapsed() - m_startRecordMs;
+
+        // tee has exited by now, so everything it wrote is already in the pipe
+        drainOutput();
+    }
+    else if (type == "E") {
+        if (fields.size() >= 3) {
+            const QList<QByteArray> parts = fields[2].split('.');
+            if (parts.size() == 2) {
+                qint64 sentUs = parts[0].toLongLong() * 1000000 + parts[1].toLongLong();
+                qint64 nowUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+                m_lastSignalLatencyUs = nowUs - sentUs;
+            }
         }
+        drainOutput();
+        finishCommand();
     }
+    else if (type == "R" && fields.size() >= 5) {
+        // Covers the shell and everything it waited for; for helper jobs that is only the shim clients
+        m_currentMetrics.userCpuSec = fields[3].toDouble();
+        m_currentMetrics.systemCpuSec = fields[4].toDouble();
+    }
+}
+
+void CommandRunner::drainOutput()
+{
+    if (m_outputFd >= 0) onOutputReadyRead();
+    if (!m_outputBuffer.isEmpty()) {
+        flushOutputLine(m_outputBuffer);
+        m_outputBuffer.clear();
+    }
+}
+
+void CommandRunner::finishCommand()
+{
+    QString output = m_capturedOutput;
+    m_capturedOutput.clear();
+
+    int exitCode = m_exitCode;
+    if (m_stopCode && exitCode != 0) exitCode = m_stopCode;
+    m_isBusy = false;
+    m_launchingHelper = false;
+    m_terminalPid = 0;
+    m_stopCode = 0;
+    m_deadlineTimer->stop();
+    if (m_escalationTimer) {
+        m_escalationTimer->stop();
+        m_escalationTimer->deleteLater();
+        m_escalationTimer = nullptr;
+    }
+
+    m_currentMetrics.wallMs = m_jobTimer.elapsed();
+    m_currentMetrics.exitCode = exitCode;
+    m_currentMetrics.signalLatencyUs = m_lastSignalLatencyUs;
+    recordMetrics(m_currentMetrics);
+
+    auto cb = m_currentJob.callback;
+    m_currentJob = CommandJob();
+
+    emit commandFinished();
+
+    if (cb) {
+        cb(output, exitCode);
+    }
+
+    // A chained step started from the callback already holds the terminal
+    scheduleNext();
+    emit queueChanged();
+}
+
+void CommandRunner::recordMetrics(const CommandMetrics& metrics)
+{
+    m_metrics.record(metrics);
+    emit metricsRecorded();
 }
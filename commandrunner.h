@@ -2,41 +2,141 @@
 
 #include <QObject>
 #include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QByteArray>
 #include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <sys/types.h>
 #include <functional>
+#include "commandmetrics.h"
 
 class TerminalWindow;
-class QFileSystemWatcher;
+class HelperSession;
+class QSocketNotifier;
+class QTimer;
+class QProcess;
+
+struct CommandJob {
+    enum Priority { Low = 0, Normal = 1, High = 2 };
+
+    QString command;
+    // Headless jobs run program/arguments directly on a QProcess: no shell, no pty, output kept in memory
+    bool headless = false;
+    QString program;
+    QStringList arguments;
+    // Extra "NAME=value" entries for the headless process environment
+    QStringList environment;
+    QString description;
+    bool captureOutput = false;
+    bool requiresRoot = false;
+    // Non-mutating user queries may run on their own process while the terminal is busy
+    bool readOnly = false;
+    // Root jobs whose root work is all uptater-op operations can go through the session's privileged helper
+    bool allowHelper = true;
+    int priority = Normal;
+    // Cancelled with CommandRunner::TimedOutExitCode once this long after starting; 0 means no deadline
+    int timeoutMs = 0;
+    // Assigned by CommandRunner::enqueue()
+    quint64 id = 0;
+    std::function<void(const QString&)> lineCallback;
+    std::function<void(QString, int)> callback;
+};
 
 class CommandRunner : public QObject
 {
     Q_OBJECT
 
 public:
+    // Exit codes reported to callbacks of jobs that were stopped rather than finished
+    static constexpr int CancelledExitCode = 130;
+    static constexpr int TimedOutExitCode = 124;
+
     explicit CommandRunner(TerminalWindow* terminal, QObject* parent = nullptr);
-    ~CommandRunner() = default;
+    ~CommandRunner();
+
+    // Terminal jobs run one at a time in priority order; a busy runner queues instead of dropping.
+    // Returns the job id for cancel().
+    quint64 enqueue(CommandJob job);
 
     void run(const QString& command, const QString& description, bool captureOutput, bool requiresRoot, std::function<void(QString, int)> callback = nullptr);
+
+    // Queued jobs are dropped; running ones get SIGINT, then SIGTERM, then SIGKILL on their
+    // process group until they exit. Either way the callback sees CancelledExitCode.
+    void cancel(quint64 jobId);
+    void cancelAll();
+
     bool isBusy() const { return m_isBusy; }
+    int queuedCount() const { return m_queue.size(); }
+    int activeQueryCount() const { return m_activeQueries; }
+    QStringList queuedDescriptions() const;
     void setKeepBashHistory(bool keep) { m_keepBashHistory = keep; }
 
+    // Microseconds between the shell writing the end record and the runner receiving it
+    qint64 lastSignalLatencyUs() const { return m_lastSignalLatencyUs; }
+
+    // Timing and resource usage of recently finished commands, terminal and headless alike
+    const CommandMetricsLog& metrics() const { return m_metrics; }
+
 signals:
     void commandStarted();
     void terminalReady();
     void commandFinished();
+    void queueChanged();
+    void metricsRecorded();
 
 private slots:
-    void onDirectoryChanged(const QString& path);
+    void onControlReadyRead();
+    void onOutputReadyRead();
 
 private:
+    void scheduleNext();
+    CommandJob helperLaunchJob(quint64 waitingJobId);
+    void startTerminalJob(const CommandJob& job);
+    void startHeadless(const CommandJob& job);
+    void handleControlRecord(const QByteArray& record);
+    void flushOutputLine(const QByteArray& line);
+    void drainOutput();
+    void finishCommand();
+    void recordMetrics(const CommandMetrics& metrics);
+    void stopJob(quint64 jobId, int exitCode);
+    void stopTerminalJob(int exitCode);
+    void signalTerminalJob(int sig);
+    QTimer* startEscalation(QObject* owner, std::function<void(int)> sendSignal, std::function<void()> afterKill = nullptr);
+
     TerminalWindow* m_terminal;
     QTemporaryDir m_tempDir;
-    QString m_startSignalFile;
-    QString m_endSignalFile;
-    QString m_outputFile;
-    QString m_exitCodeFile;
-    QFileSystemWatcher* m_watcher;
+    HelperSession* m_helper = nullptr;
+    QString m_controlFifo;
+    QString m_outputFifo;
+    int m_controlFd = -1;
+    int m_outputFd = -1;
+    QSocketNotifier* m_controlNotifier = nullptr;
+    QSocketNotifier* m_outputNotifier = nullptr;
+    QByteArray m_controlBuffer;
+    QByteArray m_outputBuffer;
+    QString m_capturedOutput;
+    quint64 m_serial = 0;
+    int m_exitCode = 1;
+    int m_activeQueries = 0;
+    qint64 m_lastSignalLatencyUs = -1;
     bool m_keepBashHistory = false;
     bool m_isBusy;
-    std::function<void(QString, int)> m_callback;
+    bool m_launchingHelper = false;
+    quint64 m_nextJobId = 1;
+    // Terminal job: the subshell that leads its process group, and how it is being stopped
+    pid_t m_terminalPid = 0;
+    int m_stopCode = 0;
+    QTimer* m_deadlineTimer = nullptr;
+    QTimer* m_escalationTimer = nullptr;
+    // Headless jobs still running, by id, with the code they were stopped with (0 if not)
+    QHash<quint64, QProcess*> m_queries;
+    QHash<quint64, int> m_queryStopCodes;
+    CommandJob m_currentJob;
+    CommandMetrics m_currentMetrics;
+    CommandMetricsLog m_metrics;
+    QElapsedTimer m_jobTimer;
+    qint64 m_startRecordMs = -1;
+    QList<CommandJob> m_queue;
 };
@@ -0,0 +1,101 @@
+#include "criticalrules.h"
+#include "localdatabase.h"
+#include "dependencygraph.h"
+#include <QRegularExpression>
+
+std::shared_ptr<CriticalSet> CriticalSet::compile(const QStringList& rules, const LocalDatabase& db,
+                                                  std::shared_ptr<const DependencyGraph> graph)
+{
+    auto set = std::make_shared<CriticalSet>();
+    const int count = graph->nodeCount();
+    QBitArray include(count), exclude(count), pattern(count);
+
+    for (const QString& line : rules) {
+        QString rule = line.trimmed();
+        if (rule.isEmpty() || rule.startsWith('#')) continue;
+        if (rule.startsWith('!')) match(rule.mid(1).trimmed(), db, *graph, &exclude, nullptr);
+        else match(rule, db, *graph, &include, &pattern);
+    }
+
+    set->m_bits = include & ~exclude;
+    set->m_byPattern = pattern;
+    set->m_graph = std::move(graph);
+    return set;
+}
+
+void CriticalSet::match(const QString& rule, const LocalDatabase& db, const DependencyGraph& graph, QBitArray* bits, QBitArray* pattern)
+{
+    const QList<LocalPackage>& packages = db.packages();
+    auto mark = [bits, pattern](int node, bool exact) {
+        bits->setBit(node);
+        if (pattern && !exact) pattern->setBit(node);
+    };
+
+    if (rule.startsWith("group:")) {
+        QString group = rule.mid(6);
+        for (int i = 0; i < packages.size(); ++i) {
+            if (packages[i].groups.contains(group)) mark(i, false);
+        }
+    } else if (rule.startsWith("repo:")) {
+        QString repo = rule.mid(5);
+        bool foreign = repo == "foreign" || repo == "aur" || repo == "local";
+        for (int i = 0; i < packages.size(); ++i) {
+            if (foreign ? packages[i].isForeign() : packages[i].repo == repo) mark(i, false);
+        }
+    } else if (rule.startsWith("deps:")) {
+        // Breadth-first over hard dependencies; each package is queued once
+        int root = graph.indexOf(rule.mid(5));
+        if (root == -1) return;
+        QBitArray seen(graph.nodeCount());
+        QList<int> queue{ root };
+        seen.setBit(root);
+        for (qsizetype i = 0; i < queue.size(); ++i) {
+            mark(queue[i], false);
+            for (int dep : graph.dependencies(queue[i])) {
+                if (seen.testBit(dep)) continue;
+                seen.setBit(dep);
+                queue.append(dep);
+            }
+        }
+    } else if (rule.contains('*') || rule.contains('?') || rule.contains('[')) {
+        QRegularExpression glob(QRegularExpression::wildcardToRegularExpression(rule));
+        for (int node = 0; node < graph.nodeCount(); ++node) {
+            if (glob.match(graph.name(node)).hasMatch()) mark(node, false);
+        }
+    } else {
+        int node = graph.indexOf(rule);
+        if (node != -1) mark(node, true);
+    }
+}
+
+bool CriticalSet::contains(const QString& name) const
+{
+    int node = m_graph->indexOf(name);
+    return node != -1 && m_bits.testBit(node);
+}
+
+QBitArray CriticalSet::maskOf(const QStringList& names) const
+{
+    QBitArray mask(m_bits.size());
+    for (const QString& name : names) {
+        int node = m_graph->indexOf(name);
+        if (node != -1) mask.setBit(node);
+    }
+    return mask;
+}
+
+QStringList CriticalSet::toggled(const QStringList& rules, const QString& name, bool critical) const
+{
+    int node = m_graph->indexOf(name);
+    bool caught = node != -1 && m_byPattern.testBit(node);
+
+    QStringList result = rules;
+    if (critical) {
+        result.removeAll("!" + name);
+        if (!caught && !result.contains(name)) result.append(name);
+    } else {
+        result.removeAll(name);
+        if (caught && !result.contains("!" + name)) result.append("!" + name);
+    }
+    return result;
+}
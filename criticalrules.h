@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QBitArray>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+class LocalDatabase;
+class DependencyGraph;
+
+// The critical-package rules compiled against one local database: a bit per installed package,
+// in the database's (and dependency graph's) order. Each rule is one of
+//   name              that package
+//   linux*, nvidia-?  shell-style globs over names
+//   group:base-devel  members of a package group
+//   repo:core         everything installed from a sync repo; repo:foreign for AUR and local ones
+//   deps:systemd      systemd and everything it needs through hard dependencies, transitively
+//   !rule             excludes what rule matches, whatever includes it
+// Blank lines and lines starting with '#' are skipped.
+class CriticalSet
+{
+public:
+    static std::shared_ptr<CriticalSet> compile(const QStringList& rules, const LocalDatabase& db,
+                                                std::shared_ptr<const DependencyGraph> graph);
+
+    bool contains(const QString& name) const;
+    bool containsNode(int node) const { return m_bits.testBit(node); }
+    int count() const { return int(m_bits.count(true)); }
+
+    // A bit for each of names that is installed, for a single AND against the critical bits
+    QBitArray maskOf(const QStringList& names) const;
+    int countIn(const QBitArray& mask) const { return int((mask & m_bits).count(true)); }
+
+    // rules after name was switched on or off by hand. Exact names are added or dropped, and a
+    // package a pattern, group, repo or deps rule still catches gets an exclusion instead.
+    QStringList toggled(const QStringList& rules, const QString& name, bool critical) const;
+
+private:
+    // Sets the bits of everything rule (without its '!') matches; pattern gets the non-exact matches
+    static void match(const QString& rule, const LocalDatabase& db, const DependencyGraph& graph, QBitArray* bits, QBitArray* pattern);
+
+    std::shared_ptr<const DependencyGraph> m_graph;
+    QBitArray m_bits;
+    // Included by something other than an exact name, before exclusions
+    QBitArray m_byPattern;
+};
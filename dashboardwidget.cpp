@@ -1,9 +1,11 @@
 #include "dashboardwidget.h"
+#include "packagetable.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
-#include <QTreeWidget>
-#include <QTreeWidgetItem>
+#include <QTreeView>
+#include <QScrollBar>
+#include <QItemSelectionModel>
 #include <QStackedWidget>
 #include <QFrame>
 #include <QIcon>
@@ -15,6 +17,14 @@
 #include <QDesktopServices>
 #include <QUrl>
 #include <QAction>
+#include <QLocale>
+#include <QSplitter>
+#include <QTextBrowser>
+#include <QLineEdit>
+#include <QTimer>
+#include <QSignalBlocker>
+#include <QFutureWatcher>
+#include <QtConcurrent>
 #include <algorithm>
 
 namespace Style {
@@ -60,7 +70,7 @@ void DashboardWidget::setupUi()
     m_contentStack->addWidget(m_messageLabel);
 
     setupPackageListUI();
-    m_contentStack->addWidget(m_packageList);
+    m_contentStack->addWidget(m_listPage);
 
     setupBusyPageUI();
     m_contentStack->addWidget(m_busyPage);
@@ -90,6 +100,8 @@ void DashboardWidget::setupHeaderUI(QVBoxLayout *mainLayout)
     m_filterComboBox->addItem("Orphans (Unused)", QVariant::fromValue(PackageFilter::Orphans));
     m_filterComboBox->addItem("All Installed", QVariant::fromValue(PackageFilter::All));
     m_filterComboBox->addItem("Cached Packages", QVariant::fromValue(PackageFilter::Cache));
+    m_filterComboBox->addItem("Repository Search", QVariant::fromValue(PackageFilter::Repository));
+    m_filterComboBox->addItem("File Search", QVariant::fromValue(PackageFilter::Files));
     m_filterComboBox->setVisible(false);
     m_filterComboBox->setFixedWidth(180);
 
@@ -97,74 +109,158 @@ void DashboardWidget::setupHeaderUI(QVBoxLayout *mainLayout)
         emit filterChanged(m_filterComboBox->itemData(index).value<PackageFilter>());
     });
 
+    // Each keystroke restarts the timer, so only the query typing stopped at is searched
+    m_searchEdit = new QLineEdit(this);
+    m_searchEdit->setClearButtonEnabled(true);
+    m_searchEdit->setFixedWidth(260);
+    m_searchEdit->setVisible(false);
+
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(250);
+    connect(m_searchEdit, &QLineEdit::textChanged, m_searchTimer, qOverload<>(&QTimer::start));
+    connect(m_searchEdit, &QLineEdit::returnPressed, this, [this](){
+        m_searchTimer->stop();
+        submitSearch();
+    });
+    connect(m_searchTimer, &QTimer::timeout, this, &DashboardWidget::submitSearch);
+
+    headerLayout->addWidget(m_searchEdit);
     headerLayout->addWidget(m_filterComboBox);
     mainLayout->addLayout(headerLayout);
 
     auto *statsLayout = new QHBoxLayout();
     statsLayout->setSpacing(30);
 
-    auto *l = new QVBoxLayout();
-    l->setSpacing(2);
-    auto *t = new QLabel("Last Updated:");
-    t->setStyleSheet(Style::SubHeaderFont);
-    m_lastUpdatedLabel = new QLabel("Never");
-    m_lastUpdatedLabel->setStyleSheet("color: palette(text);");
-    l->addWidget(t);
-    l->addWidget(m_lastUpdatedLabel);
-
-    statsLayout->addLayout(l);
+    auto addStat = [statsLayout](const QString& title, const QString& initial){
+        auto *l = new QVBoxLayout();
+        l->setSpacing(2);
+        auto *t = new QLabel(title);
+        t->setStyleSheet(Style::SubHeaderFont);
+        auto *value = new QLabel(initial);
+        value->setStyleSheet("color: palette(text);");
+        l->addWidget(t);
+        l->addWidget(value);
+        statsLayout->addLayout(l);
+        return value;
+    };
+
+    m_lastUpdatedLabel = addStat("Last Updated:", "Never");
+    m_fullUpgradeLabel = addStat("Last Full Upgrade:", "...");
+    m_packagesStatLabel = addStat("Packages:", "...");
+    m_installedSizeLabel = addStat("Installed Size:", "...");
+    m_orphansStatLabel = addStat("Orphans:", "...");
+    m_cacheStatLabel = addStat("Package Cache:", "...");
     statsLayout->addStretch();
     mainLayout->addLayout(statsLayout);
 }
 
 void DashboardWidget::setupPackageListUI()
 {
-    m_packageList = new QTreeWidget(this);
-    m_packageList->setColumnCount(2);
+    // Rows are drawn from the model on demand; uniform heights let the view skip measuring them
+    m_model = new PackageListModel(this);
+    m_packageList = new QTreeView(this);
+    m_packageList->setModel(m_model);
+    m_packageList->setUniformRowHeights(true);
     m_packageList->setAlternatingRowColors(true);
     m_packageList->setRootIsDecorated(false);
-    m_packageList->setStyleSheet("QTreeWidget { border: none; }");
+    m_packageList->setStyleSheet("QTreeView { border: none; }");
     m_packageList->setFocusPolicy(Qt::NoFocus);
 
     m_packageList->header()->setStretchLastSection(false);
     m_packageList->header()->setMinimumSectionSize(100);
-    m_packageList->header()->setSectionResizeMode(0, QHeaderView::Stretch);
-    m_packageList->header()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+    m_packageList->header()->setSortIndicator(-1, Qt::AscendingOrder);
+    fitColumns();
+
+    // Header clicks flip the indicator; installed rows are re-sorted by the filter worker
+    connect(m_packageList->header(), &QHeaderView::sortIndicatorChanged, this, [this](int column, Qt::SortOrder order){
+        switch (m_model->kind()) {
+            case PackageListModel::Kind::Installed:
+            case PackageListModel::Kind::Orphans: runFilter(); break;
+            case PackageListModel::Kind::Cache:
+            case PackageListModel::Kind::Updates: m_model->sort(column, order); break;
+            default: break;
+        }
+    });
 
-    connect(m_packageList, &QTreeWidget::itemDoubleClicked, this, [this](QTreeWidgetItem *item, int){
-        if (!item || item->data(0, Qt::UserRole + 1).toInt() == 3) return; // Origin 3 = Cache
+    connect(m_packageList, &QTreeView::doubleClicked, this, [this](const QModelIndex& index){
+        int origin = index.data(PackageListModel::OriginRole).toInt();
+        if (origin >= PackageListModel::CacheOrigin) return;
 
-        QString pkgName = item->text(0);
-        bool isCritical = item->data(0, Qt::UserRole).toBool();
-        bool newState = !isCritical;
+        // The rules change and come back compiled; the row turns bold or plain then
+        bool isCritical = index.data(PackageListModel::CriticalRole).toBool();
+        emit criticalPackageToggled(m_model->packageName(index.row()), !isCritical);
+    });
 
-        QFont font = item->font(0);
-        font.setBold(newState);
-        item->setFont(0, font);
-        item->setFont(1, font);
-        item->setData(0, Qt::UserRole, newState);
+    // Details of the selected package sit under the list, filled in asynchronously by whoever listens
+    m_detailsView = new QTextBrowser(this);
+    m_detailsView->setOpenLinks(false);
+    m_detailsView->setVisible(false);
+
+    m_listPage = new QSplitter(Qt::Vertical, this);
+    m_listPage->addWidget(m_packageList);
+    m_listPage->addWidget(m_detailsView);
+    m_listPage->setStretchFactor(0, 3);
+    m_listPage->setStretchFactor(1, 1);
+    m_listPage->setChildrenCollapsible(false);
+
+    connect(m_packageList->selectionModel(), &QItemSelectionModel::currentChanged, this, [this](const QModelIndex& index){
+        if (!index.isValid() || index.data(PackageListModel::OriginRole).toInt() == PackageListModel::CacheOrigin) {
+            m_selectedPackage.clear();
+            m_detailsView->setVisible(false);
+            return;
+        }
+        m_selectedPackage = index.data(PackageListModel::PackageRole).toString();
+        emit packageSelected(m_selectedPackage);
+
+        // Nearest first, so a held arrow key finds the next row already loaded
+        static const int PREFETCH_ROWS = 4;
+        QStringList nearby;
+        for (int distance = 1; distance <= PREFETCH_ROWS; ++distance) {
+            for (int row : { index.row() + distance, index.row() - distance }) {
+                QModelIndex near = m_model->index(row, 0);
+                if (!near.isValid() || near.data(PackageListModel::OriginRole).toInt() == PackageListModel::CacheOrigin) continue;
+                nearby << near.data(PackageListModel::PackageRole).toString();
+            }
+        }
+        if (!nearby.isEmpty()) emit packagesNearSelection(nearby);
+    });
 
-        emit criticalPackageToggled(pkgName, newState);
+    // Dependency names in the pane are links to their own details
+    connect(m_detailsView, &QTextBrowser::anchorClicked, this, [this](const QUrl& url){
+        if (url.scheme() != "pkg") {
+            QDesktopServices::openUrl(url);
+            return;
+        }
+        int row = m_model->findPackage(url.path());
+        if (row != -1) {
+            QModelIndex index = m_model->index(row, 0);
+            m_packageList->selectionModel()->setCurrentIndex(index, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+            m_packageList->scrollTo(index);
+            return;
+        }
+        m_selectedPackage = url.path();
+        emit packageSelected(m_selectedPackage);
     });
 
     m_packageList->setContextMenuPolicy(Qt::CustomContextMenu);
-    connect(m_packageList, &QTreeWidget::customContextMenuRequested, this, [this](const QPoint &pos) {
-        QTreeWidgetItem *item = m_packageList->itemAt(pos);
-        if (!item) return;
+    connect(m_packageList, &QTreeView::customContextMenuRequested, this, [this](const QPoint &pos) {
+        QModelIndex index = m_packageList->indexAt(pos);
+        if (!index.isValid()) return;
 
-        QString pkgName = item->text(0);
-        int origin = item->data(0, Qt::UserRole + 1).toInt();
+        QString pkgName = index.data(PackageListModel::PackageRole).toString();
+        int origin = index.data(PackageListModel::OriginRole).toInt();
         QMenu menu(this);
 
-        if (origin == 3) {
+        if (origin == PackageListModel::CacheOrigin) {
             QAction *deleteCacheAction = menu.addAction(QIcon::fromTheme("edit-delete"), "Delete");
             if (menu.exec(m_packageList->viewport()->mapToGlobal(pos)) == deleteCacheAction) {
-                emit deleteCachedPackageRequested(pkgName);
+                emit deleteCachedPackageRequested(index.data(PackageListModel::PathRole).toString());
             }
             return;
         }
 
-        QAction *archPkgAction = (origin == 0 || origin == 2) ? menu.addAction(QIcon::fromTheme("internet-web-browser"), "Search Arch Packages") : nullptr;
+        QAction *archPkgAction = (origin == 0 || origin == 2 || origin >= 4) ? menu.addAction(QIcon::fromTheme("internet-web-browser"), "Search Arch Packages") : nullptr;
         QAction *aurAction = (origin == 1 || origin == 2) ? menu.addAction(QIcon::fromTheme("internet-web-browser"), "Search AUR") : nullptr;
         menu.addSeparator();
         QAction *wikiAction = menu.addAction(QIcon::fromTheme("help-browser"), "Search Arch Wiki");
@@ -194,8 +290,22 @@ void DashboardWidget::setupBusyPageUI()
     m_busyProgressBar->setFixedWidth(300);
     m_busyProgressBar->setTextVisible(false);
 
+    m_queueLabel = new QLabel(m_busyPage);
+    m_queueLabel->setAlignment(Qt::AlignCenter);
+    m_queueLabel->setWordWrap(true);
+    m_queueLabel->setStyleSheet(Style::BusyFont);
+    m_queueLabel->setVisible(false);
+
+    m_cancelButton = new QPushButton("Cancel", m_busyPage);
+    m_cancelButton->setCursor(Qt::PointingHandCursor);
+    m_cancelButton->setFixedWidth(100);
+    m_cancelButton->setEnabled(false);
+    connect(m_cancelButton, &QPushButton::clicked, this, &DashboardWidget::cancelRequested);
+
     busyLayout->addWidget(m_busyLabel, 0, Qt::AlignCenter);
     busyLayout->addWidget(m_busyProgressBar, 0, Qt::AlignCenter);
+    busyLayout->addWidget(m_queueLabel, 0, Qt::AlignCenter);
+    busyLayout->addWidget(m_cancelButton, 0, Qt::AlignCenter);
 }
 
 void DashboardWidget::setupRebootPageUI()
@@ -222,6 +332,19 @@ void DashboardWidget::setupRebootPageUI()
 
 // --- Helper Methods ---
 
+void DashboardWidget::setFilterBarVisible(bool visible)
+{
+    m_filterComboBox->setVisible(visible);
+    m_searchEdit->setVisible(visible && m_listFilter != PackageFilter::Cache);
+    switch (m_listFilter) {
+        case PackageFilter::Files:      m_searchEdit->setPlaceholderText("/usr/bin/ls, libssl.so or part of a path"); break;
+        case PackageFilter::Repository: m_searchEdit->setPlaceholderText("Name, description, group or provide"); break;
+        default:                        m_searchEdit->setPlaceholderText("Filter: name, /regex/, repo:extra, size:>100M"); break;
+    }
+    // Local filtering is cheap, so it can follow typing more closely than a search
+    m_searchTimer->setInterval(isSearchFilter(m_listFilter) ? 250 : 80);
+}
+
 void DashboardWidget::setHeaderState(const QString& iconName, const QString& title, const QString& color)
 {
     m_statusIconLabel->setPixmap(QIcon::fromTheme(iconName).pixmap(48, 48));
@@ -229,29 +352,6 @@ void DashboardWidget::setHeaderState(const QString& iconName, const QString& tit
     m_statusTextLabel->setStyleSheet("color: " + color + ";");
 }
 
-QTreeWidgetItem* DashboardWidget::createPackageItem(const QString& name, const QString& version, const QStringList& criticalPackages, int originFlag, bool isCache)
-{
-    auto *item = new QTreeWidgetItem(m_packageList);
-    item->setText(0, name);
-    item->setText(1, version);
-
-    if (!isCache) {
-        item->setToolTip(0, "Double-click to toggle Critical Status\nRight-click for online package info");
-    }
-
-    bool isCritical = criticalPackages.contains(name);
-    item->setData(0, Qt::UserRole, isCritical);
-    item->setData(0, Qt::UserRole + 1, originFlag);
-
-    if (isCritical && !isCache) {
-        QFont f = item->font(0);
-        f.setBold(true);
-        item->setFont(0, f);
-        item->setFont(1, f);
-    }
-    return item;
-}
-
 QString DashboardWidget::getRelativeTime(const QDateTime& dt)
 {
     if (!dt.isValid()) return "Never";
@@ -272,11 +372,41 @@ void DashboardWidget::setTimestamps(const QDateTime& lastUpdated)
     m_lastUpdatedLabel->setText(getRelativeTime(lastUpdated));
 }
 
+void DashboardWidget::setStatistics(const SystemStats& stats)
+{
+    QLocale locale;
+
+    if (stats.upgradeKnown) {
+        // Any pacman -Syu counts here, not only ours; an empty log reads as never
+        m_fullUpgradeLabel->setText(getRelativeTime(stats.lastFullUpgrade));
+        m_fullUpgradeLabel->setToolTip(stats.lastFullUpgrade.isValid() ? locale.toString(stats.lastFullUpgrade, QLocale::LongFormat) : QString());
+    }
+
+    if (stats.packagesKnown) {
+        const PackageStats& p = stats.packages;
+        m_packagesStatLabel->setText(QString("%1 (%2 explicit, %3 foreign)").arg(p.installedCount).arg(p.explicitCount).arg(p.foreignCount));
+        m_packagesStatLabel->setToolTip(QString("%1 explicitly installed\n%2 installed as dependencies\n%3 foreign (AUR or local)")
+                                            .arg(p.explicitCount).arg(p.dependencyCount).arg(p.foreignCount));
+
+        m_installedSizeLabel->setText(locale.formattedDataSize(p.installedBytes));
+        QStringList largest{ "Largest packages:" };
+        for (const auto& [name, size] : p.largest) largest.append(QString("%1  %2").arg(name, locale.formattedDataSize(size)));
+        m_installedSizeLabel->setToolTip(largest.join('\n'));
+
+        m_orphansStatLabel->setText(p.orphanCount == 0 ? QString("None")
+                                                       : QString("%1 (%2)").arg(p.orphanCount).arg(locale.formattedDataSize(p.orphanBytes)));
+    }
+
+    if (stats.cacheKnown) {
+        m_cacheStatLabel->setText(QString("%1 (%2 files)").arg(locale.formattedDataSize(stats.cache.bytes)).arg(stats.cache.files));
+    }
+}
+
 // --- UI State Methods ---
 
 void DashboardWidget::showStatusUnknown()
 {
-    m_filterComboBox->setVisible(false);
+    setFilterBarVisible(false);
     setHeaderState("dialog-information", "Status Unknown", Style::ColorGrey);
     m_messageLabel->setText("If checking for updates fails repeatedly on a good connection, your mirrorlist may be outdated.\n\nManually update it or use Reflector to refresh it in the menubar under 'Pacman'.");
     m_contentStack->setCurrentIndex(0);
@@ -284,83 +414,357 @@ void DashboardWidget::showStatusUnknown()
 
 void DashboardWidget::showUpToDate()
 {
-    m_filterComboBox->setVisible(false);
+    setFilterBarVisible(false);
     setHeaderState("security-high", "System Up to Date", Style::ColorGreen);
     m_messageLabel->setText("Your system is running the latest available packages.");
     m_contentStack->setCurrentIndex(0);
 }
 
-void DashboardWidget::showUpdatesAvailable(const QList<UpdatePackageInfo>& packages, const QStringList& criticalPackages, int criticalCount)
+void DashboardWidget::showUpdatesAvailable(const QList<UpdatePackageInfo>& packages, int criticalCount)
 {
-    m_filterComboBox->setVisible(false);
+    setFilterBarVisible(false);
 
+    qsizetype available = std::count_if(packages.cbegin(), packages.cend(), [](const UpdatePackageInfo& pkg){ return !pkg.ignored; });
     if (criticalCount > 0) {
-        setHeaderState("security-low", QString("%1 Updates (%2 Critical)").arg(packages.size()).arg(criticalCount), Style::ColorRed);
+        setHeaderState("security-low", QString("%1 Updates (%2 Critical)").arg(available).arg(criticalCount), Style::ColorRed);
     } else {
-        setHeaderState("security-medium", QString("%1 Updates Available").arg(packages.size()), Style::ColorYellow);
+        setHeaderState("security-medium", QString("%1 Updates Available").arg(available), Style::ColorYellow);
     }
 
-    m_packageList->setHeaderLabels({"Name", "Version"});
-    m_packageList->clear();
+    // A fresh update list starts critical-first; a re-shown one keeps the column it was sorted by
+    if (m_shownListing != UpdateListing) {
+        QSignalBlocker blocker(m_packageList->header());
+        m_packageList->header()->setSortIndicator(-1, Qt::AscendingOrder);
+    }
+    cancelFilter();
+    m_model->setUpdates(packages);
+    applySorting();
+    m_shownListing = UpdateListing;
+    m_listReplacePending = false;
+    m_selectedPackage.clear();
+    m_detailsView->setVisible(false);
+    fitColumns();
 
-    QList<UpdatePackageInfo> sortedPackages = packages;
-    std::sort(sortedPackages.begin(), sortedPackages.end(), [&criticalPackages](const UpdatePackageInfo& a, const UpdatePackageInfo& b) {
-        bool aCrit = criticalPackages.contains(a.name);
-        bool bCrit = criticalPackages.contains(b.name);
-        if (aCrit != bCrit) return aCrit;
-        return a.name.compare(b.name, Qt::CaseInsensitive) < 0;
-    });
+    m_contentStack->setCurrentIndex(1);
+}
 
-    for (const auto& pkg : sortedPackages) {
-        createPackageItem(pkg.name, QString("%1 -> %2").arg(pkg.oldVersion, pkg.newVersion), criticalPackages, 0, false);
+void DashboardWidget::beginInstalledList(PackageFilter currentFilter)
+{
+    // Switching between search filters swaps their queries without searching again
+    if (currentFilter != m_listFilter) {
+        m_searchQueries.insert(static_cast<int>(m_listFilter), m_searchEdit->text());
+        QSignalBlocker blocker(m_searchEdit);
+        m_searchEdit->setText(m_searchQueries.value(static_cast<int>(currentFilter)));
+        m_searchTimer->stop();
     }
+    // Another listing starts in its natural order (by name); a refresh keeps the user's column
+    if (static_cast<int>(currentFilter) != m_shownListing) {
+        QSignalBlocker blocker(m_packageList->header());
+        m_packageList->header()->setSortIndicator(0, Qt::AscendingOrder);
+    }
+    m_listFilter = currentFilter;
+    m_listHeaderPending = true;
+    // The current rows stay up until the new ones replace them
+    m_listReplacePending = true;
+    cancelFilter();
+    m_baseTable.reset();
+    m_baseRows.clear();
+}
 
-    m_contentStack->setCurrentIndex(1);
+void DashboardWidget::submitSearch()
+{
+    if (isSearchFilter(m_listFilter)) emit searchRequested(m_searchEdit->text());
+    else runFilter();
+}
+
+void DashboardWidget::cancelFilter()
+{
+    if (m_queryCancel) m_queryCancel->store(true);
+    m_queryCancel.reset();
+    m_queryRunning = false;
 }
 
-void DashboardWidget::showInstalledList(const QStringList& packages, const QStringList& criticalPackages, PackageFilter currentFilter)
+void DashboardWidget::runFilter()
 {
-    m_filterComboBox->setVisible(true);
-    int index = m_filterComboBox->findData(QVariant::fromValue(currentFilter));
-    if (index != -1) m_filterComboBox->setCurrentIndex(index);
+    // Whatever is still running was for older text or an older sort
+    cancelFilter();
+    if (!m_baseTable || m_baseRows.isEmpty()) return;
+
+    PackageQuery query = PackageQuery::parse(m_searchEdit->text());
+    m_searchEdit->setToolTip(query.error());
+    m_searchEdit->setStyleSheet(query.error().isEmpty() ? QString() : "color: " + Style::ColorRed + ";");
+    // A half-typed pattern leaves the rows alone, unless there are none of this listing yet
+    if (!query.error().isEmpty()) {
+        if (m_listReplacePending) showFilteredRows({});
+        return;
+    }
+
+    QHeaderView *header = m_packageList->header();
+    auto key = static_cast<PackageQuery::SortKey>(std::clamp(header->sortIndicatorSection(), 0, int(PackageQuery::SortKey::InstallDate)));
+    Qt::SortOrder order = header->sortIndicatorOrder();
+
+    // Rows already come in name order, so the unfiltered default needs no worker
+    if (query.isEmpty() && key == PackageQuery::SortKey::Name && order == Qt::AscendingOrder) {
+        showFilteredRows(m_baseRows);
+        return;
+    }
+
+    auto cancel = std::make_shared<std::atomic_bool>(false);
+    m_queryCancel = cancel;
+    m_queryRunning = true;
+
+    auto *watcher = new QFutureWatcher<QList<quint32>>(this);
+    connect(watcher, &QFutureWatcher<QList<quint32>>::finished, this, [this, watcher, cancel](){
+        QList<quint32> rows = watcher->result();
+        watcher->deleteLater();
+        if (cancel->load()) return;
+        m_queryCancel.reset();
+        m_queryRunning = false;
+        showFilteredRows(rows);
+    });
+    std::shared_ptr<const PackageTable> table = m_baseTable;
+    QList<quint32> rows = m_baseRows;
+    watcher->setFuture(QtConcurrent::run([table, rows, query, key, order, cancel](){
+        return query.run(*table, rows, key, order, [cancel](){ return cancel->load(); });
+    }));
+}
 
-    QString title;
-    int originFlag = 2;
-    switch(currentFilter) {
-        case PackageFilter::Official: title = "Installed Official Packages"; originFlag = 0; break;
-        case PackageFilter::Aur:      title = "Installed AUR Packages"; originFlag = 1; break;
-        case PackageFilter::Orphans:  title = "Installed Orphan Packages"; break;
-        case PackageFilter::All:      title = "All Installed Packages"; break;
-        case PackageFilter::Cache:    title = "Cached Packages"; originFlag = 3; break;
+void DashboardWidget::showFilteredRows(const QList<quint32>& rows)
+{
+    PackageListModel::Origin origin = PackageListModel::InstalledOrigin;
+    switch(m_listFilter) {
+        case PackageFilter::Official: origin = PackageListModel::OfficialOrigin; break;
+        case PackageFilter::Aur:      origin = PackageListModel::AurOrigin; break;
+        default: break;
     }
+    auto kind = m_listFilter == PackageFilter::Orphans ? PackageListModel::Kind::Orphans : PackageListModel::Kind::Installed;
 
-    setHeaderState("system-software-install", title, Style::ColorGrey);
-    m_packageList->setHeaderLabels(currentFilter == PackageFilter::Cache ? QStringList{"File", "Size"} : QStringList{"Name", "Version"});
-    m_packageList->clear();
+    replaceListing([&](){ m_model->setInstalled(kind, origin, m_baseTable, rows); });
 
-    if (packages.isEmpty()) {
-        m_messageLabel->setText("No packages found for this filter.");
+    // Only the filter can empty a listing here; one with no packages at all is finishInstalledList's case
+    if (rows.isEmpty()) {
+        m_messageLabel->setText("No installed package matches the filter.");
         m_contentStack->setCurrentIndex(0);
     } else {
-        bool isCache = (currentFilter == PackageFilter::Cache);
-        for (const auto& line : packages) {
-            QStringList parts = line.split(' ', Qt::SkipEmptyParts);
-            createPackageItem(parts.value(0), (parts.size() > 1) ? parts.value(1) : "", criticalPackages, originFlag, isCache);
+        m_contentStack->setCurrentIndex(1);
+    }
+}
+
+void DashboardWidget::applySorting()
+{
+    QHeaderView *header = m_packageList->header();
+    PackageListModel::Kind kind = m_model->kind();
+    bool sortable = kind != PackageListModel::Kind::Files && kind != PackageListModel::Kind::Repository;
+    header->setSectionsClickable(sortable);
+    header->setSortIndicatorShown(sortable);
+
+    // Installed rows come back from the filter already in order
+    if (kind == PackageListModel::Kind::Cache || kind == PackageListModel::Kind::Updates) {
+        m_model->sort(header->sortIndicatorSection(), header->sortIndicatorOrder());
+    }
+}
+
+void DashboardWidget::fitColumns()
+{
+    m_packageList->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    for (int column = 1; column < m_model->columnCount(); ++column) {
+        m_packageList->header()->setSectionResizeMode(column, QHeaderView::ResizeToContents);
+    }
+}
+
+void DashboardWidget::replaceListing(const std::function<void()>& fill)
+{
+    prepareListHeader();
+
+    // The same listing again (a refresh or a new search) keeps the selected package and the
+    // scroll offset; a different one starts at the top with nothing selected
+    bool refresh = m_shownListing == static_cast<int>(m_listFilter);
+    QString selected = m_selectedPackage;
+    int scroll = m_packageList->verticalScrollBar()->value();
+
+    fill();
+    applySorting();
+    m_listReplacePending = false;
+    m_shownListing = static_cast<int>(m_listFilter);
+    fitColumns();
+
+    int row = refresh && !selected.isEmpty() ? m_model->findPackage(selected) : -1;
+    if (row != -1) {
+        m_packageList->selectionModel()->setCurrentIndex(m_model->index(row, 0), QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+    } else {
+        m_selectedPackage.clear();
+        m_detailsView->setVisible(false);
+    }
+    if (refresh) m_packageList->verticalScrollBar()->setValue(scroll);
+    else m_packageList->scrollToTop();
+}
+
+void DashboardWidget::prepareListHeader()
+{
+    if (m_listHeaderPending) {
+        m_listHeaderPending = false;
+        setFilterBarVisible(true);
+        int index = m_filterComboBox->findData(QVariant::fromValue(m_listFilter));
+        if (index != -1) m_filterComboBox->setCurrentIndex(index);
+
+        QString title;
+        switch(m_listFilter) {
+            case PackageFilter::Official: title = "Installed Official Packages"; break;
+            case PackageFilter::Aur:      title = "Installed AUR Packages"; break;
+            case PackageFilter::Orphans:  title = "Installed Orphan Packages"; break;
+            case PackageFilter::All:      title = "All Installed Packages"; break;
+            case PackageFilter::Cache:    title = "Cached Packages"; break;
+            case PackageFilter::Files:    title = "File Owners"; break;
+            case PackageFilter::Repository: title = "Repository Packages"; break;
         }
+
+        setHeaderState("system-software-install", title, Style::ColorGrey);
         m_contentStack->setCurrentIndex(1);
     }
 }
 
+void DashboardWidget::setPackageRows(const std::shared_ptr<const PackageTable>& table, const QList<quint32>& rows)
+{
+    // Kept whole, so each keystroke filters the full listing again
+    m_baseTable = table;
+    m_baseRows = rows;
+    runFilter();
+}
+
+void DashboardWidget::setCriticalSet(std::shared_ptr<const CriticalSet> critical)
+{
+    m_model->setCriticalSet(std::move(critical));
+    // The update list's default order puts critical packages first
+    if (m_model->kind() == PackageListModel::Kind::Updates) applySorting();
+}
+
+void DashboardWidget::setCachedPackages(const QList<CachedPackage>& packages)
+{
+    replaceListing([&](){ m_model->setCachedPackages(packages); });
+}
+
+void DashboardWidget::setFileOwners(const QList<FileOwner>& owners)
+{
+    replaceListing([&](){ m_model->setFileOwners(owners); });
+}
+
+void DashboardWidget::setRepositoryPackages(const QList<PackageSearchResult>& packages)
+{
+    replaceListing([&](){ m_model->setRepositoryPackages(packages); });
+}
+
+QString DashboardWidget::searchText() const
+{
+    return m_searchEdit->text();
+}
+
+void DashboardWidget::finishInstalledList()
+{
+    // A filter run still owns the list; its result decides what is shown
+    if (m_queryRunning) return;
+
+    // Nothing came in, so empty the list here and show the empty message
+    if (m_listReplacePending) {
+        PackageListModel::Kind kind = PackageListModel::Kind::Installed;
+        switch (m_listFilter) {
+            case PackageFilter::Orphans:    kind = PackageListModel::Kind::Orphans; break;
+            case PackageFilter::Cache:      kind = PackageListModel::Kind::Cache; break;
+            case PackageFilter::Files:      kind = PackageListModel::Kind::Files; break;
+            case PackageFilter::Repository: kind = PackageListModel::Kind::Repository; break;
+            default: break;
+        }
+        replaceListing([&](){ m_model->clear(kind); });
+    }
+    if (m_model->rowCount() > 0 || !m_baseRows.isEmpty()) return;
+
+    if (isSearchFilter(m_listFilter)) {
+        bool files = m_listFilter == PackageFilter::Files;
+        if (!m_searchEdit->text().trimmed().isEmpty()) {
+            m_messageLabel->setText(files ? "No package contains a matching file." : "No package matches every search term.");
+        } else if (files) {
+            m_messageLabel->setText("Type a full path to find the package that owns it, or a file name or part of a path to search every package.\n\nRun pacman -Fy once to include packages that aren't installed.");
+        } else {
+            m_messageLabel->setText("Type to search the names, descriptions, groups and provides of every package in the sync repositories.");
+        }
+        m_contentStack->setCurrentIndex(0);
+        if (m_searchEdit->isVisible()) m_searchEdit->setFocus();
+        return;
+    }
+    m_messageLabel->setText("No packages found for this filter.");
+    m_contentStack->setCurrentIndex(0);
+}
+
+static QString packageLinks(const QStringList& names, const QString& separator = ", ")
+{
+    if (names.isEmpty()) return "None";
+    QStringList links;
+    for (const QString& name : names) {
+        QString escaped = name.toHtmlEscaped();
+        links << QString("<a href=\"pkg:%1\">%1</a>").arg(escaped);
+    }
+    return links.join(separator);
+}
+
+void DashboardWidget::showPackageDetails(const PackageDetails& details)
+{
+    // A slow read from disk can finish after a later request was answered
+    if (details.name != m_selectedPackage || details.request < m_shownDetailsRequest) return;
+    m_shownDetailsRequest = details.request;
+
+    QLocale locale;
+    QString html = QString("<b>%1</b> %2").arg(details.name.toHtmlEscaped(), details.version.toHtmlEscaped());
+    if (details.version.isEmpty()) {
+        html += "<br>Not installed.";
+        m_detailsView->setHtml(html);
+        m_detailsView->setVisible(true);
+        return;
+    }
+
+    html += "<br>" + details.description.toHtmlEscaped();
+    html += "<table cellspacing=\"4\">";
+    auto row = [&html](const QString& label, const QString& value) {
+        html += QString("<tr><td valign=\"top\"><i>%1</i></td><td>%2</td></tr>").arg(label, value);
+    };
+    // The rest arrives from disk right after; placeholders keep the rows below from jumping
+    const QString pending = "&hellip;";
+    QString url = details.url.toHtmlEscaped();
+    row("URL", !details.extrasLoaded ? pending : url.isEmpty() ? "None" : QString("<a href=\"%1\">%1</a>").arg(url));
+    row("Repository", details.repo.isEmpty() ? "foreign (AUR or local)" : details.repo.toHtmlEscaped());
+    row("Licenses", !details.extrasLoaded ? pending
+                    : details.licenses.isEmpty() ? "None" : details.licenses.join(", ").toHtmlEscaped());
+    row("Built", !details.extrasLoaded ? pending
+                 : QString("%1 by %2").arg(locale.toString(details.buildDate, QLocale::ShortFormat),
+                                           details.packager.isEmpty() ? "unknown" : details.packager.toHtmlEscaped()));
+    row("Installed", QString("%1, %2").arg(details.explicitlyInstalled ? "explicitly" : "as a dependency",
+                                           locale.toString(details.installDate, QLocale::ShortFormat)));
+    row("Size", QString("%1 (%2 with %3 dependencies)").arg(locale.formattedDataSize(details.installedSize),
+                                                           locale.formattedDataSize(details.installedSize + details.closureBytes))
+                                                       .arg(details.closureCount));
+    row("Files", details.extrasLoaded ? locale.toString(details.fileCount) : pending);
+    if (!details.explicitlyInstalled) {
+        row("Why installed", details.whyInstalled.isEmpty() ? "Nothing explicitly installed needs it" : packageLinks(details.whyInstalled, " &rarr; "));
+    }
+    row("Depends on", packageLinks(details.dependsOn));
+    if (!details.optionalDeps.isEmpty()) row("Optional", packageLinks(details.optionalDeps));
+    row("Required by", packageLinks(details.requiredBy));
+    if (!details.optionalFor.isEmpty()) row("Optional for", packageLinks(details.optionalFor));
+    if (!details.unresolved.isEmpty()) row("Unresolved", details.unresolved.join(", ").toHtmlEscaped());
+    html += "</table>";
+
+    m_detailsView->setHtml(html);
+    m_detailsView->setVisible(true);
+}
+
 void DashboardWidget::showRebootReadyState()
 {
-    m_filterComboBox->setVisible(false);
+    setFilterBarVisible(false);
     setHeaderState("system-reboot", "Ready to Install", Style::ColorGreen);
     m_contentStack->setCurrentIndex(3);
 }
 
 void DashboardWidget::showErrorState()
 {
-    m_filterComboBox->setVisible(false);
+    setFilterBarVisible(false);
     setHeaderState("dialog-error", "Operation Failed", Style::ColorRed);
     m_messageLabel->setText("If updating is failing under a good connection you may need to refresh your mirrorlist via reflector or repair the keyring under the \"Pacman\" menu.\n\nClick \"Show Terminal Output\" for detailed output.");
     m_contentStack->setCurrentIndex(0);
@@ -368,12 +772,20 @@ void DashboardWidget::showErrorState()
 
 void DashboardWidget::showOperationCancelled()
 {
-    m_filterComboBox->setVisible(false);
+    setFilterBarVisible(false);
     setHeaderState("dialog-warning", "Operation Cancelled", Style::ColorYellow);
     m_messageLabel->setText("The operation was cancelled by the user.");
     m_contentStack->setCurrentIndex(0);
 }
 
+void DashboardWidget::showOperationTimedOut()
+{
+    setFilterBarVisible(false);
+    setHeaderState("dialog-warning", "Operation Timed Out", Style::ColorYellow);
+    m_messageLabel->setText("The operation took too long and was stopped.\n\nClick \"Show Terminal Output\" for detailed output.");
+    m_contentStack->setCurrentIndex(0);
+}
+
 void DashboardWidget::showBusyState(const QString& message)
 {
     setHeaderState("view-refresh", "Working...", Style::ColorGrey);
@@ -385,3 +797,14 @@ void DashboardWidget::updateBusyMessage(const QString& message)
 {
     if (m_busyLabel) m_busyLabel->setText(message);
 }
+
+void DashboardWidget::setCancelEnabled(bool enabled)
+{
+    m_cancelButton->setEnabled(enabled);
+}
+
+void DashboardWidget::setQueuedOperations(const QStringList& descriptions)
+{
+    m_queueLabel->setVisible(!descriptions.isEmpty());
+    m_queueLabel->setText(QString("Queued (%1): %2").arg(descriptions.size()).arg(descriptions.join(", ")));
+}
@@ -2,49 +2,109 @@
 
 #include <QWidget>
 #include <QDateTime>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "packagelistmodel.h"
+#include "packagequery.h"
+#include "systemstats.h"
 
 class QLabel;
-class QTreeWidget;
-class QTreeWidgetItem;
+class QTreeView;
 class QStackedWidget;
 class QProgressBar;
 class QPushButton;
 class QComboBox;
 class QVBoxLayout;
+class QSplitter;
+class QTextBrowser;
+class QLineEdit;
+class QTimer;
+class PackageTable;
+class CriticalSet;
 
-struct UpdatePackageInfo {
+// Everything the details pane shows for one installed package
+struct PackageDetails {
+    // The PackageManager::describePackage() call this answers
+    quint64 request = 0;
     QString name;
-    QString oldVersion;
-    QString newVersion;
-    bool ignored;
+    QString version;
+    QString description;
+    QString repo;               // empty for foreign packages
+    bool explicitlyInstalled = false;
+    qint64 installedSize = 0;   // bytes
+    QDateTime installDate;
+    QStringList dependsOn;
+    QStringList optionalDeps;
+    QStringList requiredBy;
+    QStringList optionalFor;
+    QStringList whyInstalled;   // from an explicitly installed package down to this one
+    int closureCount = 0;       // packages it pulls in, transitively
+    qint64 closureBytes = 0;
+    QStringList unresolved;     // dependencies nothing installed satisfies
+    // Read from the package's files after the rest; empty until extrasLoaded
+    bool extrasLoaded = false;
+    QString url;
+    QStringList licenses;
+    QString packager;
+    QDateTime buildDate;
+    int fileCount = 0;
 };
 
 class DashboardWidget : public QWidget
 {
     Q_OBJECT
 public:
-    enum class PackageFilter { All, Official, Aur, Orphans, Cache };
+    enum class PackageFilter { All, Official, Aur, Orphans, Cache, Files, Repository };
 
     explicit DashboardWidget(QWidget *parent = nullptr);
 
     void setTimestamps(const QDateTime& lastUpdated);
+    // Fills in whichever parts of stats are known; the others keep their last value
+    void setStatistics(const SystemStats& stats);
+    // Compiled critical rules; every listing marks what they match
+    void setCriticalSet(std::shared_ptr<const CriticalSet> critical);
 
     void showStatusUnknown();
     void showUpToDate();
-    void showUpdatesAvailable(const QList<UpdatePackageInfo>& packages, const QStringList& criticalPackages, int criticalCount);
+    void showUpdatesAvailable(const QList<UpdatePackageInfo>& packages, int criticalCount);
     void showRebootReadyState();
     void showErrorState();
     void showOperationCancelled();
+    void showOperationTimedOut();
     void showBusyState(const QString& message);
     void updateBusyMessage(const QString& message);
+    void setQueuedOperations(const QStringList& descriptions);
+    void setCancelEnabled(bool enabled);
 
-    void showInstalledList(const QStringList& packages, const QStringList& criticalPackages, PackageFilter currentFilter);
+    // Listings are replaced whole: begin marks the current rows as outgoing, a set call swaps
+    // in the new ones, finish handles the empty case
+    void beginInstalledList(PackageFilter currentFilter);
+    void setPackageRows(const std::shared_ptr<const PackageTable>& table, const QList<quint32>& rows);
+    // Cache listing: one row per package file, sortable by every column
+    void setCachedPackages(const QList<CachedPackage>& packages);
+    // File search results: one row per path and owning package
+    void setFileOwners(const QList<FileOwner>& owners);
+    // Repository search results, best match first
+    void setRepositoryPackages(const QList<PackageSearchResult>& packages);
+    // The query of the current search filter (Files or Repository)
+    QString searchText() const;
+    void finishInstalledList();
+
+    // Fills the pane under the list; ignored if another package has been selected since
+    void showPackageDetails(const PackageDetails& details);
 
 signals:
     void criticalPackageToggled(const QString& packageName, bool isCritical);
     void rebootClicked();
     void filterChanged(DashboardWidget::PackageFilter filter);
-    void deleteCachedPackageRequested(const QString& fileName);
+    void deleteCachedPackageRequested(const QString& filePath);
+    void cancelRequested();
+    void packageSelected(const QString& packageName);
+    // Rows around the selection, worth loading before the arrow keys reach them
+    void packagesNearSelection(const QStringList& packageNames);
+    // The search filter's query, once typing has paused
+    void searchRequested(const QString& query);
 
 private:
     void setupUi();
@@ -53,20 +113,64 @@ private:
     void setupBusyPageUI();
     void setupRebootPageUI();
 
+    // The filter selector, plus the search box while a search filter is active
+    void setFilterBarVisible(bool visible);
+    static bool isSearchFilter(PackageFilter filter) { return filter == PackageFilter::Files || filter == PackageFilter::Repository; }
     void setHeaderState(const QString& iconName, const QString& title, const QString& color);
-    QTreeWidgetItem* createPackageItem(const QString& name, const QString& version, const QStringList& criticalPackages, int originFlag, bool isCache);
+    void prepareListHeader();
+    void fitColumns();
+    // Cache and update listings sort in the model; installed ones through runFilter
+    void applySorting();
+    // The search field's text goes to whoever searches, or filters the installed listing here
+    void submitSearch();
+    // Filters and sorts the installed listing on a worker, superseding any run still going
+    void runFilter();
+    void cancelFilter();
+    void showFilteredRows(const QList<quint32>& rows);
+    // Runs fill, which resets the model, keeping selection and scroll position if the listing is the one shown
+    void replaceListing(const std::function<void()>& fill);
     QString getRelativeTime(const QDateTime& dt);
 
     QLabel *m_statusIconLabel;
     QLabel *m_statusTextLabel;
     QLabel *m_lastUpdatedLabel;
+    QLabel *m_fullUpgradeLabel;
+    QLabel *m_packagesStatLabel;
+    QLabel *m_installedSizeLabel;
+    QLabel *m_orphansStatLabel;
+    QLabel *m_cacheStatLabel;
     QComboBox *m_filterComboBox;
+    QLineEdit *m_searchEdit;
+    QTimer *m_searchTimer;
+    // Each search filter keeps its own query while another one is shown
+    QHash<int, QString> m_searchQueries;
     QStackedWidget *m_contentStack;
     QLabel *m_messageLabel;
-    QTreeWidget *m_packageList;
+    QSplitter *m_listPage;
+    PackageListModel *m_model;
+    QTreeView *m_packageList;
+    QTextBrowser *m_detailsView;
+    QString m_selectedPackage;
+    // Request number of the details on show; older answers arriving late are dropped
+    quint64 m_shownDetailsRequest = 0;
     QWidget *m_busyPage;
     QLabel *m_busyLabel;
     QProgressBar *m_busyProgressBar;
+    QLabel *m_queueLabel;
+    QPushButton *m_cancelButton;
     QWidget *m_rebootPage;
     QPushButton *m_rebootButton;
+
+    PackageFilter m_listFilter = PackageFilter::Official;
+    bool m_listHeaderPending = false;
+    bool m_listReplacePending = false;
+    // PackageFilter the model holds, UpdateListing, or -2 before anything was shown
+    static constexpr int UpdateListing = -1;
+    int m_shownListing = -2;
+    // The installed listing as it arrived, before the filter field narrows and sorts it
+    std::shared_ptr<const PackageTable> m_baseTable;
+    QList<quint32> m_baseRows;
+    // Set to stop the filter run in flight
+    std::shared_ptr<std::atomic_bool> m_queryCancel;
+    bool m_queryRunning = false;
 };
@@ -0,0 +1,183 @@
+#include "dependencygraph.h"
+#include "localdatabase.h"
+#include "vercmp.h"
+#include <QBitArray>
+#include <algorithm>
+
+namespace {
+
+struct Provider {
+    int node;
+    QString version;    // empty for an unversioned provide
+};
+
+struct Constraint {
+    QString name;
+    QString op;         // "", "<", "<=", "=", ">=" or ">"
+    QString version;
+};
+
+Constraint parseConstraint(const QString& dependency)
+{
+    Constraint constraint;
+    auto isOperator = [](QChar c){ return c == '<' || c == '>' || c == '='; };
+
+    qsizetype opStart = 0;
+    while (opStart < dependency.size() && !isOperator(dependency[opStart])) ++opStart;
+    qsizetype opEnd = opStart;
+    while (opEnd < dependency.size() && isOperator(dependency[opEnd])) ++opEnd;
+    constraint.name = dependency.left(opStart);
+    constraint.op = dependency.mid(opStart, opEnd - opStart);
+    constraint.version = dependency.mid(opEnd);
+    return constraint;
+}
+
+// pacman's rule: an unversioned provide never satisfies a versioned dependency
+bool satisfies(const QString& provided, const Constraint& constraint)
+{
+    if (constraint.op.isEmpty()) return true;
+    if (provided.isEmpty()) return false;
+
+    int cmp = vercmp(provided, constraint.version);
+    if (constraint.op == "=") return cmp == 0;
+    if (constraint.op == ">=") return cmp >= 0;
+    if (constraint.op == "<=") return cmp <= 0;
+    if (constraint.op == ">") return cmp > 0;
+    if (constraint.op == "<") return cmp < 0;
+    return false;
+}
+
+void toCsr(const QList<QList<int>>& lists, QList<int>& offsets, QList<int>& targets)
+{
+    offsets.resize(lists.size() + 1);
+    offsets[0] = 0;
+    for (qsizetype i = 0; i < lists.size(); ++i) offsets[i + 1] = offsets[i] + lists[i].size();
+
+    targets.clear();
+    targets.reserve(offsets.last());
+    for (const QList<int>& list : lists) targets.append(list);
+}
+
+} // namespace
+
+std::shared_ptr<DependencyGraph> DependencyGraph::build(const LocalDatabase& db)
+{
+    auto graph = std::make_shared<DependencyGraph>();
+    const QList<LocalPackage>& packages = db.packages();
+    const int count = packages.size();
+
+    QHash<QString, QList<Provider>> providers;
+    graph->m_names.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const LocalPackage& pkg = packages[i];
+        graph->m_names << pkg.name;
+        graph->m_explicit << pkg.explicitlyInstalled;
+        graph->m_sizes << pkg.installedSize;
+        graph->m_index.insert(pkg.name, i);
+
+        providers[pkg.name].append({i, pkg.version});
+        for (const QString& provide : pkg.provides) {
+            Constraint provided = parseConstraint(provide);
+            providers[provided.name].append({i, provided.op == "=" ? provided.version : QString()});
+        }
+    }
+
+    // Each dependency string is resolved here, once; a version mismatch still gets its edge
+    // (the system is what it is) but a name nobody provides is reported as unresolved
+    auto resolve = [&](int node, const QStringList& dependencies, bool optional, QList<int>& out) {
+        for (const QString& dependency : dependencies) {
+            Constraint constraint = parseConstraint(dependency);
+            const QList<Provider> candidates = providers.value(constraint.name);
+            if (candidates.isEmpty()) {
+                if (!optional) graph->m_unresolved[node] << dependency;
+                continue;
+            }
+
+            bool matched = false;
+            for (const Provider& provider : candidates) {
+                if (provider.node == node || !satisfies(provider.version, constraint)) continue;
+                out.append(provider.node);
+                matched = true;
+            }
+            if (!matched) {
+                for (const Provider& provider : candidates) {
+                    if (provider.node != node) out.append(provider.node);
+                }
+            }
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    };
+
+    QList<QList<int>> depends(count), optional(count), reverse(count), reverseOptional(count);
+    for (int i = 0; i < count; ++i) {
+        resolve(i, packages[i].depends, false, depends[i]);
+        resolve(i, packages[i].optDepends, true, optional[i]);
+        for (int target : depends[i]) reverse[target].append(i);
+        for (int target : optional[i]) reverseOptional[target].append(i);
+    }
+
+    toCsr(depends, graph->m_depOffsets, graph->m_depTargets);
+    toCsr(optional, graph->m_optOffsets, graph->m_optTargets);
+    toCsr(reverse, graph->m_revOffsets, graph->m_revTargets);
+    toCsr(reverseOptional, graph->m_revOptOffsets, graph->m_revOptTargets);
+    return graph;
+}
+
+QList<int> DependencyGraph::row(const QList<int>& offsets, const QList<int>& targets, int node)
+{
+    if (node < 0 || node + 1 >= offsets.size()) return {};
+    return targets.mid(offsets[node], offsets[node + 1] - offsets[node]);
+}
+
+QList<int> DependencyGraph::whyInstalled(int node) const
+{
+    if (node < 0 || node >= nodeCount()) return {};
+    if (m_explicit[node]) return {node};
+
+    // Breadth-first up the reverse edges, so the first explicit package met is the nearest one
+    QList<int> parent(nodeCount(), -1);
+    QBitArray seen(nodeCount());
+    QList<int> queue = {node};
+    seen.setBit(node);
+
+    for (qsizetype head = 0; head < queue.size(); ++head) {
+        int current = queue[head];
+        for (int i = m_revOffsets[current]; i < m_revOffsets[current + 1]; ++i) {
+            int requirer = m_revTargets[i];
+            if (seen.testBit(requirer)) continue;
+            seen.setBit(requirer);
+            parent[requirer] = current;
+
+            if (m_explicit[requirer]) {
+                QList<int> chain;
+                for (int step = requirer; step != -1; step = parent[step]) chain.append(step);
+                return chain;
+            }
+            queue.append(requirer);
+        }
+    }
+    return {};
+}
+
+DependencyGraph::Closure DependencyGraph::closure(int node) const
+{
+    Closure result;
+    if (node < 0 || node >= nodeCount()) return result;
+
+    QBitArray seen(nodeCount());
+    QList<int> stack = {node};
+    seen.setBit(node);
+    while (!stack.isEmpty()) {
+        int current = stack.takeLast();
+        for (int i = m_depOffsets[current]; i < m_depOffsets[current + 1]; ++i) {
+            int dependency = m_depTargets[i];
+            if (seen.testBit(dependency)) continue;
+            seen.setBit(dependency);
+            ++result.count;
+            result.bytes += m_sizes[dependency];
+            stack.append(dependency);
+        }
+    }
+    return result;
+}
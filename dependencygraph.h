@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <memory>
+
+class LocalDatabase;
+
+// Installed packages and the edges between them, resolved once: every depends/optdepends
+// string is matched against names and provides (versioned constraints included) and
+// stored as node indexes in compressed sparse rows, so queries never touch strings again.
+class DependencyGraph
+{
+public:
+    // Nodes are in the database's package order, so node i is db.packages()[i]
+    static std::shared_ptr<DependencyGraph> build(const LocalDatabase& db);
+
+    int nodeCount() const { return m_names.size(); }
+    // -1 for names that aren't installed
+    int indexOf(const QString& name) const { return m_index.value(name, -1); }
+    const QString& name(int node) const { return m_names[node]; }
+
+    QList<int> dependencies(int node) const { return row(m_depOffsets, m_depTargets, node); }
+    QList<int> optionalDependencies(int node) const { return row(m_optOffsets, m_optTargets, node); }
+    QList<int> requiredBy(int node) const { return row(m_revOffsets, m_revTargets, node); }
+    QList<int> optionalFor(int node) const { return row(m_revOptOffsets, m_revOptTargets, node); }
+
+    // Shortest chain of hard dependencies from an explicitly installed package down to node,
+    // explicit package first; just node if it is explicit itself, empty if nothing explicit needs it
+    QList<int> whyInstalled(int node) const;
+
+    struct Closure {
+        int count = 0;          // packages pulled in, node itself excluded
+        qint64 bytes = 0;       // their installed size
+    };
+    // Everything node needs through hard dependencies, transitively
+    Closure closure(int node) const;
+
+    // Dependency strings no installed package satisfies, keyed by the package that has them
+    const QHash<int, QStringList>& unresolved() const { return m_unresolved; }
+
+private:
+    static QList<int> row(const QList<int>& offsets, const QList<int>& targets, int node);
+
+    QStringList m_names;
+    QList<bool> m_explicit;
+    QList<qint64> m_sizes;
+    QHash<QString, int> m_index;
+
+    // CSR: the edges of node i are targets[offsets[i] .. offsets[i + 1])
+    QList<int> m_depOffsets, m_depTargets;
+    QList<int> m_optOffsets, m_optTargets;
+    QList<int> m_revOffsets, m_revTargets;
+    QList<int> m_revOptOffsets, m_revOptTargets;
+
+    QHash<int, QStringList> m_unresolved;
+};
@@ -0,0 +1,135 @@
+#include "diagnosticsdialog.h"
+#include "commandrunner.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTabWidget>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocale>
+#include <QDir>
+#include <QFile>
+
+static QString formatMs(qint64 ms)
+{
+    if (ms < 0) return "-";
+    if (ms < 1000) return QString("%1 ms").arg(ms);
+    return QString("%1 s").arg(ms / 1000.0, 0, 'f', 2);
+}
+
+static QString formatCpu(double user, double system)
+{
+    if (user < 0) return "-";
+    return QString("%1 s").arg(user + qMax(0.0, system), 0, 'f', 2);
+}
+
+static QString formatKb(qint64 kb)
+{
+    if (kb < 0) return "-";
+    return QLocale().formattedDataSize(kb * 1024);
+}
+
+static QTableWidget* createTable(const QStringList& headers, QWidget* parent)
+{
+    auto *table = new QTableWidget(0, headers.size(), parent);
+    table->setHorizontalHeaderLabels(headers);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->verticalHeader()->setVisible(false);
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    return table;
+}
+
+DiagnosticsDialog::DiagnosticsDialog(CommandRunner* runner, QWidget *parent)
+: QDialog(parent), m_runner(runner)
+{
+    setWindowTitle("Diagnostics");
+    resize(900, 500);
+
+    auto *layout = new QVBoxLayout(this);
+    auto *tabs = new QTabWidget(this);
+
+    m_summaryTable = createTable({"Command", "Runs", "Failed", "Last", "Median", "Max", "First Output", "Auth Wait", "CPU", "Peak RSS"}, this);
+    m_runsTable = createTable({"Command", "Started", "Wall", "First Output", "Auth Wait", "Exit", "Output", "CPU", "Peak RSS", "Route"}, this);
+    tabs->addTab(m_summaryTable, "By Command");
+    tabs->addTab(m_runsTable, "Recent Runs");
+
+    auto *buttons = new QHBoxLayout();
+    auto *exportBtn = new QPushButton("Export JSON...", this);
+    auto *closeBtn = new QPushButton("Close", this);
+    connect(exportBtn, &QPushButton::clicked, this, &DiagnosticsDialog::exportJson);
+    connect(closeBtn, &QPushButton::clicked, this, &QDialog::accept);
+    buttons->addWidget(exportBtn);
+    buttons->addStretch();
+    buttons->addWidget(closeBtn);
+
+    layout->addWidget(tabs);
+    layout->addLayout(buttons);
+
+    connect(m_runner, &CommandRunner::metricsRecorded, this, &DiagnosticsDialog::refresh);
+    refresh();
+}
+
+void DiagnosticsDialog::refresh()
+{
+    const QJsonObject summary = m_runner->metrics().toJson()["byDescription"].toObject();
+    m_summaryTable->setRowCount(summary.size());
+    int row = 0;
+    for (auto it = summary.constBegin(); it != summary.constEnd(); ++it, ++row) {
+        const QJsonObject s = it.value().toObject();
+        const QStringList cells = {
+            it.key(),
+            QString::number(s["count"].toInt()),
+            QString::number(s["failures"].toInt()),
+            formatMs(s["lastWallMs"].toInteger()),
+            formatMs(s["medianWallMs"].toInteger()),
+            formatMs(s["maxWallMs"].toInteger()),
+            formatMs(s["medianFirstOutputMs"].toInteger()),
+            formatMs(s["medianAuthWaitMs"].toInteger()),
+            formatCpu(s["medianCpuSec"].toDouble(), 0),
+            formatKb(s["maxRssKb"].toInteger())
+        };
+        for (int col = 0; col < cells.size(); ++col) m_summaryTable->setItem(row, col, new QTableWidgetItem(cells[col]));
+    }
+
+    // Newest first
+    const QList<CommandMetrics> runs = m_runner->metrics().entries();
+    m_runsTable->setRowCount(runs.size());
+    for (int i = 0; i < runs.size(); ++i) {
+        const CommandMetrics& run = runs[runs.size() - 1 - i];
+        const QStringList cells = {
+            run.description,
+            run.startedAt.toString("HH:mm:ss"),
+            formatMs(run.wallMs),
+            formatMs(run.firstOutputMs),
+            formatMs(run.authWaitMs),
+            QString::number(run.exitCode),
+            run.capturedBytes > 0 ? QLocale().formattedDataSize(run.capturedBytes) : "-",
+            formatCpu(run.userCpuSec, run.systemCpuSec),
+            formatKb(run.maxRssKb),
+            run.headless ? "Headless" : (run.viaHelper ? "Helper" : "Terminal")
+        };
+        for (int col = 0; col < cells.size(); ++col) {
+            auto *item = new QTableWidgetItem(cells[col]);
+            if (col == 0) item->setToolTip(run.command);
+            m_runsTable->setItem(i, col, item);
+        }
+    }
+}
+
+void DiagnosticsDialog::exportJson()
+{
+    QString fileName = QString("uptater-diagnostics-%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss"));
+    QString path = QFileDialog::getSaveFileName(this, "Export Diagnostics", QDir::home().filePath(fileName), "JSON Files (*.json)");
+    if (path.isEmpty()) return;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(QJsonDocument(m_runner->metrics().toJson()).toJson()) < 0) {
+        QMessageBox::warning(this, "Export Failed", QString("Could not write %1.").arg(path));
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QDialog>
+
+class CommandRunner;
+class QTableWidget;
+
+// Per-command timing and resource usage collected by the CommandRunner, summarised by
+// description and listed run by run, with a JSON export for comparing machines.
+class DiagnosticsDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit DiagnosticsDialog(CommandRunner* runner, QWidget *parent = nullptr);
+
+private slots:
+    void refresh();
+    void exportJson();
+
+private:
+    CommandRunner* m_runner;
+    QTableWidget* m_summaryTable;
+    QTableWidget* m_runsTable;
+};
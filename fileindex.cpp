@@ -0,0 +1,600 @@
+#include "fileindex.h"
+#include "syncdatabase.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QSet>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <sys/stat.h>
+
+// Index file layout, integers in host byte order (the file never leaves this machine):
+//   Header
+//   sources      per source: quint8 kind, qint64 mtime (ns), qint64 size, quint16 length, name
+//   owners       per owner: quint32 source, quint16 length, package name
+//   block table  quint32 offset into the block data per block of kBlockSize entries
+//   block data   per entry: varint length shared with the previous path of the block, varint
+//                suffix length, suffix, varint owner; a block's first path is stored whole
+//   basenames    quint32 entry per file (directories left out), sorted by file name
+// Entries are sorted by path, then owner, with paths kept as pacman lists them (no leading '/').
+
+namespace {
+
+constexpr char kMagic[8] = { 'U', 'P', 'T', 'F', 'I', 'D', 'X', 0 };
+constexpr quint32 kVersion = 1;
+constexpr quint32 kBlockSize = 16;
+
+struct Header {
+    char magic[8];
+    quint32 version;
+    quint32 sourceCount;
+    quint32 ownerCount;
+    quint32 entryCount;
+    quint32 blockCount;
+    quint32 basenameCount;
+    quint64 sourcesOffset;
+    quint64 ownersOffset;
+    quint64 blockTableOffset;
+    quint64 blockDataOffset;
+    quint64 basenamesOffset;
+    quint64 fileSize;
+};
+
+template <typename T> void appendRaw(QByteArray& out, T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendString(QByteArray& out, const QString& value)
+{
+    QByteArray utf8 = value.toUtf8().left(0xffff);
+    appendRaw<quint16>(out, utf8.size());
+    out.append(utf8);
+}
+
+void appendVarint(QByteArray& out, quint32 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+// False if the value runs past end, which only a damaged file does
+bool readVarint(const uchar*& p, const uchar* end, quint32* value)
+{
+    quint32 result = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        uchar byte = *p++;
+        result |= quint32(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+quint32 readU32(const uchar* p)
+{
+    quint32 value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Fixed-size fields and strings off one section, never past its end
+struct Cursor {
+    const uchar* p;
+    const uchar* end;
+    bool ok = true;
+
+    template <typename T> T take()
+    {
+        T value{};
+        if (end - p < qsizetype(sizeof(T))) { ok = false; return value; }
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+
+    QString takeString()
+    {
+        quint16 length = take<quint16>();
+        if (!ok || end - p < length) { ok = false; return QString(); }
+        QString value = QString::fromUtf8(reinterpret_cast<const char*>(p), length);
+        p += length;
+        return value;
+    }
+};
+
+// The %FILES% section of a local or sync files entry, one path per line
+template <typename F> void forEachListedPath(const QByteArray& data, F f)
+{
+    bool inFiles = false;
+    qsizetype pos = 0;
+    while (pos < data.size()) {
+        qsizetype end = data.indexOf('\n', pos);
+        if (end == -1) end = data.size();
+        std::string_view line(data.constData() + pos, end - pos);
+        pos = end + 1;
+
+        if (line.empty()) { inFiles = false; continue; }
+        if (line.size() > 2 && line.front() == '%' && line.back() == '%') { inFiles = (line == "%FILES%"); continue; }
+        if (inFiles) f(line);
+    }
+}
+
+// "<name>-<version>-<rel>" -> "<name>"; versions and rels never contain dashes
+QString packageNameFromDirectory(const QString& directory)
+{
+    qsizetype relDash = directory.lastIndexOf('-');
+    qsizetype versionDash = relDash > 0 ? directory.lastIndexOf('-', relDash - 1) : -1;
+    return versionDash > 0 ? directory.left(versionDash) : QString();
+}
+
+// Paths of one source back to back in one buffer; owners are numbered within the source
+struct SourcePaths {
+    struct Path {
+        quint32 offset;
+        quint32 length;
+        quint32 owner;
+    };
+
+    QStringList owners;
+    QByteArray buffer;
+    QList<Path> paths;
+
+    void add(std::string_view path, quint32 owner)
+    {
+        paths.append({ quint32(buffer.size()), quint32(path.size()), owner });
+        buffer.append(path.data(), path.size());
+    }
+    std::string_view pathAt(qsizetype i) const { return std::string_view(buffer.constData() + paths[i].offset, paths[i].length); }
+};
+
+} // namespace
+
+std::shared_ptr<const FileIndex> FileIndex::update(const QString& indexPath, const QString& dbPath, const QStringList& repos)
+{
+    const QList<Source> sources = currentSources(dbPath, repos);
+    std::shared_ptr<FileIndex> existing = open(indexPath);
+
+    bool current = existing && existing->m_sources.size() == sources.size()
+        && std::equal(sources.cbegin(), sources.cend(), existing->m_sources.cbegin(), [](const Source& a, const Source& b){ return a.sameFile(b); });
+    if (current) return existing;
+
+    // The old mapping stays valid after the new file is renamed over it
+    if (!build(indexPath, dbPath, sources, existing.get())) return existing;
+    return open(indexPath);
+}
+
+QList<FileIndex::Source> FileIndex::currentSources(const QString& dbPath, const QStringList& repos)
+{
+    QList<Source> sources;
+    auto stamp = [&sources](SourceKind kind, const QString& name, const QString& path) {
+        struct stat st;
+        if (::stat(QFile::encodeName(path).constData(), &st) != 0) return;
+        Source source;
+        source.kind = kind;
+        source.name = name;
+        source.mtimeNs = static_cast<qint64>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        source.size = st.st_size;
+        sources.append(source);
+    };
+
+    const QString localPath = dbPath + "local/";
+    const QStringList entries = QDir(localPath).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString& entry : entries) stamp(SourceKind::Local, entry, localPath + entry + "/files");
+    for (const QString& repo : repos) stamp(SourceKind::Sync, repo, SyncDatabase::filesDatabaseFile(dbPath, repo));
+    return sources;
+}
+
+bool FileIndex::build(const QString& indexPath, const QString& dbPath, const QList<Source>& sources, const FileIndex* previous)
+{
+    QList<SourcePaths> paths(sources.size());
+    QList<bool> reused(sources.size(), false);
+
+    // Unchanged sources are decoded out of the previous index instead of being read again
+    if (previous) {
+        auto key = [](const Source& source){ return QString(QChar(source.kind == SourceKind::Local ? 'L' : 'S')) + source.name; };
+        QHash<QString, qsizetype> byName;
+        for (qsizetype i = 0; i < sources.size(); ++i) byName.insert(key(sources[i]), i);
+
+        QList<qsizetype> sourceMap(previous->m_sources.size(), -1);
+        for (qsizetype i = 0; i < previous->m_sources.size(); ++i) {
+            const Source& old = previous->m_sources[i];
+            qsizetype target = byName.value(key(old), -1);
+            if (target != -1 && old.sameFile(sources[target])) {
+                sourceMap[i] = target;
+                reused[target] = true;
+            }
+        }
+
+        QList<qint64> ownerMap(previous->m_owners.size(), -1);
+        for (qsizetype i = 0; i < previous->m_owners.size(); ++i) {
+            qsizetype target = sourceMap[previous->m_owners[i].source];
+            if (target == -1) continue;
+            ownerMap[i] = paths[target].owners.size();
+            paths[target].owners << previous->m_owners[i].package;
+        }
+
+        previous->forEachEntry([&](quint32, std::string_view path, quint32 owner){
+            if (ownerMap[owner] != -1) paths[sourceMap[previous->m_owners[owner].source]].add(path, quint32(ownerMap[owner]));
+            return true;
+        });
+    }
+
+    QList<qsizetype> changed;
+    for (qsizetype i = 0; i < sources.size(); ++i) {
+        if (!reused[i]) changed << i;
+    }
+
+    // Each changed source fills only its own slot
+    SourcePaths* slots = paths.data();
+    QtConcurrent::blockingMap(changed, [&sources, &dbPath, slots](qsizetype i){
+        const Source& source = sources[i];
+        SourcePaths* out = &slots[i];
+
+        if (source.kind == SourceKind::Local) {
+            QFile file(dbPath + "local/" + source.name + "/files");
+            if (!file.open(QIODevice::ReadOnly)) return;
+            out->owners << packageNameFromDirectory(source.name);
+            forEachListedPath(file.readAll(), [out](std::string_view path){ out->add(path, 0); });
+            return;
+        }
+
+        SyncDatabase::readFileLists(SyncDatabase::filesDatabaseFile(dbPath, source.name), [out](const QString& package, const QByteArray& files){
+            quint32 owner = out->owners.size();
+            out->owners << package;
+            forEachListedPath(files, [out, owner](std::string_view path){ out->add(path, owner); });
+        });
+    });
+
+    // Owners get global ids in source order, so installed packages come before the repos
+    struct Entry {
+        std::string_view path;
+        quint32 owner;
+    };
+    QList<Entry> entries;
+    QByteArray sourcesSection, ownersSection;
+    quint32 ownerCount = 0;
+
+    qsizetype total = 0;
+    for (const SourcePaths& source : paths) total += source.paths.size();
+    if (total > qsizetype(std::numeric_limits<quint32>::max())) return false;
+    entries.reserve(total);
+
+    for (qsizetype i = 0; i < sources.size(); ++i) {
+        const Source& source = sources[i];
+        appendRaw<quint8>(sourcesSection, quint8(source.kind));
+        appendRaw<qint64>(sourcesSection, source.mtimeNs);
+        appendRaw<qint64>(sourcesSection, source.size);
+        appendString(sourcesSection, source.name);
+
+        const quint32 base = ownerCount;
+        for (const QString& package : paths[i].owners) {
+            appendRaw<quint32>(ownersSection, quint32(i));
+            appendString(ownersSection, package);
+            ++ownerCount;
+        }
+        for (qsizetype p = 0; p < paths[i].paths.size(); ++p) entries.append({ paths[i].pathAt(p), base + paths[i].paths[p].owner });
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b){
+        int cmp = a.path.compare(b.path);
+        return cmp != 0 ? cmp < 0 : a.owner < b.owner;
+    });
+
+    // Front coding: sorted neighbours share most of their directories, which makes up most of the bytes
+    QByteArray blockTable, blockData;
+    std::string_view previousPath;
+    for (qsizetype i = 0; i < entries.size(); ++i) {
+        std::string_view path = entries[i].path;
+        size_t prefix = 0;
+        if (i % kBlockSize == 0) {
+            appendRaw<quint32>(blockTable, quint32(blockData.size()));
+        } else {
+            size_t limit = std::min(path.size(), previousPath.size());
+            while (prefix < limit && path[prefix] == previousPath[prefix]) ++prefix;
+        }
+        appendVarint(blockData, quint32(prefix));
+        appendVarint(blockData, quint32(path.size() - prefix));
+        blockData.append(path.data() + prefix, qsizetype(path.size() - prefix));
+        appendVarint(blockData, entries[i].owner);
+        previousPath = path;
+    }
+
+    QList<quint32> named;
+    for (qsizetype i = 0; i < entries.size(); ++i) {
+        if (!entries[i].path.empty() && entries[i].path.back() != '/') named << quint32(i);
+    }
+    std::sort(named.begin(), named.end(), [&entries](quint32 a, quint32 b){
+        int cmp = basename(entries[a].path).compare(basename(entries[b].path));
+        return cmp != 0 ? cmp < 0 : a < b;
+    });
+    QByteArray basenames;
+    basenames.reserve(named.size() * sizeof(quint32));
+    for (quint32 entry : named) appendRaw<quint32>(basenames, entry);
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.sourceCount = quint32(sources.size());
+    header.ownerCount = ownerCount;
+    header.entryCount = quint32(entries.size());
+    header.blockCount = quint32(blockTable.size() / sizeof(quint32));
+    header.basenameCount = quint32(named.size());
+    header.sourcesOffset = sizeof(Header);
+    header.ownersOffset = header.sourcesOffset + sourcesSection.size();
+    header.blockTableOffset = header.ownersOffset + ownersSection.size();
+    header.blockDataOffset = header.blockTableOffset + blockTable.size();
+    header.basenamesOffset = header.blockDataOffset + blockData.size();
+    header.fileSize = header.basenamesOffset + basenames.size();
+
+    QDir().mkpath(QFileInfo(indexPath).absolutePath());
+    QSaveFile file(indexPath);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const QByteArray* section : { &sourcesSection, &ownersSection, &blockTable, &blockData, &basenames }) {
+        if (file.write(*section) != section->size()) return false;
+    }
+    return file.commit();
+}
+
+std::shared_ptr<FileIndex> FileIndex::open(const QString& indexPath)
+{
+    auto index = std::make_shared<FileIndex>();
+    index->m_file.setFileName(indexPath);
+    if (!index->m_file.open(QIODevice::ReadOnly) || index->m_file.size() < qint64(sizeof(Header))) return nullptr;
+
+    index->m_size = index->m_file.size();
+    index->m_data = index->m_file.map(0, index->m_size);
+    if (!index->m_data) return nullptr;
+
+    Header header;
+    std::memcpy(&header, index->m_data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) return nullptr;
+
+    // Sections follow one another in order and fill the file exactly
+    const quint64 size = quint64(index->m_size);
+    bool ordered = header.fileSize == size
+        && header.sourcesOffset == sizeof(Header)
+        && header.sourcesOffset <= header.ownersOffset
+        && header.ownersOffset <= header.blockTableOffset
+        && header.blockTableOffset + quint64(header.blockCount) * sizeof(quint32) == header.blockDataOffset
+        && header.blockDataOffset <= header.basenamesOffset
+        && header.basenamesOffset + quint64(header.basenameCount) * sizeof(quint32) == size
+        && quint64(header.blockCount) == (quint64(header.entryCount) + kBlockSize - 1) / kBlockSize;
+    if (!ordered) return nullptr;
+
+    const uchar* data = index->m_data;
+    Cursor sources{ data + header.sourcesOffset, data + header.ownersOffset };
+    for (quint32 i = 0; i < header.sourceCount && sources.ok; ++i) {
+        Source source;
+        source.kind = SourceKind(sources.take<quint8>());
+        source.mtimeNs = sources.take<qint64>();
+        source.size = sources.take<qint64>();
+        source.name = sources.takeString();
+        index->m_sources.append(source);
+    }
+
+    Cursor owners{ data + header.ownersOffset, data + header.blockTableOffset };
+    for (quint32 i = 0; i < header.ownerCount && owners.ok; ++i) {
+        Owner owner;
+        owner.source = owners.take<quint32>();
+        owner.package = owners.takeString();
+        if (owner.source >= header.sourceCount) owners.ok = false;
+        index->m_owners.append(owner);
+    }
+    if (!sources.ok || !owners.ok) return nullptr;
+
+    index->m_entryCount = header.entryCount;
+    index->m_blockCount = header.blockCount;
+    index->m_basenameCount = header.basenameCount;
+    index->m_blockTable = data + header.blockTableOffset;
+    index->m_blockData = data + header.blockDataOffset;
+    index->m_blockDataEnd = data + header.basenamesOffset;
+    index->m_basenames = data + header.basenamesOffset;
+    return index;
+}
+
+template <typename F> void FileIndex::forEachInBlock(quint32 block, F f) const
+{
+    if (block >= m_blockCount) return;
+    quint32 offset = readU32(m_blockTable + block * sizeof(quint32));
+    if (offset > quint64(m_blockDataEnd - m_blockData)) return;
+
+    const uchar* p = m_blockData + offset;
+    std::string path;
+    const quint32 first = block * kBlockSize;
+    const quint32 last = std::min(first + kBlockSize, m_entryCount);
+    for (quint32 entry = first; entry < last; ++entry) {
+        quint32 prefix, length, owner;
+        if (!readVarint(p, m_blockDataEnd, &prefix) || !readVarint(p, m_blockDataEnd, &length)) return;
+        if (prefix > path.size() || quint64(m_blockDataEnd - p) < length) return;
+        path.resize(prefix);
+        path.append(reinterpret_cast<const char*>(p), length);
+        p += length;
+        if (!readVarint(p, m_blockDataEnd, &owner) || owner >= quint32(m_owners.size())) return;
+        if (!f(entry, std::string_view(path), owner)) return;
+    }
+}
+
+template <typename F> void FileIndex::forEachEntry(F f) const
+{
+    bool more = true;
+    for (quint32 block = 0; block < m_blockCount && more; ++block) {
+        forEachInBlock(block, [&](quint32 entry, std::string_view path, quint32 owner){
+            more = f(entry, path, owner);
+            return more;
+        });
+    }
+}
+
+bool FileIndex::entryAt(quint32 entry, std::string* path, quint32* owner) const
+{
+    bool found = false;
+    forEachInBlock(entry / kBlockSize, [&](quint32 current, std::string_view currentPath, quint32 currentOwner){
+        if (current != entry) return true;
+        path->assign(currentPath);
+        *owner = currentOwner;
+        found = true;
+        return false;
+    });
+    return found;
+}
+
+std::string_view FileIndex::basename(std::string_view path)
+{
+    if (!path.empty() && path.back() == '/') path.remove_suffix(1);
+    size_t slash = path.rfind('/');
+    return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+FileOwner FileIndex::makeOwner(std::string_view path, quint32 owner, FileOwner::Match match) const
+{
+    FileOwner result;
+    result.path = "/" + QString::fromUtf8(path.data(), qsizetype(path.size()));
+    result.package = m_owners[owner].package;
+    const Source& source = m_sources[m_owners[owner].source];
+    if (source.kind == SourceKind::Sync) result.repo = source.name;
+    result.match = match;
+    return result;
+}
+
+void FileIndex::findPath(std::string_view path, QList<FileOwner>& out) const
+{
+    // First block whose head sorts at or after path; equal paths may also end the block before it
+    auto head = [this](quint32 block){
+        std::string result;
+        forEachInBlock(block, [&result](quint32, std::string_view first, quint32){ result.assign(first); return false; });
+        return result;
+    };
+    quint32 low = 0, high = m_blockCount;
+    while (low < high) {
+        quint32 middle = low + (high - low) / 2;
+        if (head(middle) < path) low = middle + 1;
+        else high = middle;
+    }
+
+    bool done = false;
+    for (quint32 block = low > 0 ? low - 1 : 0; block < m_blockCount && !done; ++block) {
+        forEachInBlock(block, [&](quint32, std::string_view current, quint32 owner){
+            int cmp = current.compare(path);
+            if (cmp < 0) return true;
+            if (cmp > 0) { done = true; return false; }
+            out.append(makeOwner(current, owner, FileOwner::Match::Path));
+            return true;
+        });
+    }
+}
+
+void FileIndex::findBasename(std::string_view name, int limit, QList<FileOwner>& out) const
+{
+    auto at = [this](quint32 slot, std::string* path, quint32* owner){
+        return entryAt(readU32(m_basenames + slot * sizeof(quint32)), path, owner);
+    };
+
+    std::string path;
+    quint32 owner = 0;
+    quint32 low = 0, high = m_basenameCount;
+    while (low < high) {
+        quint32 middle = low + (high - low) / 2;
+        if (!at(middle, &path, &owner) || basename(path) < name) low = middle + 1;
+        else high = middle;
+    }
+
+    for (quint32 slot = low; slot < m_basenameCount && out.size() < limit; ++slot) {
+        if (!at(slot, &path, &owner) || basename(path) != name) break;
+        out.append(makeOwner(path, owner, FileOwner::Match::Basename));
+    }
+}
+
+void FileIndex::findSubstring(std::string_view needle, int limit, QList<FileOwner>& out) const
+{
+    // Contiguous block ranges per core; results are concatenated in path order
+    struct Hit {
+        std::string path;
+        quint32 owner;
+    };
+    const int chunkCount = std::max(1, QThread::idealThreadCount());
+    QList<int> chunks(chunkCount);
+    std::iota(chunks.begin(), chunks.end(), 0);
+
+    const QList<QList<Hit>> results = QtConcurrent::blockingMapped<QList<QList<Hit>>>(chunks, [this, needle, limit, chunkCount](int chunk){
+        QList<Hit> hits;
+        const quint32 first = quint32(quint64(m_blockCount) * chunk / chunkCount);
+        const quint32 last = quint32(quint64(m_blockCount) * (chunk + 1) / chunkCount);
+        for (quint32 block = first; block < last && hits.size() < limit; ++block) {
+            forEachInBlock(block, [&](quint32, std::string_view path, quint32 owner){
+                if (path.find(needle) != std::string_view::npos) hits.append({ std::string(path), owner });
+                return hits.size() < limit;
+            });
+        }
+        return hits;
+    });
+
+    for (const QList<Hit>& hits : results) {
+        for (const Hit& hit : hits) {
+            if (out.size() >= limit) return;
+            out.append(makeOwner(hit.path, hit.owner, FileOwner::Match::Substring));
+        }
+    }
+}
+
+QList<FileOwner> FileIndex::search(const QString& query, int limit) const
+{
+    QList<FileOwner> results;
+    const QByteArray needle = query.trimmed().toUtf8();
+    if (needle.isEmpty() || limit <= 0) return results;
+
+    if (needle.startsWith('/')) {
+        std::string path(needle.constData() + 1, needle.size() - 1);
+        findPath(path, results);
+        // "/usr/bin" names the directory pacman lists as "usr/bin/"
+        if (results.isEmpty() && !path.empty() && path.back() != '/') findPath(path + '/', results);
+        dropRepeats(results);
+    } else {
+        // Repeats are only known once found, so they can eat into the limit: ask again for more
+        // until enough are left or the substring pass comes back short of what it was allowed
+        std::string_view view(needle.constData(), needle.size());
+        int wanted = std::min(limit, std::numeric_limits<int>::max() / 2);
+        for (;;) {
+            results.clear();
+            if (!needle.contains('/')) findBasename(view, wanted, results);
+            const int allowed = wanted + int(results.size());
+            findSubstring(view, allowed, results);
+            const bool exhausted = results.size() < allowed;
+            dropRepeats(results);
+            if (exhausted || results.size() >= limit || wanted > std::numeric_limits<int>::max() / 4) break;
+            wanted *= 2;
+        }
+    }
+
+    if (results.size() > limit) results.resize(limit);
+    return results;
+}
+
+void FileIndex::dropRepeats(QList<FileOwner>& results)
+{
+    // A repo's copy of an installed package adds nothing the installed one doesn't already say
+    QSet<QString> installed;
+    for (const FileOwner& owner : results) {
+        if (owner.isInstalled()) installed.insert(owner.path + '\n' + owner.package);
+    }
+    QSet<QString> seen;
+    results.removeIf([&installed, &seen](const FileOwner& owner){
+        QString key = owner.path + '\n' + owner.package;
+        if (!owner.isInstalled() && installed.contains(key)) return true;
+        key += '\n' + owner.repo;
+        if (seen.contains(key)) return true;
+        seen.insert(key);
+        return false;
+    });
+}
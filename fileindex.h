@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QFile>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// One owner of one path, as pacman -Qo (installed) or pacman -F (sync repos) would report it
+struct FileOwner {
+    enum class Match : quint8 { Path, Basename, Substring };
+
+    QString path;       // absolute; directories end with '/'
+    QString package;
+    QString repo;       // sync repo the list came from; empty for installed packages
+    Match match = Match::Path;
+
+    bool isInstalled() const { return repo.isEmpty(); }
+};
+
+// Every path of the installed packages (<DBPath>local/*/files) and of the sync repos'
+// .files databases, sorted and front-coded in blocks in one file that is mapped, not read.
+// Lookups binary-search the block heads; substring searches stream the blocks on all cores.
+class FileIndex
+{
+public:
+    // Maps the index at indexPath, first rebuilding it if any package or repo it was made
+    // from has changed. Only changed sources are re-read; the rest are copied out of the old
+    // index. Null if nothing could be read or written. Blocking; call it from a worker.
+    static std::shared_ptr<const FileIndex> update(const QString& indexPath, const QString& dbPath, const QStringList& repos);
+
+    // Maps an existing index; null for a missing, foreign-version or damaged file
+    static std::shared_ptr<FileIndex> open(const QString& indexPath);
+
+    quint32 entryCount() const { return m_entryCount; }
+
+    // "/usr/bin/ls" finds the owners of that exact path; anything else finds files with that
+    // name first and then paths containing it, up to limit rows in all
+    QList<FileOwner> search(const QString& query, int limit) const;
+
+private:
+    enum class SourceKind : quint8 { Local, Sync };
+
+    // A local/<entry>/files file or a <repo>.files database, identified without reading it
+    struct Source {
+        SourceKind kind = SourceKind::Local;
+        QString name;           // local/ entry directory or repo
+        qint64 mtimeNs = 0;
+        qint64 size = -1;
+        bool sameFile(const Source& other) const { return kind == other.kind && name == other.name && mtimeNs == other.mtimeNs && size == other.size; }
+    };
+
+    struct Owner {
+        quint32 source;
+        QString package;
+    };
+
+    static QList<Source> currentSources(const QString& dbPath, const QStringList& repos);
+    static bool build(const QString& indexPath, const QString& dbPath, const QList<Source>& sources, const FileIndex* previous);
+
+    // Calls f(entry, path, owner) for the entries of a block in order, paths without the
+    // leading '/', until f returns false
+    template <typename F> void forEachInBlock(quint32 block, F f) const;
+    template <typename F> void forEachEntry(F f) const;
+    bool entryAt(quint32 entry, std::string* path, quint32* owner) const;
+    static std::string_view basename(std::string_view path);
+    FileOwner makeOwner(std::string_view path, quint32 owner, FileOwner::Match match) const;
+
+    void findPath(std::string_view path, QList<FileOwner>& out) const;
+    void findBasename(std::string_view name, int limit, QList<FileOwner>& out) const;
+    void findSubstring(std::string_view needle, int limit, QList<FileOwner>& out) const;
+    static void dropRepeats(QList<FileOwner>& results);
+
+    QFile m_file;
+    const uchar* m_data = nullptr;
+    qint64 m_size = 0;
+
+    QList<Source> m_sources;
+    QList<Owner> m_owners;
+    quint32 m_entryCount = 0;
+    quint32 m_blockCount = 0;
+    quint32 m_basenameCount = 0;
+    const uchar* m_blockTable = nullptr;    // quint32 offset into m_blockData per block
+    const uchar* m_blockData = nullptr;
+    const uchar* m_blockDataEnd = nullptr;
+    const uchar* m_basenames = nullptr;     // quint32 entry ids, sorted by file name
+};
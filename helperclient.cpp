@@ -0,0 +1,105 @@
+#include "helperclient.h"
+#include "privilegedhelper.h"
+#include <QLocalSocket>
+#include <QDataStream>
+#include <QEventLoop>
+#include <QSocketNotifier>
+#include <cstdio>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+
+static void writeAll(int fd, const QByteArray& data)
+{
+    const char* p = data.constData();
+    qsizetype left = data.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n <= 0) return;
+        p += n;
+        left -= n;
+    }
+}
+
+// Signals that reach the shim (Ctrl+C, the runner's SIGTERM) are forwarded to the helper
+static int s_signalPipe[2] = { -1, -1 };
+
+static void forwardSignal(int sig)
+{
+    unsigned char byte = static_cast<unsigned char>(sig);
+    (void)!::write(s_signalPipe[1], &byte, 1);
+}
+
+int HelperClient::exec(const QStringList& argv)
+{
+    if (argv.size() < 2) {
+        fprintf(stderr, "usage: %s <operation> [parameters]\n", shimName());
+        return 1;
+    }
+    const QString operation = argv[1];
+    const QStringList parameters = argv.mid(2);
+    if (!qEnvironmentVariableIsSet(socketEnvVar())) return PrivilegedHelper::runDirect(operation, parameters);
+
+    QLocalSocket socket;
+    socket.connectToServer(qEnvironmentVariable(socketEnvVar()));
+    if (!socket.waitForConnected(3000)) {
+        fprintf(stderr, "uptater: privileged helper is not running\n");
+        return 1;
+    }
+
+    QEventLoop loop;
+
+    if (pipe2(s_signalPipe, O_CLOEXEC | O_NONBLOCK) == 0) {
+        struct sigaction action {};
+        action.sa_handler = forwardSignal;
+        sigemptyset(&action.sa_mask);
+        for (int sig : { SIGINT, SIGTERM, SIGHUP }) sigaction(sig, &action, nullptr);
+
+        auto *notifier = new QSocketNotifier(s_signalPipe[0], QSocketNotifier::Read, &loop);
+        QObject::connect(notifier, &QSocketNotifier::activated, &loop, [&socket](){
+            unsigned char byte;
+            while (::read(s_signalPipe[0], &byte, 1) == 1) {
+                socket.write(HelperProtocol::encode(HelperProtocol::Cancel, QByteArray::number(byte)));
+            }
+            socket.flush();
+        });
+    }
+
+    QByteArray request;
+    QDataStream stream(&request, QIODevice::WriteOnly);
+    stream << operation << parameters;
+    socket.write(HelperProtocol::encode(HelperProtocol::Request, request));
+    socket.flush();
+
+    QByteArray buffer;
+    bool done = false;
+    QObject::connect(&socket, &QLocalSocket::readyRead, &loop, [&](){
+        buffer.append(socket.readAll());
+
+        quint8 type;
+        QByteArray payload;
+        while (HelperProtocol::decode(buffer, &type, &payload)) {
+            switch (type) {
+                case HelperProtocol::Output: writeAll(STDOUT_FILENO, payload); break;
+                case HelperProtocol::ErrorOutput: writeAll(STDERR_FILENO, payload); break;
+                case HelperProtocol::Rejected:
+                    fprintf(stderr, "uptater: %s\n", payload.constData());
+                    done = true;
+                    loop.exit(1);
+                    return;
+                case HelperProtocol::Exit:
+                    done = true;
+                    loop.exit(payload.toInt());
+                    return;
+                default: break;
+            }
+        }
+    });
+    QObject::connect(&socket, &QLocalSocket::disconnected, &loop, [&](){
+        if (done) return;
+        fprintf(stderr, "uptater: lost connection to the privileged helper\n");
+        loop.exit(1);
+    });
+
+    return loop.exec();
+}
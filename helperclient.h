@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+// Runs inside the terminal as "uptater-op <operation> [parameters]": the shim symlink of that
+// name points back at uptater, which forwards the operation to the session's privileged helper
+// and relays its output. In a root shell pkexec started without the helper it runs the
+// operation itself, through the same checks.
+class HelperClient
+{
+public:
+    static const char* socketEnvVar() { return "UPTATER_HELPER_SOCKET"; }
+    static const char* shimName() { return "uptater-op"; }
+
+    static bool handles(const QString& invokedName) { return invokedName == QLatin1String(shimName()); }
+    static int exec(const QStringList& argv);
+};
@@ -0,0 +1,62 @@
+#include "helpersession.h"
+#include "helperclient.h"
+#include "privilegedhelper.h"
+#include <QCoreApplication>
+#include <QLocalSocket>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <unistd.h>
+
+HelperSession::HelperSession(const QString& runtimeDir, QObject* parent)
+: QObject(parent)
+{
+    QDir dir(runtimeDir);
+    m_socketPath = PrivilegedHelper::socketPath(getuid());
+    m_shimDir = dir.filePath("shims");
+
+    // Root jobs call their operations through this one name, with or without the helper
+    bool shimsReady = dir.mkpath("shims")
+                   && QFile::link(QCoreApplication::applicationFilePath(), QDir(m_shimDir).filePath(HelperClient::shimName()));
+
+    if (!shimsReady || QStandardPaths::findExecutable("pkexec").isEmpty()) {
+        m_state = State::Unavailable;
+    }
+}
+
+QString HelperSession::launchCommand() const
+{
+    return QString("pkexec \"%1\" --privileged-helper").arg(QCoreApplication::applicationFilePath());
+}
+
+bool HelperSession::attach()
+{
+    delete m_session;
+    m_session = new QLocalSocket(this);
+    m_session->connectToServer(m_socketPath);
+    if (!m_session->waitForConnected(3000)) {
+        m_state = State::Unavailable;
+        return false;
+    }
+
+    m_session->write(HelperProtocol::encode(HelperProtocol::Session));
+    m_session->flush();
+
+    connect(m_session, &QLocalSocket::disconnected, this, [this](){
+        if (m_state == State::Ready) m_state = State::Stopped;
+        emit stopped();
+    });
+
+    m_state = State::Ready;
+    return true;
+}
+
+QString HelperSession::environmentPrefix() const
+{
+    return QString("export PATH=\"%1:$PATH\" %2=\"%3\";").arg(m_shimDir, QString::fromLatin1(HelperClient::socketEnvVar()), m_socketPath);
+}
+
+QString HelperSession::pathPrefix() const
+{
+    return QString("export PATH=\"%1:$PATH\";").arg(m_shimDir);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+class QLocalSocket;
+
+// GUI side of the privileged helper: owns the shim directory, knows how to
+// launch the helper and keeps the session connection that bounds its lifetime.
+class HelperSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class State { Stopped, Ready, Unavailable };
+
+    explicit HelperSession(const QString& runtimeDir, QObject* parent = nullptr);
+
+    State state() const { return m_state; }
+    bool isReady() const { return m_state == State::Ready; }
+
+    // Command run in the terminal (so pkexec can use a text agent there too) to start the helper
+    QString launchCommand() const;
+    // Connects the session once the launch command succeeded
+    bool attach();
+    void markUnavailable() { m_state = State::Unavailable; }
+
+    // Shell prefix that sends uptater-op operations to the helper
+    QString environmentPrefix() const;
+    // Shell prefix that only puts uptater-op on PATH, for root shells that run operations themselves
+    QString pathPrefix() const;
+
+signals:
+    void stopped();
+
+private:
+    QString m_socketPath;
+    QString m_shimDir;
+    QLocalSocket* m_session = nullptr;
+    State m_state = State::Stopped;
+};
@@ -0,0 +1,335 @@
+#include "localdatabase.h"
+#include "syncdatabase.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+#include <sys/stat.h>
+
+// Snapshot file layout:
+//   char[8]   magic "UPTLDB\0\0"
+//   quint32   format version (big-endian); bump whenever the payload changes shape
+//   quint64   payload size in bytes (big-endian)
+//   quint64   FNV-1a 64 of the payload (big-endian)
+//   payload   QDataStream (Qt_6_0): local mtime, sync stamps, then per package its
+//             desc stamp and record
+static const char kSnapshotMagic[8] = { 'U', 'P', 'T', 'L', 'D', 'B', 0, 0 };
+static const quint32 kSnapshotVersion = 1;
+static const qsizetype kSnapshotHeaderSize = 8 + 4 + 8 + 8;
+
+static quint64 fnv1a(const char* data, qsizetype size, quint64 hash = 0xcbf29ce484222325ULL)
+{
+    for (qsizetype i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static QDataStream& operator<<(QDataStream& out, const LocalPackage& pkg)
+{
+    return out << pkg.name << pkg.version << pkg.description << pkg.repo << pkg.explicitlyInstalled
+               << pkg.installDate << pkg.installedSize << pkg.depends << pkg.optDepends << pkg.provides << pkg.groups;
+}
+
+static QDataStream& operator>>(QDataStream& in, LocalPackage& pkg)
+{
+    return in >> pkg.name >> pkg.version >> pkg.description >> pkg.repo >> pkg.explicitlyInstalled
+              >> pkg.installDate >> pkg.installedSize >> pkg.depends >> pkg.optDepends >> pkg.provides >> pkg.groups;
+}
+
+static qint64 directoryMtime(const QString& path)
+{
+    return QFileInfo(path).lastModified().toMSecsSinceEpoch();
+}
+
+LocalDatabase::FileStamp LocalDatabase::stampFile(const QString& name, const QString& path)
+{
+    FileStamp stamp;
+    stamp.name = name;
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) == 0) {
+        stamp.mtimeNs = static_cast<qint64>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        stamp.size = st.st_size;
+    }
+    return stamp;
+}
+
+std::shared_ptr<LocalDatabase> LocalDatabase::load(const QString& dbPath, const QStringList& repos, const LocalDatabase* previous)
+{
+    auto db = std::make_shared<LocalDatabase>();
+    db->m_localPath = dbPath + "local";
+    db->m_localMtime = directoryMtime(db->m_localPath);
+
+    const QStringList entries = QDir(db->m_localPath).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    const QString localPath = db->m_localPath;
+
+    // pacman rewrites desc in place (e.g. for -D --asdeps), so each entry is checked by its own stamp
+    QHash<QString, qsizetype> previousEntries;
+    if (previous) {
+        for (qsizetype i = 0; i < previous->m_descStamps.size(); ++i) previousEntries.insert(previous->m_descStamps[i].name, i);
+    }
+
+    using Entry = std::pair<FileStamp, LocalPackage>;
+
+    // One desc file per package; each parse is independent
+    QList<Entry> parsed = QtConcurrent::blockingMapped<QList<Entry>>(entries, [localPath, previous, &previousEntries](const QString& entry){
+        Entry result;
+        QString descPath = localPath + "/" + entry + "/desc";
+        result.first = stampFile(entry, descPath);
+
+        qsizetype reuse = previousEntries.value(entry, -1);
+        if (reuse != -1 && previous->m_descStamps[reuse] == result.first) {
+            result.second = previous->m_packages[reuse];
+            return result;
+        }
+
+        QFile file(descPath);
+        if (file.open(QIODevice::ReadOnly)) parseDesc(file.readAll(), &result.second);
+        return result;
+    });
+
+    parsed.removeIf([](const Entry& entry){ return entry.second.name.isEmpty(); });
+    std::sort(parsed.begin(), parsed.end(), [](const Entry& a, const Entry& b){ return a.second.name < b.second.name; });
+
+    db->m_packages.reserve(parsed.size());
+    db->m_descStamps.reserve(parsed.size());
+    for (Entry& entry : parsed) {
+        db->m_descStamps.append(std::move(entry.first));
+        db->m_packages.append(std::move(entry.second));
+    }
+
+    db->resolveRepos(dbPath, repos, previous);
+    db->computeOrphans();
+    db->computeFingerprint();
+    return db;
+}
+
+bool LocalDatabase::saveSnapshot(const QString& path) const
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    out << m_localPath << m_localMtime << static_cast<quint32>(m_syncStamps.size());
+    for (const FileStamp& stamp : m_syncStamps) out << stamp.name << stamp.mtimeNs << stamp.size;
+
+    out << static_cast<quint32>(m_packages.size());
+    for (qsizetype i = 0; i < m_packages.size(); ++i) {
+        const FileStamp& stamp = m_descStamps[i];
+        out << stamp.name << stamp.mtimeNs << stamp.size << m_packages[i];
+    }
+
+    QByteArray header;
+    QDataStream headerOut(&header, QIODevice::WriteOnly);
+    headerOut.writeRawData(kSnapshotMagic, sizeof(kSnapshotMagic));
+    headerOut << kSnapshotVersion << static_cast<quint64>(payload.size()) << fnv1a(payload.constData(), payload.size());
+
+    // Written aside and renamed, so a crash never leaves a half-written snapshot behind
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(header);
+    file.write(payload);
+    return file.commit();
+}
+
+std::shared_ptr<LocalDatabase> LocalDatabase::loadSnapshot(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return nullptr;
+
+    // Every record is decoded into QStrings anyway, so the file is simply read in one go
+    const QByteArray contents = file.readAll();
+    if (contents.size() < kSnapshotHeaderSize) return nullptr;
+    const char* data = contents.constData();
+
+    if (std::memcmp(data, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) return nullptr;
+
+    QDataStream headerIn(QByteArray::fromRawData(data + 8, kSnapshotHeaderSize - 8));
+    quint32 version;
+    quint64 payloadSize, checksum;
+    headerIn >> version >> payloadSize >> checksum;
+    if (version != kSnapshotVersion || payloadSize != static_cast<quint64>(contents.size() - kSnapshotHeaderSize)) return nullptr;
+
+    const char* payloadData = data + kSnapshotHeaderSize;
+    if (fnv1a(payloadData, static_cast<qsizetype>(payloadSize)) != checksum) return nullptr;
+
+    auto db = std::make_shared<LocalDatabase>();
+    QDataStream in(QByteArray::fromRawData(payloadData, static_cast<qsizetype>(payloadSize)));
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 syncCount;
+    in >> db->m_localPath >> db->m_localMtime >> syncCount;
+    for (quint32 i = 0; i < syncCount && in.status() == QDataStream::Ok; ++i) {
+        FileStamp stamp;
+        in >> stamp.name >> stamp.mtimeNs >> stamp.size;
+        db->m_syncStamps.append(stamp);
+    }
+
+    quint32 packageCount;
+    in >> packageCount;
+    for (quint32 i = 0; i < packageCount && in.status() == QDataStream::Ok; ++i) {
+        FileStamp stamp;
+        LocalPackage pkg;
+        in >> stamp.name >> stamp.mtimeNs >> stamp.size >> pkg;
+        db->m_descStamps.append(stamp);
+        db->m_packages.append(pkg);
+    }
+    if (in.status() != QDataStream::Ok) return nullptr;
+
+    db->computeOrphans();
+    db->computeFingerprint();
+    return db;
+}
+
+bool LocalDatabase::isStale() const
+{
+    return directoryMtime(m_localPath) != m_localMtime;
+}
+
+bool LocalDatabase::parseDesc(const QByteArray& data, LocalPackage* pkg)
+{
+    SyncDatabase::forEachDescField(data, [pkg](QByteArrayView key, QByteArrayView value){
+        if (key == "%NAME%") pkg->name = QString::fromUtf8(value);
+        else if (key == "%VERSION%") pkg->version = QString::fromUtf8(value);
+        else if (key == "%DESC%") pkg->description = QString::fromUtf8(value);
+        else if (key == "%REASON%") pkg->explicitlyInstalled = (SyncDatabase::toNumber(value) == 0);
+        else if (key == "%INSTALLDATE%") pkg->installDate = SyncDatabase::toNumber(value);
+        else if (key == "%SIZE%") pkg->installedSize = SyncDatabase::toNumber(value);
+        else if (key == "%DEPENDS%") pkg->depends << QString::fromUtf8(value);
+        else if (key == "%OPTDEPENDS%") pkg->optDepends << SyncDatabase::optionalDependencyName(value);
+        else if (key == "%PROVIDES%") pkg->provides << QString::fromUtf8(value);
+        else if (key == "%GROUPS%") pkg->groups << QString::fromUtf8(value);
+    });
+    return !pkg->name.isEmpty() && !pkg->version.isEmpty();
+}
+
+LocalPackageExtras LocalDatabase::readExtras(const QString& entryPath)
+{
+    LocalPackageExtras extras;
+    QFile desc(entryPath + "/desc");
+    if (desc.open(QIODevice::ReadOnly)) {
+        SyncDatabase::forEachDescField(desc.readAll(), [&extras](QByteArrayView key, QByteArrayView value){
+            if (key == "%URL%") extras.url = QString::fromUtf8(value);
+            else if (key == "%LICENSE%") extras.licenses << QString::fromUtf8(value);
+            else if (key == "%PACKAGER%") extras.packager = QString::fromUtf8(value);
+            else if (key == "%BUILDDATE%") extras.buildDate = SyncDatabase::toNumber(value);
+        });
+    }
+
+    // Directories end in '/' in %FILES%; everything else is something the package owns outright
+    QFile files(entryPath + "/files");
+    if (files.open(QIODevice::ReadOnly)) {
+        SyncDatabase::forEachDescField(files.readAll(), [&extras](QByteArrayView key, QByteArrayView value){
+            if (key == "%FILES%" && !value.endsWith('/')) ++extras.fileCount;
+        });
+    }
+    return extras;
+}
+
+QString LocalDatabase::dependencyName(const QString& dependency)
+{
+    qsizetype end = 0;
+    while (end < dependency.size() && dependency[end] != '<' && dependency[end] != '>' && dependency[end] != '=') ++end;
+    return dependency.left(end);
+}
+
+void LocalDatabase::resolveRepos(const QString& dbPath, const QStringList& repos, const LocalDatabase* previous)
+{
+    for (const QString& repo : repos) m_syncStamps.append(stampFile(repo, SyncDatabase::databaseFile(dbPath, repo)));
+
+    // Same sync databases and no newly installed names: the previous origins still hold
+    if (previous && previous->m_syncStamps == m_syncStamps) {
+        QHash<QString, QString> known;
+        for (const LocalPackage& pkg : previous->m_packages) known.insert(pkg.name, pkg.repo);
+
+        bool complete = std::all_of(m_packages.cbegin(), m_packages.cend(), [&known](const LocalPackage& pkg){ return known.contains(pkg.name); });
+        if (complete) {
+            for (LocalPackage& pkg : m_packages) pkg.repo = known.value(pkg.name);
+            return;
+        }
+    }
+
+    // Decompressing the repos is the slow part, so each one gets its own thread
+    QList<QStringList> names = QtConcurrent::blockingMapped<QList<QStringList>>(repos, [dbPath](const QString& repo){
+        return SyncDatabase::readPackageNames(SyncDatabase::databaseFile(dbPath, repo));
+    });
+
+    // Earlier repos win, as they do for pacman
+    QHash<QString, QString> origin;
+    for (qsizetype i = names.size() - 1; i >= 0; --i) {
+        for (const QString& name : names[i]) origin.insert(name, repos[i]);
+    }
+    for (LocalPackage& pkg : m_packages) pkg.repo = origin.value(pkg.name);
+}
+
+void LocalDatabase::computeOrphans()
+{
+    // Everything a dependency string can be satisfied by: the package's own name and what it provides
+    QHash<QString, QList<qsizetype>> satisfiers;
+    for (qsizetype i = 0; i < m_packages.size(); ++i) {
+        satisfiers[m_packages[i].name].append(i);
+        for (const QString& provide : m_packages[i].provides) satisfiers[dependencyName(provide)].append(i);
+    }
+
+    // Walks depends (and optdepends if asked) from every explicit package; whatever is never
+    // reached is only kept alive by other unneeded packages, cycles included
+    auto reachable = [this, &satisfiers](bool followOptional) {
+        QList<bool> seen(m_packages.size(), false);
+        QList<qsizetype> stack;
+        for (qsizetype i = 0; i < m_packages.size(); ++i) {
+            if (m_packages[i].explicitlyInstalled) { seen[i] = true; stack.append(i); }
+        }
+        while (!stack.isEmpty()) {
+            const LocalPackage& pkg = m_packages[stack.takeLast()];
+            for (const QStringList* list : { &pkg.depends, &pkg.optDepends }) {
+                if (list == &pkg.optDepends && !followOptional) continue;
+                for (const QString& dependency : *list) {
+                    for (qsizetype index : satisfiers.value(dependencyName(dependency))) {
+                        if (!seen[index]) { seen[index] = true; stack.append(index); }
+                    }
+                }
+            }
+        }
+        return seen;
+    };
+    const QList<bool> needed = reachable(true);
+    const QList<bool> hardNeeded = reachable(false);
+
+    QList<bool> required(m_packages.size(), false);
+    for (const LocalPackage& pkg : m_packages) {
+        for (const QStringList* list : { &pkg.depends, &pkg.optDepends }) {
+            for (const QString& dependency : *list) {
+                for (qsizetype index : satisfiers.value(dependencyName(dependency))) required[index] = true;
+            }
+        }
+    }
+
+    m_orphans.fill(OrphanKind::None, m_packages.size());
+    for (qsizetype i = 0; i < m_packages.size(); ++i) {
+        if (m_packages[i].explicitlyInstalled) continue;
+        if (!required[i]) m_orphans[i] = OrphanKind::Orphan;
+        else if (!needed[i]) m_orphans[i] = OrphanKind::RecursiveOrphan;
+        else if (!hardNeeded[i]) m_orphans[i] = OrphanKind::OptionalOnly;
+    }
+}
+
+void LocalDatabase::computeFingerprint()
+{
+    quint64 hash = fnv1a(reinterpret_cast<const char*>(&m_localMtime), sizeof(m_localMtime));
+    for (const QList<FileStamp>* stamps : { &m_syncStamps, &m_descStamps }) {
+        for (const FileStamp& stamp : *stamps) {
+            QByteArray name = stamp.name.toUtf8();
+            hash = fnv1a(name.constData(), name.size(), hash);
+            hash = fnv1a(reinterpret_cast<const char*>(&stamp.mtimeNs), sizeof(stamp.mtimeNs), hash);
+            hash = fnv1a(reinterpret_cast<const char*>(&stamp.size), sizeof(stamp.size), hash);
+        }
+    }
+    m_fingerprint = hash;
+}
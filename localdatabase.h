@@ -0,0 +1,103 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QByteArray>
+#include <memory>
+
+struct LocalPackage {
+    QString name;
+    QString version;
+    QString description;
+    // First sync repo (in pacman.conf order) carrying this name; empty for foreign packages
+    QString repo;
+    bool explicitlyInstalled = true;
+    qint64 installDate = 0;     // seconds since the epoch
+    qint64 installedSize = 0;   // bytes
+    QStringList depends;        // as written, version constraints included
+    QStringList optDepends;     // names only
+    QStringList provides;
+    QStringList groups;
+
+    bool isForeign() const { return repo.isEmpty(); }
+};
+
+// What the details pane adds to LocalPackage, read from the package's own entry on demand
+// since a snapshot holding it for every package would mostly go unused
+struct LocalPackageExtras {
+    QString url;
+    QStringList licenses;
+    QString packager;
+    qint64 buildDate = 0;       // seconds since the epoch
+    int fileCount = 0;          // files and links; directories aren't counted
+};
+
+// Why a dependency-installed package is no longer needed
+enum class OrphanKind : quint8 {
+    None,
+    Orphan,             // nothing depends on it, not even optionally: pacman -Qdt
+    RecursiveOrphan,    // only orphans (directly or further down) depend on it
+    OptionalOnly,       // kept only by optional dependencies of needed packages: what -Qdtt adds
+};
+
+// In-memory snapshot of pacman's local database (<DBPath>local/*/desc), the data
+// behind pacman -Q and its -e/-m/-d/-t filters.
+class LocalDatabase
+{
+public:
+    // Parses every desc file on the global thread pool and resolves each package's
+    // repo from the sync databases. Entries whose desc file is unchanged since
+    // previous are copied from it instead of re-parsed. Blocking; call it from a worker.
+    static std::shared_ptr<LocalDatabase> load(const QString& dbPath, const QStringList& repos, const LocalDatabase* previous = nullptr);
+
+    // Binary copy for the next launch (layout in localdatabase.cpp). loadSnapshot()
+    // returns null for a missing, foreign-version or corrupt file.
+    bool saveSnapshot(const QString& path) const;
+    static std::shared_ptr<LocalDatabase> loadSnapshot(const QString& path);
+
+    // Sorted by name, like pacman -Q
+    const QList<LocalPackage>& packages() const { return m_packages; }
+
+    // Installed as a dependency and neither required nor optionally required by any
+    // installed package: what pacman -Qdt lists
+    bool isOrphan(qsizetype index) const { return orphanKind(index) == OrphanKind::Orphan; }
+    OrphanKind orphanKind(qsizetype index) const { return m_orphans.value(index, OrphanKind::None); }
+
+    // The local/ directory holding packages()[index]'s desc and files
+    QString entryPath(qsizetype index) const { return m_localPath + "/" + m_descStamps[index].name; }
+    // Blocking; call it from a worker
+    static LocalPackageExtras readExtras(const QString& entryPath);
+
+    // True once packages were added, removed or upgraded since this snapshot was read
+    bool isStale() const;
+    // Changes whenever any desc file or sync database this snapshot was built from changes
+    quint64 fingerprint() const { return m_fingerprint; }
+
+    // Fills pkg from the contents of a desc file; false if it has no name or version
+    static bool parseDesc(const QByteArray& data, LocalPackage* pkg);
+    // "glibc>=2.38" -> "glibc", "sh=5.2" -> "sh"
+    static QString dependencyName(const QString& dependency);
+
+private:
+    // Identifies one version of a file without reading it
+    struct FileStamp {
+        QString name;
+        qint64 mtimeNs = 0;
+        qint64 size = -1;
+        bool operator==(const FileStamp& other) const { return name == other.name && mtimeNs == other.mtimeNs && size == other.size; }
+    };
+    static FileStamp stampFile(const QString& name, const QString& path);
+
+    void resolveRepos(const QString& dbPath, const QStringList& repos, const LocalDatabase* previous);
+    void computeOrphans();
+    void computeFingerprint();
+
+    QString m_localPath;
+    qint64 m_localMtime = 0;
+    QList<LocalPackage> m_packages;
+    QList<FileStamp> m_descStamps;  // parallel to m_packages; name is the local/ entry directory
+    QList<FileStamp> m_syncStamps;  // one per repo, name is the repo
+    QList<OrphanKind> m_orphans;
+    quint64 m_fingerprint = 0;
+};
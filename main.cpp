@@ -1,9 +1,27 @@
 #include <QApplication>
+#include <QCoreApplication>
+#include <QFileInfo>
 #include <QIcon>
 #include "mainwindow.h"
+#include "privilegedhelper.h"
+#include "helperclient.h"
 
 int main(int argc, char **argv)
 {
+    // Root helper mode, started once per session through pkexec
+    if (argc >= 2 && qstrcmp(argv[1], "--privileged-helper") == 0) {
+        return PrivilegedHelper::exec(argc, argv);
+    }
+
+    // Shim mode: invoked through the uptater-op symlink to run one named root operation
+    const QString invokedName = QFileInfo(QString::fromLocal8Bit(argv[0])).fileName();
+    if (HelperClient::handles(invokedName)) {
+        QStringList args{invokedName};
+        for (int i = 1; i < argc; ++i) args << QString::fromLocal8Bit(argv[i]);
+        QCoreApplication app(argc, argv);
+        return HelperClient::exec(args);
+    }
+
     QApplication app(argc, argv);
 
     // 1.0 Application Metadata
@@ -6,8 +6,10 @@
 #include "packagemanager.h"
 #include "depcheck.h"
 #include "aboutdialog.h"
+#include "diagnosticsdialog.h"
 #include "pacmanconfigmanager.h"
 #include "reflectormanager.h"
+#include "criticalrules.h"
 
 #include <QVBoxLayout>
 #include <QMenuBar>
@@ -24,9 +26,12 @@
 #include <QSettings>
 #include <QStandardPaths>
 #include <QMessageBox>
+#include <QLocale>
+#include <QCheckBox>
 #include <QCloseEvent>
 #include <QStackedWidget>
 #include <QPushButton>
+#include <algorithm>
 
 static const QStringList DEFAULT_CRITICAL_PACKAGES = {
     "linux", "linux-lts", "linux-zen", "linux-hardened", "linux-firmware",
@@ -54,6 +59,8 @@ m_rebootPending(false)
     m_runner = new CommandRunner(m_terminalWindow, this);
     m_runner->setKeepBashHistory(m_keepBashHistory);
     m_packageManager = new PackageManager(m_runner, this);
+    // Hand-edited only: points update checks at other mirrors, e.g. a local test repo
+    m_packageManager->setSyncServers(m_settings->value("updates/syncServers").toStringList());
     m_pacmanConfigManager = new PacmanConfigManager(this);
     m_reflectorManager = new ReflectorManager(this);
 
@@ -106,7 +113,7 @@ void MainWindow::setupConnections()
     // Runner State
     connect(m_runner, &CommandRunner::commandStarted, this, [this](){
         m_buttonPanel->setEnabled(false);
-        menuBar()->setEnabled(false);
+        setMutatingActionsEnabled(false);
         m_terminalWindow->setInputEnabled(m_stack->currentIndex() == 1);
     });
 
@@ -117,7 +124,7 @@ void MainWindow::setupConnections()
         connect(m_runner, &CommandRunner::commandFinished, this, [this](){
             m_terminalWindow->setInputEnabled(false);
             m_buttonPanel->setEnabled(true);
-            menuBar()->setEnabled(true);
+            setMutatingActionsEnabled(true);
             if (m_autoSwitchedToTerminal) {
                 if (m_stack->currentIndex() == 1) onToggleView();
                 m_autoSwitchedToTerminal = false;
@@ -125,10 +132,35 @@ void MainWindow::setupConnections()
             setupInitialState();
         });
 
+        connect(m_runner, &CommandRunner::queueChanged, this, [this](){
+            m_dashboardWidget->setQueuedOperations(m_runner->queuedDescriptions());
+            m_dashboardWidget->setCancelEnabled(m_runner->isBusy() || m_runner->activeQueryCount() > 0);
+        });
+        connect(m_dashboardWidget, &DashboardWidget::cancelRequested, m_runner, &CommandRunner::cancelAll);
+        connect(m_dashboardWidget, &DashboardWidget::cancelRequested, m_packageManager, &PackageManager::cancelUpdateCheck);
+
         // Package Manager
         connect(m_packageManager, &PackageManager::updatesCheckFinished, this, &MainWindow::handleSystemUpdateCheckResult);
-        connect(m_packageManager, &PackageManager::packageListFetched, this, [this](const QStringList& lines){
-            m_dashboardWidget->showInstalledList(lines, m_criticalPackages, static_cast<DashboardWidget::PackageFilter>(m_currentFilter));
+        connect(m_packageManager, &PackageManager::installedPackagesChanged, this, [this](){
+            // Redraws a list drawn from last session's snapshot, or from before a transaction. Listing
+            // reads the database in-process, so it need not wait for a job holding the terminal.
+            if (m_viewingPackageList && m_currentFilter != 4) fetchPackageList(m_currentFilter);
+            m_packageManager->refreshStatistics();
+            compileCriticalRules();
+        });
+        connect(m_packageManager, &PackageManager::cachedPackagesChanged, this, [this](){
+            if (m_viewingPackageList && m_currentFilter == 4) fetchPackageList(4);
+            m_packageManager->refreshStatistics();
+        });
+        connect(m_packageManager, &PackageManager::statisticsChanged, m_dashboardWidget, &DashboardWidget::setStatistics);
+        connect(m_packageManager, &PackageManager::packageRowsFetched, this, [this](std::shared_ptr<const PackageTable> table, const QList<quint32>& rows){
+            m_dashboardWidget->setPackageRows(table, rows);
+        });
+        connect(m_packageManager, &PackageManager::cachedPackagesFetched, m_dashboardWidget, &DashboardWidget::setCachedPackages);
+        connect(m_packageManager, &PackageManager::fileOwnersFound, m_dashboardWidget, &DashboardWidget::setFileOwners);
+        connect(m_packageManager, &PackageManager::repositoryPackagesFound, m_dashboardWidget, &DashboardWidget::setRepositoryPackages);
+        connect(m_packageManager, &PackageManager::packageListFinished, this, [this](int){
+            m_dashboardWidget->finishInstalledList();
         });
 
         connect(m_packageManager, &PackageManager::statusMessageChanged, this, [this](const QString& msg){
@@ -143,7 +175,23 @@ void MainWindow::setupConnections()
         connect(m_dashboardWidget, &DashboardWidget::criticalPackageToggled, this, &MainWindow::onCriticalPackageToggled);
         connect(m_dashboardWidget, &DashboardWidget::rebootClicked, this, &MainWindow::onRebootSystem);
         connect(m_dashboardWidget, &DashboardWidget::deleteCachedPackageRequested, this, &MainWindow::onDeleteCachedPackage);
+        connect(m_dashboardWidget, &DashboardWidget::packageSelected, this, [this](const QString& name){
+            m_packageManager->describePackage(name, [this](const PackageDetails& details){ m_dashboardWidget->showPackageDetails(details); });
+        });
+        connect(m_dashboardWidget, &DashboardWidget::packagesNearSelection, m_packageManager, &PackageManager::prefetchPackageDetails);
         connect(m_dashboardWidget, &DashboardWidget::filterChanged, this, [this](DashboardWidget::PackageFilter f){ onFilterChanged(static_cast<int>(f)); });
+        connect(m_dashboardWidget, &DashboardWidget::searchRequested, this, [this](const QString& query){
+            // Results replace the list in place; the busy page would only flicker between keystrokes
+            auto filter = static_cast<DashboardWidget::PackageFilter>(m_currentFilter);
+            if (!m_viewingPackageList) return;
+            if (filter == DashboardWidget::PackageFilter::Files) {
+                m_dashboardWidget->beginInstalledList(filter);
+                m_packageManager->searchFiles(query);
+            } else if (filter == DashboardWidget::PackageFilter::Repository) {
+                m_dashboardWidget->beginInstalledList(filter);
+                m_packageManager->searchRepositories(query);
+            }
+        });
 
         // Managers
         connect(m_pacmanConfigManager, &PacmanConfigManager::commandRequested, this, [this](const QString& cmd, const QString& desc){
@@ -163,9 +211,9 @@ void MainWindow::setupConnections()
 
 void MainWindow::createMenuBar()
 {
-    auto *fileMenu = menuBar()->addMenu("&File");
-    fileMenu->addAction("Run Script from &URL...", this, &MainWindow::onRunScriptFromUrl);
-    fileMenu->addAction("Run &Local Script...", this, &MainWindow::onRunLocalScript);
+    m_fileMenu = menuBar()->addMenu("&File");
+    m_fileMenu->addAction("Run Script from &URL...", this, &MainWindow::onRunScriptFromUrl);
+    m_fileMenu->addAction("Run &Local Script...", this, &MainWindow::onRunLocalScript);
 
     createPacmanMenu();
     createPackagesMenu();
@@ -190,6 +238,7 @@ void MainWindow::createPackagesMenu()
 {
     auto* packagesMenu = menuBar()->addMenu("&Packages");
     packagesMenu->addAction("Show Installed", this, &MainWindow::onShowInstalledPackages);
+    m_removeOrphansAction = packagesMenu->addAction("Remove Orphans...", this, &MainWindow::onRemoveOrphans);
     packagesMenu->addSeparator();
 
     auto* cacheMenu = packagesMenu->addMenu("&Cache");
@@ -213,6 +262,11 @@ void MainWindow::createPackagesMenu()
     auto* widgetAction = new QWidgetAction(cacheMenu);
     widgetAction->setDefaultWidget(widget);
     cacheMenu->addAction(widgetAction);
+
+    auto* uninstalledAction = cacheMenu->addAction("Remove Uninstalled Packages Entirely");
+    uninstalledAction->setCheckable(true);
+    uninstalledAction->setChecked(m_removeUninstalledCache);
+    connect(uninstalledAction, &QAction::toggled, this, [this](bool c){ m_removeUninstalledCache = c; saveSettings(); });
     cacheMenu->addSeparator();
 
     m_cleanCacheAction = cacheMenu->addAction("Clean Package Cache Now", this, &MainWindow::onCleanPacmanCache);
@@ -272,8 +326,10 @@ void MainWindow::createSettingsMenu()
     });
 
     updateMenuState();
+    m_settingsMenu->addAction("Edit Critical Package Rules...", this, &MainWindow::editCriticalRules);
     m_settingsMenu->addAction("Reset Critical Package List", this, &MainWindow::resetCriticalPackages);
     m_settingsMenu->addSeparator();
+    m_settingsMenu->addAction("&Diagnostics...", this, &MainWindow::onShowDiagnostics);
     m_settingsMenu->addAction("&About", this, &MainWindow::onShowAboutDialog);
 }
 
@@ -288,12 +344,13 @@ void MainWindow::runPackageTask(const QString& busyMessage, bool requiresTermina
     }
 
     QMetaObject::Connection *conn = new QMetaObject::Connection;
-    *conn = connect(m_packageManager, &PackageManager::operationFinished, this, [this, onFinish, conn](bool success, bool cancelled){
+    *conn = connect(m_packageManager, &PackageManager::operationFinished, this, [this, onFinish, conn](bool success, bool cancelled, bool timedOut){
         QObject::disconnect(*conn);
         delete conn;
 
-        if (cancelled) {
-            m_dashboardWidget->showOperationCancelled();
+        if (cancelled || timedOut) {
+            if (timedOut) m_dashboardWidget->showOperationTimedOut();
+            else m_dashboardWidget->showOperationCancelled();
             QTimer::singleShot(2500, this, [this](){
                 // FIX: Return to the package list if that is where the user started
                 if (!m_viewingPackageList) restoreDashboardState();
@@ -318,6 +375,17 @@ void MainWindow::runPackageTask(const QString& busyMessage, bool requiresTermina
     task();
 }
 
+void MainWindow::setMutatingActionsEnabled(bool enabled)
+{
+    // Package listings stay reachable so the browser keeps working while a long job holds the terminal
+    for (QMenu* menu : {m_fileMenu, m_pacmanMenu, m_yayMenu, m_settingsMenu}) {
+        if (menu) menu->menuAction()->setEnabled(enabled);
+    }
+    if (m_cleanCacheAction) m_cleanCacheAction->setEnabled(enabled && !m_rebootPending);
+    if (m_removeOrphansAction) m_removeOrphansAction->setEnabled(enabled && !m_rebootPending);
+    if (m_clearAllCacheAction) m_clearAllCacheAction->setEnabled(enabled && !m_rebootPending);
+}
+
 void MainWindow::updateCheckButtonState()
 {
     if (m_stack->currentIndex() == 1) {
@@ -340,7 +408,7 @@ void MainWindow::updateCheckButtonState()
 
 void MainWindow::onCheckButtonClicked()
 {
-    if (m_runner->isBusy()) return;
+    if (m_runner->isBusy() || m_packageManager->isCheckingUpdates()) return;
 
     if (m_viewingPackageList && m_stack->currentIndex() == 0) {
         returnToDashboard();
@@ -356,6 +424,7 @@ void MainWindow::onCheckButtonClicked()
         m_dashboardWidget->showBusyState("Checking for system updates...");
     }
     m_packageManager->checkSystemUpdates();
+    m_dashboardWidget->setCancelEnabled(true);
 }
 
 void MainWindow::returnToDashboard()
@@ -366,8 +435,9 @@ void MainWindow::returnToDashboard()
 
 void MainWindow::restoreDashboardState()
 {
-    if (m_cleanCacheAction) m_cleanCacheAction->setEnabled(!m_rebootPending);
-    if (m_clearAllCacheAction) m_clearAllCacheAction->setEnabled(!m_rebootPending);
+    if (m_cleanCacheAction) m_cleanCacheAction->setEnabled(!m_rebootPending && !m_runner->isBusy());
+    if (m_removeOrphansAction) m_removeOrphansAction->setEnabled(!m_rebootPending && !m_runner->isBusy());
+    if (m_clearAllCacheAction) m_clearAllCacheAction->setEnabled(!m_rebootPending && !m_runner->isBusy());
 
     if (m_rebootPending) {
         m_updateState = UpdateState::Idle;
@@ -376,7 +446,7 @@ void MainWindow::restoreDashboardState()
     }
     else if (m_updateCount > 0 && !m_cachedUpdates.isEmpty()) {
         m_updateState = UpdateState::UpdatesAvailable;
-        m_dashboardWidget->showUpdatesAvailable(m_cachedUpdates, m_criticalPackages, m_cachedCriticalCount);
+        m_dashboardWidget->showUpdatesAvailable(m_cachedUpdates, m_cachedCriticalCount);
 
         QString txt = (m_offlineUpdateEnabled && DepCheck::systemUpdatePacmanInstalled())
         ? QString("Download %1 Updates && Install Next Reboot").arg(m_updateCount)
@@ -410,12 +480,13 @@ void MainWindow::onSystemUpdate()
     if (m_stack->currentIndex() == 0) m_dashboardWidget->showBusyState(isOffline ? "Downloading updates..." : "Installing updates...");
 
     QMetaObject::Connection *conn = new QMetaObject::Connection;
-    *conn = connect(m_packageManager, &PackageManager::operationFinished, this, [this, isOffline, conn](bool success, bool cancelled){
+    *conn = connect(m_packageManager, &PackageManager::operationFinished, this, [this, isOffline, conn](bool success, bool cancelled, bool timedOut){
         QObject::disconnect(*conn);
         delete conn;
 
-        if (cancelled) {
-            m_dashboardWidget->showOperationCancelled();
+        if (cancelled || timedOut) {
+            if (timedOut) m_dashboardWidget->showOperationTimedOut();
+            else m_dashboardWidget->showOperationCancelled();
             QTimer::singleShot(2500, this, [this](){ restoreDashboardState(); });
         } else if (!success) {
             m_dashboardWidget->showErrorState();
@@ -435,7 +506,7 @@ void MainWindow::onSystemUpdate()
         }
     });
 
-    m_packageManager->installSystemUpdates(isOffline, m_autoCleanCache, m_oldVersionsToKeep);
+    m_packageManager->installSystemUpdates(isOffline, m_autoCleanCache, cacheRetentionPolicy());
 }
 
 void MainWindow::handleSystemUpdateCheckResult(const QList<UpdatePackageInfo>& updates, bool error)
@@ -450,11 +521,9 @@ void MainWindow::handleSystemUpdateCheckResult(const QList<UpdatePackageInfo>& u
     updateCheckButtonState();
 
     m_cachedUpdates = updates;
-    m_cachedCriticalCount = 0;
-    for (const auto& pkg : updates) {
-        if (m_criticalPackages.contains(pkg.name)) m_cachedCriticalCount++;
-    }
-    m_updateCount = updates.size();
+    // Ignored packages are shown but pacman -Syu won't touch them, so they don't count
+    m_updateCount = int(std::count_if(updates.cbegin(), updates.cend(), [](const UpdatePackageInfo& pkg){ return !pkg.ignored; }));
+    m_cachedCriticalCount = countCriticalUpdates();
 
     if (m_updateCount > 0) {
         m_updateState = UpdateState::UpdatesAvailable;
@@ -500,17 +569,94 @@ void MainWindow::resetSystemUpdateState(const QString& message)
 
 // --- Menu Handlers & Utilities ---
 
-void MainWindow::onCleanPacmanCache() { runPackageTask("Cleaning pacman cache...", false, [this](){ m_packageManager->cleanCache(m_oldVersionsToKeep); }); }
+void MainWindow::onCleanPacmanCache()
+{
+    // Nothing is deleted until the user has seen exactly what goes and how much it frees
+    m_packageManager->planCacheCleanup(cacheRetentionPolicy(), [this](const CacheCleanupPlan& plan){
+        if (plan.isEmpty()) {
+            QMessageBox::information(this, "Clean Package Cache", "Nothing to clean: the cache already matches the retention settings.");
+            return;
+        }
+
+        QStringList details;
+        for (const CachedPackage& pkg : plan.removals) {
+            details << QString("%1  (%2)").arg(pkg.path, QLocale().formattedDataSize(pkg.size));
+        }
+
+        QMessageBox box(QMessageBox::Question, "Clean Package Cache",
+                        QString("%1 cached package files will be removed, freeing %2.\n%3 files are kept.\n\nContinue?")
+                            .arg(plan.removals.size()).arg(QLocale().formattedDataSize(plan.reclaimableBytes)).arg(plan.keptCount),
+                        QMessageBox::Yes | QMessageBox::No, this);
+        box.setDefaultButton(QMessageBox::No);
+        box.setDetailedText(details.join('\n'));
+        if (box.exec() != QMessageBox::Yes) return;
+
+        runPackageTask("Cleaning pacman cache...", false, [this, plan](){ m_packageManager->cleanCache(plan); }, [this](){
+            if (m_viewingPackageList && m_currentFilter == 4) fetchPackageList(4);
+        });
+    });
+}
+
+void MainWindow::onRemoveOrphans()
+{
+    m_packageManager->planOrphanRemoval([this](const OrphanRemovalPlan& plan){
+        if (plan.isEmpty()) {
+            QMessageBox::information(this, "Remove Orphans", "No orphan packages found.");
+            return;
+        }
+
+        QLocale locale;
+        QString text = QString("%1 packages are no longer needed by anything installed explicitly, freeing %2.")
+                           .arg(plan.removable.size()).arg(locale.formattedDataSize(plan.removableBytes));
+        QString details = "Orphans and their exclusive dependencies:\n" + plan.removable.join('\n');
+        if (!plan.optionalOnly.isEmpty()) {
+            details += "\n\nOnly optional dependencies of other packages:\n" + plan.optionalOnly.join('\n');
+        }
+
+        QMessageBox box(QMessageBox::Question, "Remove Orphans", text + "\n\nRemove them in one transaction?", QMessageBox::Yes | QMessageBox::No, this);
+        box.setDefaultButton(QMessageBox::No);
+        box.setDetailedText(details);
+        QCheckBox* optionalBox = nullptr;
+        if (!plan.optionalOnly.isEmpty()) {
+            optionalBox = new QCheckBox(QString("Also remove %1 optional-only dependencies (%2)")
+                                            .arg(plan.optionalOnly.size()).arg(locale.formattedDataSize(plan.optionalOnlyBytes)));
+            box.setCheckBox(optionalBox);
+        }
+        if (box.exec() != QMessageBox::Yes) return;
+
+        QStringList names = plan.removable;
+        if (optionalBox && optionalBox->isChecked()) names += plan.optionalOnly;
+        if (names.isEmpty()) return;
+
+        runPackageTask("Removing orphan packages...", false, [this, names](){ m_packageManager->removePackages(names); });
+    });
+}
+
+CacheRetentionPolicy MainWindow::cacheRetentionPolicy() const
+{
+    // The installed version counts towards paccache's -k, on top of the old ones the user keeps
+    CacheRetentionPolicy policy;
+    policy.keepVersions = m_oldVersionsToKeep + 1;
+    policy.keepUninstalled = m_removeUninstalledCache ? 0 : -1;
+    return policy;
+}
 void MainWindow::onShowAboutDialog() { AboutDialog(this).exec(); }
+void MainWindow::onShowDiagnostics() { DiagnosticsDialog(m_runner, this).exec(); }
 void MainWindow::onShowInstalledPackages() { fetchPackageList(1); }
 void MainWindow::onFilterChanged(int filter) { fetchPackageList(filter); }
 
-void MainWindow::onDeleteCachedPackage(const QString& fileName) {
+void MainWindow::onDeleteCachedPackage(const QString& filePath) {
     if (m_rebootPending) {
         QMessageBox::warning(this, "Action Blocked", "Cannot delete cached packages while an offline update is pending.");
         return;
     }
-    runPackageTask("", false, [this, fileName](){ m_packageManager->deleteCachedPackage(fileName); }, [this](){
+    // Behind a running job the deletion just joins the queue; the CacheDir watcher redraws the
+    // list once it has run, and the running job keeps its own finish handling
+    if (m_runner->isBusy()) {
+        m_packageManager->deleteCachedPackage(filePath);
+        return;
+    }
+    runPackageTask("", false, [this, filePath](){ m_packageManager->deleteCachedPackage(filePath); }, [this](){
         if (m_viewingPackageList && m_currentFilter == 4) fetchPackageList(4);
     });
 }
@@ -520,26 +666,80 @@ void MainWindow::fetchPackageList(int filter) {
     m_viewingPackageList = true;
     updateCheckButtonState();
     if (m_stack->currentIndex() == 0) m_dashboardWidget->showBusyState("Listing packages...");
-    m_packageManager->fetchPackageList(static_cast<DashboardWidget::PackageFilter>(filter));
+    m_dashboardWidget->beginInstalledList(static_cast<DashboardWidget::PackageFilter>(filter));
+    switch (static_cast<DashboardWidget::PackageFilter>(filter)) {
+        case DashboardWidget::PackageFilter::Files: m_packageManager->searchFiles(m_dashboardWidget->searchText()); break;
+        case DashboardWidget::PackageFilter::Repository: m_packageManager->searchRepositories(m_dashboardWidget->searchText()); break;
+        default: m_packageManager->fetchPackageList(static_cast<DashboardWidget::PackageFilter>(filter)); break;
+    }
 }
 
 void MainWindow::onCriticalPackageToggled(const QString& name, bool isCritical) {
-    if (isCritical) { if (!m_criticalPackages.contains(name)) m_criticalPackages.append(name); }
-    else { m_criticalPackages.removeAll(name); }
+    // Before the first compile there is nothing to ask whether a pattern covers name
+    if (m_criticalSet) {
+        m_criticalRules = m_criticalSet->toggled(m_criticalRules, name, isCritical);
+    } else if (isCritical) {
+        if (!m_criticalRules.contains(name)) m_criticalRules.append(name);
+    } else {
+        m_criticalRules.removeAll(name);
+    }
     saveCriticalPackages();
+    compileCriticalRules();
 }
 
 void MainWindow::loadCriticalPackages() {
-    m_criticalPackages = m_settings->value("updates/criticalPackages").toStringList();
-    if (m_criticalPackages.isEmpty()) m_criticalPackages = DEFAULT_CRITICAL_PACKAGES;
+    // Plain names from before rules existed are rules too
+    m_criticalRules = m_settings->value("updates/criticalPackages").toStringList();
+    if (m_criticalRules.isEmpty()) m_criticalRules = DEFAULT_CRITICAL_PACKAGES;
+}
+
+void MainWindow::saveCriticalPackages() { m_settings->setValue("updates/criticalPackages", m_criticalRules); }
+
+void MainWindow::compileCriticalRules() {
+    m_packageManager->compileCriticalRules(m_criticalRules, [this](std::shared_ptr<const CriticalSet> critical){ applyCriticalSet(critical); });
+}
+
+void MainWindow::applyCriticalSet(std::shared_ptr<const CriticalSet> critical) {
+    m_criticalSet = critical;
+    m_dashboardWidget->setCriticalSet(critical);
+
+    int count = countCriticalUpdates();
+    if (count == m_cachedCriticalCount) return;
+    m_cachedCriticalCount = count;
+    if (m_updateState == UpdateState::UpdatesAvailable && !m_viewingPackageList && !m_runner->isBusy()) restoreDashboardState();
 }
 
-void MainWindow::saveCriticalPackages() { m_settings->setValue("updates/criticalPackages", m_criticalPackages); }
+int MainWindow::countCriticalUpdates() const {
+    if (!m_criticalSet) return 0;
+    QStringList names;
+    for (const auto& pkg : m_cachedUpdates) {
+        if (!pkg.ignored) names.append(pkg.name);
+    }
+    return m_criticalSet->countIn(m_criticalSet->maskOf(names));
+}
+
+void MainWindow::editCriticalRules() {
+    bool ok = false;
+    QString text = QInputDialog::getMultiLineText(this, "Critical Package Rules",
+        "One rule per line: a name, a glob (linux*, nvidia-*), group:NAME, repo:NAME (repo:foreign),\n"
+        "deps:NAME for a package and everything it depends on, or !RULE to exclude. Lines starting with # are ignored.",
+        m_criticalRules.join('\n'), &ok);
+    if (!ok) return;
+
+    QStringList rules;
+    for (const QString& line : text.split('\n')) {
+        if (!line.trimmed().isEmpty()) rules.append(line.trimmed());
+    }
+    m_criticalRules = rules.isEmpty() ? DEFAULT_CRITICAL_PACKAGES : rules;
+    saveCriticalPackages();
+    compileCriticalRules();
+}
 
 void MainWindow::resetCriticalPackages() {
     if (QMessageBox::question(this, "Reset Critical List", "Reset list to default?", QMessageBox::Yes|QMessageBox::No) == QMessageBox::Yes) {
-        m_criticalPackages = DEFAULT_CRITICAL_PACKAGES;
+        m_criticalRules = DEFAULT_CRITICAL_PACKAGES;
         saveCriticalPackages();
+        compileCriticalRules();
         QMessageBox::information(this, "Reset", "Critical packages list reset.");
     }
 }
@@ -596,7 +796,7 @@ void MainWindow::onRunScriptFromUrl() {
         runPackageTask("", true, [this, url](){
             QString escapedUrl = url;
             escapedUrl.replace("'", "'\\''");
-            m_packageManager->runRawCommand(QString("curl -sSL '%1' | bash").arg(escapedUrl), "Running script from URL...");
+            m_packageManager->runRawCommand(QString("curl -sSL '%1' | bash").arg(escapedUrl), "Running script from URL...", false);
         });
     }
 }
@@ -607,7 +807,7 @@ void MainWindow::onRunLocalScript() {
         runPackageTask("", true, [this, filePath](){
             QString escapedPath = filePath;
             escapedPath.replace("'", "'\\''");
-            m_packageManager->runRawCommand("bash '" + escapedPath + "'", "Running local script: " + QFileInfo(filePath).fileName());
+            m_packageManager->runRawCommand("bash '" + escapedPath + "'", "Running local script: " + QFileInfo(filePath).fileName(), false);
         });
     }
 }
@@ -642,9 +842,12 @@ void MainWindow::onRebootSystem() { QProcess::startDetached("systemctl", {"reboo
 
 void MainWindow::setupInitialState() {
     loadCriticalPackages();
+    compileCriticalRules();
     setupYay();
     m_reflectorManager->setup();
     updateMenuState();
+    // Only the parts whose database, cache or log changed are read again
+    m_packageManager->refreshStatistics();
 }
 
 void MainWindow::setupYay() {
@@ -686,6 +889,7 @@ void MainWindow::setupPacmanMiscMenu() {
 void MainWindow::loadSettings() {
     m_oldVersionsToKeep = m_settings->value("cache/oldVersionsToKeep", 1).toInt();
     m_autoCleanCache = m_settings->value("updates/cleanAfterUpdate", true).toBool();
+    m_removeUninstalledCache = m_settings->value("cache/removeUninstalled", false).toBool();
     m_checkOnStartup = m_settings->value("updates/checkOnStartup", false).toBool();
     m_offlineUpdateEnabled = m_settings->value("updates/offlineUpdateEnabled", false).toBool();
     m_keepBashHistory = m_settings->value("settings/keepBashHistory", false).toBool(); // Defaults to false
@@ -694,6 +898,7 @@ void MainWindow::loadSettings() {
 void MainWindow::saveSettings() {
     m_settings->setValue("cache/oldVersionsToKeep", m_oldVersionsToKeep);
     m_settings->setValue("updates/cleanAfterUpdate", m_autoCleanCache);
+    m_settings->setValue("cache/removeUninstalled", m_removeUninstalledCache);
     m_settings->setValue("updates/checkOnStartup", m_checkOnStartup);
     m_settings->setValue("updates/offlineUpdateEnabled", m_offlineUpdateEnabled);
     m_settings->setValue("settings/keepBashHistory", m_keepBashHistory); // Save state
@@ -4,9 +4,11 @@
 #include <QStringList>
 #include <QDateTime>
 #include <QList>
+#include <memory>
 #include <functional>
 #include <QMetaObject>
 #include "dashboardwidget.h"
+#include "cacheplanner.h"
 
 class QStackedWidget;
 class ButtonPanel;
@@ -16,6 +18,7 @@ class PacmanConfigManager;
 class ReflectorManager;
 class CommandRunner;
 class PackageManager;
+class CriticalSet;
 class QMenu;
 class QAction;
 class QPushButton;
@@ -38,14 +41,17 @@ private slots:
     void onRebootSystem();
     void onToggleView();
     void onShowAboutDialog();
+    void onShowDiagnostics();
 
     // Package & Cache Management
     void onCleanPacmanCache();
-    void onDeleteCachedPackage(const QString& fileName);
+    void onRemoveOrphans();
+    void onDeleteCachedPackage(const QString& filePath);
     void onShowInstalledPackages();
     void onFilterChanged(int filter);
     void onCriticalPackageToggled(const QString& name, bool isCritical);
     void resetCriticalPackages();
+    void editCriticalRules();
 
     // Settings & Scripts
     void onSetupOfflineUpdates();
@@ -69,6 +75,7 @@ private:
     void setupYay();
     void setupPacmanMiscMenu();
     void updateMenuState();
+    void setMutatingActionsEnabled(bool enabled);
 
     // --- Core Logic ---
     void runPackageTask(const QString& busyMessage, bool requiresTerminal, std::function<void()> task, std::function<void()> onFinish = nullptr);
@@ -79,8 +86,13 @@ private:
 
     void loadSettings();
     void saveSettings();
+    CacheRetentionPolicy cacheRetentionPolicy() const;
     void loadCriticalPackages();
     void saveCriticalPackages();
+    // Recompiles the rules against the current database, then recounts and redraws
+    void compileCriticalRules();
+    void applyCriticalSet(std::shared_ptr<const CriticalSet> critical);
+    int countCriticalUpdates() const;
     void fetchPackageList(int filter);
     void returnToDashboard();
     void restoreDashboardState();
@@ -102,12 +114,14 @@ private:
     QSettings *m_settings;
 
     // --- Menu Actions ---
+    QMenu *m_fileMenu;
     QMenu *m_pacmanMenu;
     QMenu *m_yayMenu;
     QMenu *m_settingsMenu;
     QMenu *m_yayInstallMenu;
 
     QAction *m_cleanCacheAction;
+    QAction *m_removeOrphansAction;
     QAction *m_clearAllCacheAction;
     QAction *m_yayUpdateAction;
     QAction *m_yayCleanAction;
@@ -135,11 +149,14 @@ private:
     bool m_lastCheckFailed;
     bool m_rebootPending;
     bool m_autoCleanCache;
+    bool m_removeUninstalledCache;
     bool m_checkOnStartup;
     bool m_offlineUpdateEnabled;
     bool m_keepBashHistory;
 
-    QStringList m_criticalPackages;
+    // Critical-package rules as saved; see CriticalSet for the syntax
+    QStringList m_criticalRules;
+    std::shared_ptr<const CriticalSet> m_criticalSet;
     QList<UpdatePackageInfo> m_cachedUpdates;
     QDateTime m_lastCheckedTime;
     QDateTime m_lastUpgradedTime;
@@ -0,0 +1,380 @@
+#include "packagelistmodel.h"
+#include "packagetable.h"
+#include "criticalrules.h"
+#include "vercmp.h"
+#include <QDateTime>
+#include <QFont>
+#include <QLocale>
+#include <QGuiApplication>
+#include <QPalette>
+#include <algorithm>
+#include <numeric>
+
+PackageListModel::PackageListModel(QObject* parent)
+: QAbstractItemModel(parent)
+{
+    m_headers = {"Name", "Version"};
+}
+
+void PackageListModel::resetTo(Kind kind, Origin origin, const std::function<void()>& fill)
+{
+    beginResetModel();
+    m_kind = kind;
+    m_origin = origin;
+    m_table.reset();
+    m_rows.clear();
+    m_updates.clear();
+    m_cache.clear();
+    m_owners.clear();
+    m_search.clear();
+
+    switch (kind) {
+        case Kind::Installed:
+        case Kind::Orphans:    m_headers = {"Name", "Version", "Repository", "Size", "Installed"}; break;
+        case Kind::Updates:    m_headers = {"Name", "Version", "Repository", "Download"}; break;
+        case Kind::Cache:      m_headers = {"Package", "Version", "Arch", "Size", "Modified"}; break;
+        case Kind::Files:      m_headers = {"Path", "Package", "Source"}; break;
+        case Kind::Repository: m_headers = {"Name", "Version", "Repository", "Installed"}; break;
+    }
+    if (fill) fill();
+    endResetModel();
+}
+
+void PackageListModel::clear(Kind kind)
+{
+    Origin origin = InstalledOrigin;
+    switch (kind) {
+        case Kind::Updates:    origin = OfficialOrigin; break;
+        case Kind::Cache:      origin = CacheOrigin; break;
+        case Kind::Files:      origin = FileOrigin; break;
+        case Kind::Repository: origin = RepositoryOrigin; break;
+        default: break;
+    }
+    resetTo(kind, origin, nullptr);
+}
+
+void PackageListModel::setInstalled(Kind kind, Origin origin, std::shared_ptr<const PackageTable> table, const QList<quint32>& rows)
+{
+    // The row list is shared, not copied; names are only read when a row is drawn
+    resetTo(kind, origin, [&](){
+        m_table = std::move(table);
+        m_rows = rows;
+    });
+}
+
+void PackageListModel::setUpdates(const QList<UpdatePackageInfo>& updates)
+{
+    resetTo(Kind::Updates, OfficialOrigin, [&](){
+        m_updates = updates;
+        std::sort(m_updates.begin(), m_updates.end(), [this](const UpdatePackageInfo& a, const UpdatePackageInfo& b) {
+            return compareUpdates(a, b, -1) < 0;
+        });
+    });
+}
+
+void PackageListModel::setCachedPackages(const QList<CachedPackage>& packages)
+{
+    resetTo(Kind::Cache, CacheOrigin, [&](){ m_cache = packages; });
+}
+
+void PackageListModel::setFileOwners(const QList<FileOwner>& owners)
+{
+    resetTo(Kind::Files, FileOrigin, [&](){ m_owners = owners; });
+}
+
+void PackageListModel::setRepositoryPackages(const QList<PackageSearchResult>& packages)
+{
+    resetTo(Kind::Repository, RepositoryOrigin, [&](){ m_search = packages; });
+}
+
+void PackageListModel::setCriticalSet(std::shared_ptr<const CriticalSet> critical)
+{
+    m_critical = std::move(critical);
+    if (rowCount() > 0) emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1), {Qt::FontRole, CriticalRole});
+}
+
+bool PackageListModel::isCritical(int row) const
+{
+    return m_critical && m_critical->contains(packageName(row));
+}
+
+QString PackageListModel::packageName(int row) const
+{
+    if (row < 0 || row >= rowCount()) return QString();
+    switch (m_kind) {
+        case Kind::Installed:
+        case Kind::Orphans:    return m_table->nameString(m_rows[row]);
+        case Kind::Updates:    return m_updates[row].name;
+        case Kind::Cache:      return m_cache[row].name;
+        case Kind::Files:      return m_owners[row].package;
+        case Kind::Repository: return m_search[row].name;
+    }
+    return QString();
+}
+
+int PackageListModel::findPackage(const QString& name) const
+{
+    if (m_kind == Kind::Installed || m_kind == Kind::Orphans) {
+        // Compared as UTF-8 views, without building a QString per row
+        QByteArray utf8 = name.toUtf8();
+        for (int row = 0; row < m_rows.size(); ++row) {
+            if (m_table->name(m_rows[row]) == QByteArrayView(utf8)) return row;
+        }
+        return -1;
+    }
+    for (int row = 0; row < rowCount(); ++row) {
+        if (packageName(row) == name) return row;
+    }
+    return -1;
+}
+
+QModelIndex PackageListModel::index(int row, int column, const QModelIndex& parent) const
+{
+    if (parent.isValid() || row < 0 || row >= rowCount() || column < 0 || column >= columnCount()) return QModelIndex();
+    return createIndex(row, column);
+}
+
+QModelIndex PackageListModel::parent(const QModelIndex&) const
+{
+    return QModelIndex();
+}
+
+int PackageListModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    switch (m_kind) {
+        case Kind::Installed:
+        case Kind::Orphans:    return int(m_rows.size());
+        case Kind::Updates:    return int(m_updates.size());
+        case Kind::Cache:      return int(m_cache.size());
+        case Kind::Files:      return int(m_owners.size());
+        case Kind::Repository: return int(m_search.size());
+    }
+    return 0;
+}
+
+int PackageListModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : int(m_headers.size());
+}
+
+QString PackageListModel::text(int row, int column) const
+{
+    QLocale locale;
+    switch (m_kind) {
+        case Kind::Installed:
+        case Kind::Orphans: {
+            quint32 id = m_rows[row];
+            switch (column) {
+                case 0: return m_table->nameString(id);
+                case 1: {
+                    QString detail = m_table->versionString(id);
+                    // Alongside the version: why an orphan is unneeded
+                    if (m_kind == Kind::Orphans && m_table->orphanKind(id) == OrphanKind::RecursiveOrphan) detail += "  (only needed by orphans)";
+                    else if (m_kind == Kind::Orphans && m_table->orphanKind(id) == OrphanKind::OptionalOnly) detail += "  (optional dependency only)";
+                    return detail;
+                }
+                case 2: return m_table->isForeign(id) ? QString("foreign") : QString::fromUtf8(m_table->repo(id));
+                case 3: return locale.formattedDataSize(m_table->installedSize(id));
+                case 4: return locale.toString(QDateTime::fromSecsSinceEpoch(m_table->installDate(id)).date(), QLocale::ShortFormat);
+            }
+            break;
+        }
+        case Kind::Updates: {
+            const UpdatePackageInfo& pkg = m_updates[row];
+            switch (column) {
+                case 0: return pkg.name;
+                case 1: {
+                    QString version = QString("%1 -> %2").arg(pkg.oldVersion, pkg.newVersion);
+                    if (pkg.ignored) version += " [ignored]";
+                    return version;
+                }
+                case 2: return pkg.repo;
+                case 3: return pkg.repo.isEmpty() ? QString() : locale.formattedDataSize(pkg.downloadSize);
+            }
+            break;
+        }
+        case Kind::Cache: {
+            const CachedPackage& pkg = m_cache[row];
+            switch (column) {
+                case 0: return pkg.name;
+                case 1: return pkg.version;
+                case 2: return pkg.arch;
+                case 3: return locale.formattedDataSize(pkg.size, 1, QLocale::DataSizeTraditionalFormat);
+                case 4: return locale.toString(QDateTime::fromSecsSinceEpoch(pkg.modified), QLocale::ShortFormat);
+            }
+            break;
+        }
+        case Kind::Files: {
+            const FileOwner& owner = m_owners[row];
+            switch (column) {
+                case 0: return owner.path;
+                case 1: return owner.package;
+                case 2: return owner.isInstalled() ? "installed" : owner.repo;
+            }
+            break;
+        }
+        case Kind::Repository: {
+            const PackageSearchResult& pkg = m_search[row];
+            switch (column) {
+                case 0: return pkg.name;
+                case 1: return pkg.version;
+                case 2: return pkg.repo;
+                case 3: return pkg.installedVersion;
+            }
+            break;
+        }
+    }
+    return QString();
+}
+
+QString PackageListModel::toolTip(int row, int column) const
+{
+    switch (m_kind) {
+        case Kind::Installed:
+        case Kind::Orphans:
+            if (column == 0) return "Double-click to toggle Critical Status\nRight-click for online package info";
+            break;
+        case Kind::Updates: {
+            const UpdatePackageInfo& pkg = m_updates[row];
+            if (column == 0) return "Double-click to toggle Critical Status\nRight-click for online package info";
+            if (pkg.repo.isEmpty()) break;
+            QLocale locale;
+            return QString("Repository: %1\nDownload: %2\nInstalled size: %3%4")
+                .arg(pkg.repo, locale.formattedDataSize(pkg.downloadSize), pkg.installedSizeDelta < 0 ? "-" : "+",
+                     locale.formattedDataSize(qAbs(pkg.installedSizeDelta)));
+        }
+        case Kind::Cache: {
+            const CachedPackage& pkg = m_cache[row];
+            if (column == 0) return pkg.hasSignature ? QString("%1\nSigned (%2.sig)").arg(pkg.path, pkg.fileName) : pkg.path;
+            break;
+        }
+        case Kind::Files:
+            if (column == 0) return m_owners[row].path;
+            break;
+        case Kind::Repository:
+            if (column == 0) return m_search[row].description;
+            break;
+    }
+    return QString();
+}
+
+bool PackageListModel::isBold(int row) const
+{
+    switch (m_kind) {
+        case Kind::Installed:
+        case Kind::Orphans:
+        case Kind::Updates:    return isCritical(row);
+        case Kind::Repository: return m_search[row].isInstalled();
+        default:               return false;
+    }
+}
+
+QVariant PackageListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) return QVariant();
+    const int row = index.row();
+
+    switch (role) {
+        case Qt::DisplayRole: return text(row, index.column());
+        case Qt::ToolTipRole: {
+            QString tip = toolTip(row, index.column());
+            return tip.isEmpty() ? QVariant() : QVariant(tip);
+        }
+        case Qt::FontRole: {
+            // Installed search results are only marked in their name column
+            if (!isBold(row) || (m_kind == Kind::Repository && index.column() != 0)) return QVariant();
+            QFont font;
+            font.setBold(true);
+            return font;
+        }
+        case Qt::ForegroundRole:
+            // pacman -Syu will hold these back, so they are listed but muted
+            if (m_kind == Kind::Updates && m_updates[row].ignored) return QGuiApplication::palette().color(QPalette::Disabled, QPalette::Text);
+            return QVariant();
+        case CriticalRole: return isCritical(row);
+        case OriginRole:   return int(m_origin);
+        case PathRole:     return m_kind == Kind::Cache ? QVariant(m_cache[row].path) : QVariant();
+        case PackageRole:  return packageName(row);
+    }
+    return QVariant();
+}
+
+QVariant PackageListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole || section < 0 || section >= m_headers.size()) return QVariant();
+    return m_headers[section];
+}
+
+static int compareNumbers(qint64 a, qint64 b)
+{
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+int PackageListModel::compareUpdates(const UpdatePackageInfo& a, const UpdatePackageInfo& b, int column) const
+{
+    switch (column) {
+        case 0: return a.name.compare(b.name, Qt::CaseInsensitive);
+        case 1: return vercmp(a.newVersion, b.newVersion);
+        case 2: return a.repo.compare(b.repo);
+        case 3: return compareNumbers(a.downloadSize, b.downloadSize);
+        default: {
+            // Unsorted: critical packages first, then by name
+            bool aCrit = m_critical && m_critical->contains(a.name);
+            bool bCrit = m_critical && m_critical->contains(b.name);
+            if (aCrit != bCrit) return aCrit ? -1 : 1;
+            return a.name.compare(b.name, Qt::CaseInsensitive);
+        }
+    }
+}
+
+static int compareCached(const CachedPackage& a, const CachedPackage& b, int column)
+{
+    switch (column) {
+        case 1: return vercmp(a.version, b.version);
+        case 2: return a.arch.compare(b.arch, Qt::CaseInsensitive);
+        case 3: return compareNumbers(a.size, b.size);
+        case 4: return compareNumbers(a.modified, b.modified);
+        default: return a.name.compare(b.name, Qt::CaseInsensitive);
+    }
+}
+
+// Puts records into the order of sorted (old row numbers) and returns where each old row went
+template <typename T>
+static QList<int> permute(QList<T>& records, const QList<int>& sorted)
+{
+    QList<int> newRow(records.size());
+    QList<T> reordered;
+    reordered.reserve(records.size());
+    for (int i = 0; i < sorted.size(); ++i) {
+        newRow[sorted[i]] = i;
+        reordered.append(records[sorted[i]]);
+    }
+    records = reordered;
+    return newRow;
+}
+
+void PackageListModel::sort(int column, Qt::SortOrder order)
+{
+    if (m_kind != Kind::Cache && m_kind != Kind::Updates) return;
+
+    // Stable, so rows equal under column keep their previous relative order
+    QList<int> sorted(rowCount());
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::stable_sort(sorted.begin(), sorted.end(), [&](int a, int b){
+        int result = m_kind == Kind::Cache ? compareCached(m_cache[a], m_cache[b], column)
+                                           : compareUpdates(m_updates[a], m_updates[b], column);
+        return order == Qt::AscendingOrder ? result < 0 : result > 0;
+    });
+
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    QList<int> newRow = m_kind == Kind::Cache ? permute(m_cache, sorted) : permute(m_updates, sorted);
+
+    // Selection and the current row follow their packages
+    const QModelIndexList before = persistentIndexList();
+    QModelIndexList after;
+    after.reserve(before.size());
+    for (const QModelIndex& index : before) after.append(createIndex(newRow[index.row()], index.column()));
+    changePersistentIndexList(before, after);
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QAbstractItemModel>
+#include <QStringList>
+#include <functional>
+#include <memory>
+#include "cachescanner.h"
+#include "fileindex.h"
+#include "packagesearch.h"
+
+class PackageTable;
+class CriticalSet;
+
+struct UpdatePackageInfo {
+    QString name;
+    QString oldVersion;
+    QString newVersion;
+    bool ignored = false;        // matched by IgnorePkg/IgnoreGroup; pacman -Syu will skip it
+    QString repo;
+    qint64 downloadSize = 0;     // bytes
+    qint64 installedSizeDelta = 0;
+};
+
+// Rows of the dashboard list. A listing keeps its records as they arrived (row ids into the
+// package table, or the update, cache and search results) and data() formats only the cells
+// the view asks for, so replacing a listing costs the same for ten packages or ten thousand.
+class PackageListModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum class Kind { Installed, Orphans, Updates, Cache, Files, Repository };
+    // Where a row's package comes from, for the context menu
+    enum Origin { OfficialOrigin, AurOrigin, InstalledOrigin, CacheOrigin, FileOrigin, RepositoryOrigin };
+    enum Role {
+        CriticalRole = Qt::UserRole,
+        OriginRole,
+        PathRole,           // cached package file
+        PackageRole         // package a row stands for, also where column 0 holds something else
+    };
+
+    explicit PackageListModel(QObject* parent = nullptr);
+
+    Kind kind() const { return m_kind; }
+    // Each of these replaces the listing in one reset
+    void clear(Kind kind);
+    void setInstalled(Kind kind, Origin origin, std::shared_ptr<const PackageTable> table, const QList<quint32>& rows);
+    // Critical packages first, then by name
+    void setUpdates(const QList<UpdatePackageInfo>& updates);
+    void setCachedPackages(const QList<CachedPackage>& packages);
+    void setFileOwners(const QList<FileOwner>& owners);
+    void setRepositoryPackages(const QList<PackageSearchResult>& packages);
+
+    // Null until the rules are first compiled; nothing is critical until then
+    void setCriticalSet(std::shared_ptr<const CriticalSet> critical);
+    bool isCritical(int row) const;
+
+    QString packageName(int row) const;
+    // First row standing for name, or -1
+    int findPackage(const QString& name) const;
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& child) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    // Sorts the cache and update listings in place; a column of -1 restores the update list's
+    // critical-first order. Installed listings are sorted by PackageQuery along with filtering.
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+private:
+    void resetTo(Kind kind, Origin origin, const std::function<void()>& fill);
+    QString text(int row, int column) const;
+    QString toolTip(int row, int column) const;
+    bool isBold(int row) const;
+    int compareUpdates(const UpdatePackageInfo& a, const UpdatePackageInfo& b, int column) const;
+
+    Kind m_kind = Kind::Installed;
+    Origin m_origin = InstalledOrigin;
+    QStringList m_headers;
+    std::shared_ptr<const CriticalSet> m_critical;
+
+    // Only the list for m_kind is filled
+    std::shared_ptr<const PackageTable> m_table;
+    QList<quint32> m_rows;
+    QList<UpdatePackageInfo> m_updates;
+    QList<CachedPackage> m_cache;
+    QList<FileOwner> m_owners;
+    QList<PackageSearchResult> m_search;
+};
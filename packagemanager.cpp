@@ -1,133 +1,938 @@
 #include "packagemanager.h"
 #include "commandrunner.h"
-#include <QRegularExpression>
+#include "localdatabase.h"
+#include "syncdatabase.h"
+#include "updatecalculator.h"
+#include "syncdbfetcher.h"
+#include "cachescanner.h"
+#include "cacheplanner.h"
+#include "dependencygraph.h"
+#include "criticalrules.h"
+#include "packagetable.h"
+#include "fileindex.h"
+#include "packagesearch.h"
+#include "systemstats.h"
+#include "pacmanconfigmanager.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QSaveFile>
+#include <QSet>
+#include <QLocale>
+#include <QFutureWatcher>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+// Single-quoted for bash, so paths with spaces or quotes stay one word
+static QString shellQuote(const QString& value)
+{
+    QString quoted = value;
+    quoted.replace("'", "'\\''");
+    return "'" + quoted + "'";
+}
+
+// Long target lists would overflow the terminal's input line, so root jobs read them with
+// xargs -0 from a file instead. Returns the file's path, or an empty string if it can't be written.
+static QString writeTargetList(const QString& fileName, const QStringList& targets)
+{
+    QString listPath = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath(fileName);
+    QDir().mkpath(QFileInfo(listPath).absolutePath());
+
+    QSaveFile list(listPath);
+    if (!list.open(QIODevice::WriteOnly)) return QString();
+    for (const QString& target : targets) {
+        if (list.write(QFile::encodeName(target) + '\0') <= 0) return QString();
+    }
+    return list.commit() ? listPath : QString();
+}
 
 PackageManager::PackageManager(CommandRunner* runner, QObject* parent)
 : QObject(parent), m_runner(runner)
 {
-}
+    QString configPath = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation);
+    m_localDbSnapshotPath = QDir(configPath).filePath("uptater-localdb.bin");
+    m_syncDbPath = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("sync-db") + "/";
+    m_fileIndexPath = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("files.idx");
+    m_searchIndexPath = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("search.idx");
+    // A few thousand packages' worth, far more than anyone scrolls through between database changes
+    m_detailsCache.setMaxCost(4 * 1024 * 1024);
+
+    // Unchanged repos are skipped by the fetcher but still part of the comparison
+    m_syncFetcher = new SyncDatabaseFetcher(this);
+    connect(m_syncFetcher, &SyncDatabaseFetcher::finished, this, [this](bool success, int){
+        m_searchIndexDirty = true;
+        if (!success) {
+            emit updatesCheckFinished({}, true);
+            return;
+        }
+        emit statusMessageChanged("Comparing package versions...");
+        computeUpdates(m_syncDbPath);
+    });
+
+    watchPacmanDirectories();
+
+    // Last session's snapshot answers the first listing; the live database is checked right after
+    m_localDbLoading = true;
+    auto *watcher = new QFutureWatcher<std::shared_ptr<LocalDatabase>>(this);
+    connect(watcher, &QFutureWatcher<std::shared_ptr<LocalDatabase>>::finished, this, [this, watcher](){
+        std::shared_ptr<const LocalDatabase> snapshot = watcher->result();
+        watcher->deleteLater();
+        m_localDbLoading = false;
 
-static QString stripAnsi(const QString& input) {
-    static const QRegularExpression ansiRegex(R"(\x1B\[[0-9;]*[a-zA-Z])");
-    QString result = input;
-    result.remove(ansiRegex);
-    return result;
+        if (snapshot && !m_localDb) {
+            m_localDb = snapshot;
+            m_localDbProvisional = true;
+            m_localDbServedFingerprint = snapshot->fingerprint();
+            const auto waiters = std::exchange(m_localDbWaiters, {});
+            for (const auto& waiter : waiters) waiter(snapshot);
+        }
+        refreshLocalDatabase();
+    });
+    QString snapshotPath = m_localDbSnapshotPath;
+    watcher->setFuture(QtConcurrent::run([snapshotPath](){ return LocalDatabase::loadSnapshot(snapshotPath); }));
 }
 
 bool PackageManager::isCancelled(int exitCode) {
-    return (exitCode == 126 || exitCode == 127 || exitCode == 130);
+    return (exitCode == 126 || exitCode == 127 || exitCode == CommandRunner::CancelledExitCode);
+}
+
+void PackageManager::finishOperation(bool success, int exitCode)
+{
+    // Operations may have changed install reasons without touching the local directory itself.
+    // The watcher would notice both, but the caller lists packages before its events arrive.
+    m_localDbDirty = true;
+    invalidateCacheListing();
+
+    bool timedOut = exitCode == CommandRunner::TimedOutExitCode;
+    emit operationFinished(success && !timedOut, isCancelled(exitCode), timedOut);
 }
 
-void PackageManager::runRawCommand(const QString& cmd, const QString& desc)
+void PackageManager::watchPacmanDirectories()
 {
-    m_runner->run(cmd, desc, false, true, [this](QString, int exitCode){
-        emit operationFinished(exitCode == 0, isCancelled(exitCode));
+    m_pacmanWatcher = new QFileSystemWatcher(this);
+    m_pacmanChangeTimer = new QTimer(this);
+    m_pacmanChangeTimer->setSingleShot(true);
+    m_pacmanChangeTimer->setInterval(500);
+    connect(m_pacmanChangeTimer, &QTimer::timeout, this, &PackageManager::applyPacmanChanges);
+
+    // db.lck is created and removed in DBPath itself, so every transaction shows up there,
+    // even one that only changes install reasons inside existing desc files
+    m_watchedDbPath = QDir(PacmanConfigManager::readDBPath()).absolutePath();
+    QString localDir = m_watchedDbPath + "/local";
+    QString syncDir = m_watchedDbPath + "/sync";
+    QStringList cacheDirs;
+    for (const QString& dir : PacmanConfigManager::readCacheDirs()) cacheDirs << QDir(dir).absolutePath();
+
+    QStringList paths = QStringList{ m_watchedDbPath, localDir, syncDir } + cacheDirs;
+    paths.removeIf([](const QString& path){ return !QFileInfo(path).isDir(); });
+    if (!paths.isEmpty()) m_pacmanWatcher->addPaths(paths);
+
+    connect(m_pacmanWatcher, &QFileSystemWatcher::directoryChanged, this, [this, localDir, syncDir, cacheDirs](const QString& path){
+        if (path == m_watchedDbPath || path == localDir) m_pendingPacmanChanges |= LocalChange;
+        else if (path == syncDir) m_pendingPacmanChanges |= SyncChange;
+        else if (cacheDirs.contains(path)) m_pendingPacmanChanges |= CacheChange;
+        m_pacmanChangeTimer->start();
     });
 }
 
-void PackageManager::checkSystemUpdates()
+void PackageManager::applyPacmanChanges()
 {
-    m_runner->run("checkupdates", "Checking for system updates...", true, false, [this](QString output, int exitCode){
-        QString cleanContent = stripAnsi(output);
-        QStringList lines = cleanContent.split('\n', Qt::SkipEmptyParts);
+    // Mid-transaction the database is half written; removing the lock brings us back here
+    if (QFileInfo::exists(m_watchedDbPath + "/db.lck")) return;
 
-        QList<UpdatePackageInfo> updates;
-        bool errorFound = (exitCode != 0 && exitCode != 2);
+    int changes = std::exchange(m_pendingPacmanChanges, 0);
+    if (changes & SyncChange) m_searchIndexDirty = true;
+    if (changes & CacheChange) {
+        invalidateCacheListing();
+        emit cachedPackagesChanged();
+    }
+    // Nothing to compare against until something asked for the database; the reload only
+    // rereads desc files whose directories changed and announces a different fingerprint
+    if ((changes & LocalChange) && m_localDb) {
+        m_localDbDirty = true;
+        refreshLocalDatabase();
+    }
+}
 
-        for (const QString& line : lines) {
-            if (line.contains("->")) {
-                QStringList parts = line.split(' ', Qt::SkipEmptyParts);
-                if (parts.size() >= 4) {
-                    updates.append({parts[0], parts[1], parts[3], false});
-                }
-            } else if (line.contains("error", Qt::CaseInsensitive) || line.contains("failed", Qt::CaseInsensitive)) {
-                errorFound = true;
-            }
+void PackageManager::invalidateCacheListing()
+{
+    m_cachedPackagesValid = false;
+    ++m_cacheChangeCount;
+}
+
+void PackageManager::withLocalDatabase(std::function<void(std::shared_ptr<const LocalDatabase>)> callback)
+{
+    bool usable = m_localDb && !m_localDbDirty && (m_localDbProvisional || !m_localDb->isStale());
+    if (usable) {
+        callback(m_localDb);
+        return;
+    }
+
+    m_localDbWaiters.append(callback);
+    refreshLocalDatabase();
+}
+
+void PackageManager::refreshLocalDatabase()
+{
+    if (m_localDbLoading) return;
+    m_localDbLoading = true;
+    m_localDbDirty = false;
+
+    // The current snapshot, if any, lets the worker skip every desc file that hasn't changed
+    std::shared_ptr<const LocalDatabase> previous = m_localDb;
+    QString snapshotPath = m_localDbSnapshotPath;
+    QString dbPath = PacmanConfigManager::readDBPath();
+    QStringList repos = PacmanConfigManager::readRepositories();
+
+    auto *watcher = new QFutureWatcher<std::shared_ptr<LocalDatabase>>(this);
+    connect(watcher, &QFutureWatcher<std::shared_ptr<LocalDatabase>>::finished, this, [this, watcher](){
+        std::shared_ptr<const LocalDatabase> db = watcher->result();
+        watcher->deleteLater();
+        m_localDb = db;
+        m_localDbProvisional = false;
+        m_localDbLoading = false;
+
+        // Something changed the database while we were reading it; read it again before answering
+        if (m_localDbDirty) {
+            refreshLocalDatabase();
+            return;
         }
 
-        emit updatesCheckFinished(updates, errorFound);
+        const auto waiters = std::exchange(m_localDbWaiters, {});
+        for (const auto& waiter : waiters) waiter(db);
+
+        // Against what was last handed out, so a reload that had to start over still counts
+        bool changed = m_localDbServedFingerprint != 0 && m_localDbServedFingerprint != db->fingerprint();
+        m_localDbServedFingerprint = db->fingerprint();
+        if (changed) emit installedPackagesChanged();
     });
+
+    watcher->setFuture(QtConcurrent::run([dbPath, repos, previous, snapshotPath](){
+        std::shared_ptr<LocalDatabase> db = LocalDatabase::load(dbPath, repos, previous.get());
+        if (!previous || previous->fingerprint() != db->fingerprint()) db->saveSnapshot(snapshotPath);
+        return db;
+    }));
 }
 
-void PackageManager::installSystemUpdates(bool offlineUpdate, bool autoCleanCache, int oldVersionsToKeep)
+void PackageManager::runWithOwnPrompt(const QString& command, const QString& description, std::function<void(QString, int)> callback)
 {
-    QString cmdChain;
-    QString descriptionSuffix = "";
-    QString pacCmd = offlineUpdate ? "pacman -Syuw --noconfirm" : "pacman -Syu --noconfirm";
+    CommandJob job;
+    job.command = command;
+    job.description = description;
+    job.requiresRoot = true;
+    job.allowHelper = false;
+    job.callback = callback;
+    m_runner->enqueue(job);
+}
+
+void PackageManager::runWithDeadline(const QString& command, const QString& description, int timeoutMs, std::function<void(QString, int)> callback)
+{
+    CommandJob job;
+    job.command = command;
+    job.description = description;
+    job.timeoutMs = timeoutMs;
+    job.callback = callback;
+    m_runner->enqueue(job);
+}
 
-    cmdChain += pacCmd;
+void PackageManager::runRawCommand(const QString& cmd, const QString& desc, bool allowHelper)
+{
+    CommandJob job;
+    job.command = cmd;
+    job.description = desc;
+    job.requiresRoot = true;
+    job.allowHelper = allowHelper;
+    job.callback = [this](QString, int exitCode){
+        finishOperation(exitCode == 0, exitCode);
+    };
+    m_runner->enqueue(job);
+}
 
-    if (autoCleanCache) {
-        cmdChain += QString(" && paccache -rk%1").arg(oldVersionsToKeep + 1);
-        descriptionSuffix = " & cleaning cache";
+void PackageManager::checkSystemUpdates()
+{
+    if (m_syncFetcher->isRunning()) return;
+
+    QStringList repos = PacmanConfigManager::readRepositories();
+    QMap<QString, QStringList> servers;
+    if (m_syncServers.isEmpty()) {
+        servers = PacmanConfigManager::readServers();
+    } else {
+        QString arch = PacmanConfigManager::readArchitecture();
+        for (const QString& repo : repos) {
+            for (QString server : m_syncServers) servers[repo] << server.replace("$repo", repo).replace("$arch", arch);
+        }
     }
 
+    emit statusMessageChanged("Synchronizing package databases...");
+    m_syncFetcher->fetch(m_syncDbPath, PacmanConfigManager::readDBPath(), repos, servers);
+}
+
+void PackageManager::cancelUpdateCheck()
+{
+    m_syncFetcher->cancel();
+}
+
+bool PackageManager::isCheckingUpdates() const
+{
+    return m_syncFetcher->isRunning();
+}
+
+void PackageManager::computeUpdates(const QString& syncDbPath)
+{
+    withLocalDatabase([this, syncDbPath](std::shared_ptr<const LocalDatabase> local){
+        QStringList repos = PacmanConfigManager::readRepositories();
+        QStringList ignorePackages = PacmanConfigManager::readOptionList("IgnorePkg");
+        QStringList ignoreGroups = PacmanConfigManager::readOptionList("IgnoreGroup");
+
+        using Result = QPair<QList<UpdatePackageInfo>, bool>;
+        auto *watcher = new QFutureWatcher<Result>(this);
+        connect(watcher, &QFutureWatcher<Result>::finished, this, [this, watcher](){
+            Result result = watcher->result();
+            watcher->deleteLater();
+            emit updatesCheckFinished(result.first, result.second);
+        });
+
+        watcher->setFuture(QtConcurrent::run([local, repos, ignorePackages, ignoreGroups, syncDbPath](){
+            // One repo per thread; decompressing extra and friends dominates
+            QList<QList<SyncPackage>> sync = QtConcurrent::blockingMapped<QList<QList<SyncPackage>>>(repos, [syncDbPath](const QString& repo){
+                return SyncDatabase::readPackages(SyncDatabase::databaseFile(syncDbPath, repo), repo);
+            });
+
+            bool unreadable = std::all_of(sync.cbegin(), sync.cend(), [](const QList<SyncPackage>& repo){ return repo.isEmpty(); });
+            if (repos.isEmpty() || unreadable) return Result({}, true);
+            return Result(UpdateCalculator::compute(*local, sync, ignorePackages, ignoreGroups), false);
+        }));
+    });
+}
+
+void PackageManager::installSystemUpdates(bool offlineUpdate, bool autoCleanCache, const CacheRetentionPolicy& retention)
+{
+    QString cmdChain = offlineUpdate ? "uptater-op upgrade --download-only" : "uptater-op upgrade";
     if (offlineUpdate) {
-        cmdChain += " && schedule-system-update";
+        cmdChain += " && uptater-op schedule-update";
     }
 
-    QString desc = offlineUpdate ? "Downloading updates" : "Installing updates";
-    desc += descriptionSuffix + "...";
+    QString desc = offlineUpdate ? "Downloading updates..." : "Installing updates...";
 
-    m_runner->run("bash -c '" + cmdChain + "'", desc, false, true, [this](QString, int exitCode){
-        emit operationFinished(exitCode == 0, isCancelled(exitCode));
+    m_runner->run("bash -c '" + cmdChain + "'", desc, false, true, [this, autoCleanCache, retention](QString, int exitCode){
+        if (exitCode != 0 || !autoCleanCache) {
+            finishOperation(exitCode == 0, exitCode);
+            return;
+        }
+        // The upgrade itself went through; trimming the cache afterwards is best effort
+        emit statusMessageChanged("Cleaning package cache...");
+        m_localDbDirty = true;
+        planCacheCleanup(retention, [this](const CacheCleanupPlan& plan){
+            removeCachedFiles(plan, "Cleaning package cache...", [this](int){ finishOperation(true, 0); });
+        });
     });
 }
 
 void PackageManager::cancelScheduledUpdate()
 {
-    m_runner->run("rm -f /system-update", "Cancelling scheduled update...", false, true, [this](QString, int exitCode){
-        emit operationFinished(exitCode == 0, isCancelled(exitCode));
+    m_runner->run("uptater-op cancel-scheduled-update", "Cancelling scheduled update...", false, true, [this](QString, int exitCode){
+        finishOperation(exitCode == 0, exitCode);
     });
 }
 
 void PackageManager::fetchPackageList(DashboardWidget::PackageFilter filter)
 {
-    QString command;
-    QString desc;
-    switch(filter) {
-        case DashboardWidget::PackageFilter::Official: command = "pacman -Qen"; desc = "Listing Official Packages..."; break;
-        case DashboardWidget::PackageFilter::Aur: command = "pacman -Qm"; desc = "Listing AUR Packages..."; break;
-        case DashboardWidget::PackageFilter::Orphans: command = "pacman -Qdt"; desc = "Listing Orphan Packages..."; break;
-        case DashboardWidget::PackageFilter::Cache: command = "ls -lh /var/cache/pacman/pkg | awk 'NR>1 && !/\\.sig$/ {print $9, $5}'"; desc = "Listing Cached Packages..."; break;
-        case DashboardWidget::PackageFilter::All:
-        default: command = "pacman -Q"; desc = "Listing All Installed Packages..."; break;
+    // Listings can overlap; output from a superseded listing is dropped
+    int generation = ++m_listGeneration;
+
+    if (filter == DashboardWidget::PackageFilter::Cache) {
+        // Kept until the watcher or one of our own operations says a CacheDir changed
+        if (m_cachedPackagesValid) {
+            emit cachedPackagesFetched(m_cachedPackages);
+            emit packageListFinished(m_cachedPackages.size());
+            return;
+        }
+
+        // One readdir pass over every CacheDir; exact sizes and dates go to the view unformatted
+        int changeCount = m_cacheChangeCount;
+        auto *watcher = new QFutureWatcher<QList<CachedPackage>>(this);
+        connect(watcher, &QFutureWatcher<QList<CachedPackage>>::finished, this, [this, watcher, generation, changeCount](){
+            QList<CachedPackage> packages = watcher->result();
+            watcher->deleteLater();
+            if (changeCount == m_cacheChangeCount) {
+                m_cachedPackages = packages;
+                m_cachedPackagesValid = true;
+            }
+            if (generation != m_listGeneration) return;
+            emit cachedPackagesFetched(packages);
+            emit packageListFinished(packages.size());
+        });
+        QStringList cacheDirs = PacmanConfigManager::readCacheDirs();
+        watcher->setFuture(QtConcurrent::run([cacheDirs](){ return CacheScanner::scan(cacheDirs); }));
+        return;
     }
 
-    m_runner->run(command, desc, true, false, [this](QString output, int){
-        QString cleanContent = stripAnsi(output);
-        QStringList lines = cleanContent.split('\n', Qt::SkipEmptyParts);
-        emit packageListFetched(lines);
+    // Every installed-package view is a filter over the same table, like pacman -Q with -e/-n/-m/-d/-t;
+    // only row ids change hands, the view reads the columns it shows
+    withPackageTable([this, filter, generation](std::shared_ptr<const PackageTable> table){
+        if (generation != m_listGeneration) return;
+
+        // A new table means the database changed; each filter is redone the next time it is shown
+        if (m_filterRowsTable != table) {
+            m_filterRows.clear();
+            m_filterRowsTable = table;
+        }
+
+        auto cached = m_filterRows.constFind(int(filter));
+        if (cached == m_filterRows.constEnd()) {
+            QList<quint32> rows;
+            rows.reserve(table->rowCount());
+            for (quint32 row = 0; row < table->rowCount(); ++row) {
+                bool include = true;
+                switch (filter) {
+                    case DashboardWidget::PackageFilter::Official: include = table->isExplicit(row) && !table->isForeign(row); break;
+                    case DashboardWidget::PackageFilter::Aur: include = table->isForeign(row); break;
+                    case DashboardWidget::PackageFilter::Orphans: include = table->orphanKind(row) != OrphanKind::None; break;
+                    default: break;
+                }
+                if (include) rows.append(row);
+            }
+            cached = m_filterRows.insert(int(filter), rows);
+        }
+        QList<quint32> rows = *cached;
+
+        if (!rows.isEmpty()) emit packageRowsFetched(table, rows);
+        emit packageListFinished(rows.size());
+    });
+}
+
+void PackageManager::withPackageTable(std::function<void(std::shared_ptr<const PackageTable>)> callback)
+{
+    withLocalDatabase([this, callback](std::shared_ptr<const LocalDatabase> db){
+        if (m_packageTable && m_packageTableSource == db) {
+            callback(m_packageTable);
+            return;
+        }
+
+        m_packageTableWaiters.append(callback);
+        if (m_packageTableLoading) return;
+        m_packageTableLoading = true;
+
+        // Interning every name and version is a pass over the whole database; keep it off the GUI thread
+        auto *watcher = new QFutureWatcher<std::shared_ptr<const PackageTable>>(this);
+        connect(watcher, &QFutureWatcher<std::shared_ptr<const PackageTable>>::finished, this, [this, watcher, db](){
+            m_packageTable = watcher->result();
+            m_packageTableSource = db;
+            m_packageTableLoading = false;
+            watcher->deleteLater();
+
+            const auto waiters = std::exchange(m_packageTableWaiters, {});
+            for (const auto& waiter : waiters) waiter(m_packageTable);
+        });
+        watcher->setFuture(QtConcurrent::run([db]() -> std::shared_ptr<const PackageTable> { return PackageTable::fromLocal(*db); }));
+    });
+}
+
+void PackageManager::refreshStatistics()
+{
+    static const int LARGEST_PACKAGES = 10;
+
+    // Each part is redone only if its source changed, on its own worker, and reported as it lands
+    withPackageTable([this](std::shared_ptr<const PackageTable> table){
+        quint64 fingerprint = m_packageTableSource->fingerprint();
+        if (fingerprint == m_statsFingerprint) return;
+        m_statsFingerprint = fingerprint;
+
+        auto *watcher = new QFutureWatcher<PackageStats>(this);
+        connect(watcher, &QFutureWatcher<PackageStats>::finished, this, [this, watcher, fingerprint](){
+            PackageStats packages = watcher->result();
+            watcher->deleteLater();
+            if (fingerprint != m_statsFingerprint) return;
+            m_stats.packages = packages;
+            m_stats.packagesKnown = true;
+            emit statisticsChanged(m_stats);
+        });
+        watcher->setFuture(QtConcurrent::run([table](){ return SystemStatistics::packageStats(*table, LARGEST_PACKAGES); }));
     });
+
+    // Adding or removing a package file touches its directory
+    QStringList cacheDirs = PacmanConfigManager::readCacheDirs();
+    QString cacheStamp;
+    for (const QString& dir : cacheDirs) cacheStamp += dir + ':' + QString::number(QFileInfo(dir).lastModified().toMSecsSinceEpoch()) + ';';
+    if (cacheStamp != m_statsCacheStamp) {
+        m_statsCacheStamp = cacheStamp;
+        auto *watcher = new QFutureWatcher<CacheStats>(this);
+        connect(watcher, &QFutureWatcher<CacheStats>::finished, this, [this, watcher, cacheStamp](){
+            CacheStats cache = watcher->result();
+            watcher->deleteLater();
+            if (cacheStamp != m_statsCacheStamp) return;
+            m_stats.cache = cache;
+            m_stats.cacheKnown = true;
+            emit statisticsChanged(m_stats);
+        });
+        // The cache listing, when it is current, is the same scan already done
+        if (m_cachedPackagesValid) {
+            QList<CachedPackage> packages = m_cachedPackages;
+            watcher->setFuture(QtConcurrent::run([packages](){ return SystemStatistics::cacheStats(packages); }));
+        } else {
+            watcher->setFuture(QtConcurrent::run([cacheDirs](){ return SystemStatistics::cacheStats(CacheScanner::scan(cacheDirs)); }));
+        }
+    }
+
+    // pacman.log only grows, so its size and time say whether anything was appended
+    QString logFile = PacmanConfigManager::readLogFile();
+    QFileInfo logInfo(logFile);
+    QString logStamp = QString("%1:%2:%3").arg(logFile).arg(logInfo.size()).arg(logInfo.lastModified().toMSecsSinceEpoch());
+    if (logStamp != m_statsLogStamp) {
+        m_statsLogStamp = logStamp;
+        auto *watcher = new QFutureWatcher<QDateTime>(this);
+        connect(watcher, &QFutureWatcher<QDateTime>::finished, this, [this, watcher, logStamp](){
+            QDateTime lastFullUpgrade = watcher->result();
+            watcher->deleteLater();
+            if (logStamp != m_statsLogStamp) return;
+            m_stats.lastFullUpgrade = lastFullUpgrade;
+            m_stats.upgradeKnown = true;
+            emit statisticsChanged(m_stats);
+        });
+        watcher->setFuture(QtConcurrent::run([logFile](){ return SystemStatistics::lastFullUpgrade(logFile); }));
+    }
 }
 
-void PackageManager::cleanCache(int oldVersionsToKeep)
+void PackageManager::withDependencyGraph(std::function<void(std::shared_ptr<const LocalDatabase>, std::shared_ptr<const DependencyGraph>)> callback)
 {
-    QString cmd = QString("paccache -rk%1").arg(oldVersionsToKeep + 1);
-    m_runner->run("bash -c '" + cmd + "'", "Cleaning pacman cache...", false, true, [this](QString, int exitCode){
-        emit operationFinished(exitCode == 0, isCancelled(exitCode));
+    withLocalDatabase([this, callback](std::shared_ptr<const LocalDatabase> db){
+        if (m_dependencyGraph && m_dependencyGraphSource == db) {
+            callback(db, m_dependencyGraph);
+            return;
+        }
+
+        m_dependencyGraphWaiters.append(callback);
+        if (m_dependencyGraphLoading) return;
+        m_dependencyGraphLoading = true;
+
+        // Resolving every dependency string runs vercmp across the database; every query after
+        // that is a walk over integers and fine on the GUI thread
+        auto *watcher = new QFutureWatcher<std::shared_ptr<const DependencyGraph>>(this);
+        connect(watcher, &QFutureWatcher<std::shared_ptr<const DependencyGraph>>::finished, this, [this, watcher, db](){
+            m_dependencyGraph = watcher->result();
+            m_dependencyGraphSource = db;
+            m_dependencyGraphLoading = false;
+            watcher->deleteLater();
+
+            const auto waiters = std::exchange(m_dependencyGraphWaiters, {});
+            for (const auto& waiter : waiters) waiter(db, m_dependencyGraph);
+        });
+        watcher->setFuture(QtConcurrent::run([db]() -> std::shared_ptr<const DependencyGraph> { return DependencyGraph::build(*db); }));
+    });
+}
+
+void PackageManager::compileCriticalRules(const QStringList& rules, std::function<void(std::shared_ptr<const CriticalSet>)> callback)
+{
+    // One pass per rule over the names or the graph, cheap next to building the graph itself
+    withDependencyGraph([rules, callback](std::shared_ptr<const LocalDatabase> db, std::shared_ptr<const DependencyGraph> graph){
+        callback(CriticalSet::compile(rules, *db, graph));
+    });
+}
+
+// Everything the dependency graph and the snapshot already hold; cheap enough for the GUI thread
+static PackageDetails graphDetails(const QString& name, const LocalDatabase& db, const DependencyGraph& graph)
+{
+    PackageDetails details;
+    details.name = name;
+
+    int node = graph.indexOf(name);
+    if (node == -1) return details;
+
+    auto names = [&graph](const QList<int>& nodes) {
+        QStringList result;
+        for (int n : nodes) result << graph.name(n);
+        return result;
+    };
+
+    const LocalPackage& pkg = db.packages()[node];
+    details.version = pkg.version;
+    details.description = pkg.description;
+    details.repo = pkg.repo;
+    details.explicitlyInstalled = pkg.explicitlyInstalled;
+    details.installedSize = pkg.installedSize;
+    details.installDate = QDateTime::fromSecsSinceEpoch(pkg.installDate);
+    details.dependsOn = names(graph.dependencies(node));
+    details.optionalDeps = names(graph.optionalDependencies(node));
+    details.requiredBy = names(graph.requiredBy(node));
+    details.optionalFor = names(graph.optionalFor(node));
+    details.whyInstalled = names(graph.whyInstalled(node));
+    details.unresolved = graph.unresolved().value(node);
+
+    DependencyGraph::Closure closure = graph.closure(node);
+    details.closureCount = closure.count;
+    details.closureBytes = closure.bytes;
+    return details;
+}
+
+// Roughly what one cache entry holds on to, in bytes
+static int detailsCost(const PackageDetails& details)
+{
+    qsizetype chars = details.name.size() + details.version.size() + details.description.size() + details.repo.size()
+                    + details.url.size() + details.packager.size();
+    for (const QStringList* list : { &details.dependsOn, &details.optionalDeps, &details.requiredBy, &details.optionalFor,
+                                     &details.whyInstalled, &details.unresolved, &details.licenses }) {
+        for (const QString& item : *list) chars += item.size() + 8;
+    }
+    return int(sizeof(PackageDetails) + chars * sizeof(QChar));
+}
+
+void PackageManager::describePackage(const QString& name, std::function<void(const PackageDetails&)> callback)
+{
+    // Numbered as asked, so an answer that comes back late can be told from a newer one
+    quint64 request = ++m_lastDetailsRequest;
+    auto answer = [callback, request](PackageDetails details){
+        details.request = request;
+        callback(details);
+    };
+
+    withDependencyGraph([this, name, answer](std::shared_ptr<const LocalDatabase> db, std::shared_ptr<const DependencyGraph> graph){
+        useDetailsSource(db);
+        if (const PackageDetails* cached = m_detailsCache.object(name)) {
+            answer(*cached);
+            return;
+        }
+
+        PackageDetails details = graphDetails(name, *db, *graph);
+        answer(details);
+        // Graph nodes follow the database's order, so the node is also the package's index
+        if (!details.version.isEmpty()) loadPackageDetails(db, graph->indexOf(name), details, answer, false);
+    });
+}
+
+void PackageManager::prefetchPackageDetails(const QStringList& names)
+{
+    // Only the latest neighbourhood is worth reading; whatever the last one left queued is dropped
+    m_pendingPrefetches = names;
+    startPrefetches();
+}
+
+void PackageManager::startPrefetches()
+{
+    if (m_pendingPrefetches.isEmpty() || m_activePrefetches >= MaxDetailPrefetches) return;
+
+    withDependencyGraph([this](std::shared_ptr<const LocalDatabase> db, std::shared_ptr<const DependencyGraph> graph){
+        useDetailsSource(db);
+        while (m_activePrefetches < MaxDetailPrefetches && !m_pendingPrefetches.isEmpty()) {
+            QString name = m_pendingPrefetches.takeFirst();
+            auto loading = m_detailsLoads.constFind(name);
+            if (m_detailsCache.contains(name) || (loading != m_detailsLoads.cend() && loading->db == db)) continue;
+            PackageDetails details = graphDetails(name, *db, *graph);
+            if (details.version.isEmpty()) continue;
+            ++m_activePrefetches;
+            loadPackageDetails(db, graph->indexOf(name), details, nullptr, true);
+        }
+    });
+}
+
+void PackageManager::useDetailsSource(std::shared_ptr<const LocalDatabase> db)
+{
+    if (m_detailsCacheSource == db) return;
+    m_detailsCache.clear();
+    m_detailsCacheSource = db;
+}
+
+void PackageManager::loadPackageDetails(std::shared_ptr<const LocalDatabase> db, int index, const PackageDetails& details,
+                                        std::function<void(const PackageDetails&)> callback, bool prefetch)
+{
+    // A second request for a package already being read from the same database just waits for the first
+    auto current = m_detailsLoads.find(details.name);
+    if (current != m_detailsLoads.end() && current->db == db) {
+        if (callback) current->waiters.append(callback);
+        if (prefetch) {
+            --m_activePrefetches;
+            startPrefetches();
+        }
+        return;
+    }
+
+    // One for an older database is superseded: its answer, and whoever waited for it, would be stale
+    DetailsLoad& load = m_detailsLoads[details.name];
+    load.id = ++m_lastDetailsLoad;
+    load.db = db;
+    load.waiters.clear();
+    if (callback) load.waiters.append(callback);
+
+    QString entryPath = db->entryPath(index);
+
+    auto *watcher = new QFutureWatcher<LocalPackageExtras>(this);
+    connect(watcher, &QFutureWatcher<LocalPackageExtras>::finished, this, [this, watcher, db, details, prefetch, id = load.id](){
+        LocalPackageExtras extras = watcher->result();
+        watcher->deleteLater();
+
+        if (prefetch) {
+            --m_activePrefetches;
+            startPrefetches();
+        }
+
+        PackageDetails full = details;
+        full.extrasLoaded = true;
+        full.url = extras.url;
+        full.licenses = extras.licenses;
+        full.packager = extras.packager;
+        full.buildDate = QDateTime::fromSecsSinceEpoch(extras.buildDate);
+        full.fileCount = extras.fileCount;
+
+        // Read from a database that has since been replaced: nobody is served from it
+        if (db == m_detailsCacheSource) m_detailsCache.insert(full.name, new PackageDetails(full), detailsCost(full));
+        auto load = m_detailsLoads.find(full.name);
+        if (load == m_detailsLoads.end() || load->id != id) return;
+        const auto waiters = load->waiters;
+        m_detailsLoads.erase(load);
+        for (const auto& waiter : waiters) waiter(full);
+    });
+    watcher->setFuture(QtConcurrent::run([entryPath](){ return LocalDatabase::readExtras(entryPath); }));
+}
+
+void PackageManager::withFileIndex(std::function<void(std::shared_ptr<const FileIndex>)> callback)
+{
+    withLocalDatabase([this, callback](std::shared_ptr<const LocalDatabase> db){
+        if (m_fileIndex && m_fileIndexSource == db) {
+            callback(m_fileIndex);
+            return;
+        }
+
+        m_fileIndexWaiters.append(callback);
+        if (m_fileIndexLoading) return;
+        m_fileIndexLoading = true;
+        emit statusMessageChanged("Indexing package files...");
+
+        auto *watcher = new QFutureWatcher<std::shared_ptr<const FileIndex>>(this);
+        connect(watcher, &QFutureWatcher<std::shared_ptr<const FileIndex>>::finished, this, [this, watcher, db](){
+            m_fileIndex = watcher->result();
+            m_fileIndexSource = db;
+            m_fileIndexLoading = false;
+            watcher->deleteLater();
+
+            const auto waiters = std::exchange(m_fileIndexWaiters, {});
+            for (const auto& waiter : waiters) waiter(m_fileIndex);
+        });
+
+        // Checking the stamps of every files list is cheap; only what changed gets read again
+        QString indexPath = m_fileIndexPath;
+        QString dbPath = PacmanConfigManager::readDBPath();
+        QStringList repos = PacmanConfigManager::readRepositories();
+        watcher->setFuture(QtConcurrent::run([indexPath, dbPath, repos](){ return FileIndex::update(indexPath, dbPath, repos); }));
+    });
+}
+
+void PackageManager::searchFiles(const QString& query)
+{
+    // Searches are listings too, so typing supersedes the previous query
+    static const int FILE_SEARCH_LIMIT = 2000;
+    int generation = ++m_listGeneration;
+
+    withFileIndex([this, query, generation](std::shared_ptr<const FileIndex> index){
+        if (generation != m_listGeneration) return;
+        if (!index || query.trimmed().isEmpty()) {
+            emit packageListFinished(0);
+            return;
+        }
+
+        auto *watcher = new QFutureWatcher<QList<FileOwner>>(this);
+        connect(watcher, &QFutureWatcher<QList<FileOwner>>::finished, this, [this, watcher, generation](){
+            QList<FileOwner> owners = watcher->result();
+            watcher->deleteLater();
+            if (generation != m_listGeneration) return;
+            emit fileOwnersFound(owners);
+            emit packageListFinished(owners.size());
+        });
+        watcher->setFuture(QtConcurrent::run([index, query](){ return index->search(query, FILE_SEARCH_LIMIT); }));
+    });
+}
+
+void PackageManager::withSearchIndex(std::function<void(std::shared_ptr<const PackageSearchIndex>)> callback)
+{
+    if (m_searchIndex && !m_searchIndexDirty) {
+        callback(m_searchIndex);
+        return;
+    }
+
+    m_searchIndexWaiters.append(callback);
+    if (m_searchIndexLoading) return;
+    m_searchIndexLoading = true;
+    m_searchIndexDirty = false;
+
+    // Our own copy is what the last update check saw; repos it doesn't have yet come from pacman's
+    QString systemDbPath = PacmanConfigManager::readDBPath();
+    QStringList repos = PacmanConfigManager::readRepositories();
+    QStringList dbFiles;
+    for (const QString& repo : repos) {
+        QString own = SyncDatabase::databaseFile(m_syncDbPath, repo);
+        dbFiles << (QFileInfo::exists(own) ? own : SyncDatabase::databaseFile(systemDbPath, repo));
+    }
+
+    auto *watcher = new QFutureWatcher<std::shared_ptr<const PackageSearchIndex>>(this);
+    connect(watcher, &QFutureWatcher<std::shared_ptr<const PackageSearchIndex>>::finished, this, [this, watcher](){
+        m_searchIndex = watcher->result();
+        m_searchIndexLoading = false;
+        watcher->deleteLater();
+
+        const auto waiters = std::exchange(m_searchIndexWaiters, {});
+        for (const auto& waiter : waiters) waiter(m_searchIndex);
+    });
+    QString indexPath = m_searchIndexPath;
+    watcher->setFuture(QtConcurrent::run([indexPath, repos, dbFiles](){ return PackageSearchIndex::update(indexPath, repos, dbFiles); }));
+}
+
+void PackageManager::searchRepositories(const QString& query)
+{
+    static const int REPO_SEARCH_LIMIT = 500;
+    int generation = ++m_listGeneration;
+
+    withSearchIndex([this, query, generation](std::shared_ptr<const PackageSearchIndex> index){
+        if (generation != m_listGeneration) return;
+        if (query.trimmed().isEmpty()) {
+            emit packageListFinished(0);
+            return;
+        }
+
+        // Ranking runs on a worker; the installed versions are joined in from the local snapshot
+        withLocalDatabase([this, index, query, generation](std::shared_ptr<const LocalDatabase> local){
+            if (generation != m_listGeneration) return;
+
+            auto *watcher = new QFutureWatcher<QList<PackageSearchResult>>(this);
+            connect(watcher, &QFutureWatcher<QList<PackageSearchResult>>::finished, this, [this, watcher, generation](){
+                QList<PackageSearchResult> packages = watcher->result();
+                watcher->deleteLater();
+                if (generation != m_listGeneration) return;
+                emit repositoryPackagesFound(packages);
+                emit packageListFinished(packages.size());
+            });
+            watcher->setFuture(QtConcurrent::run([index, local, query](){
+                QList<PackageSearchResult> packages = index->search(query, REPO_SEARCH_LIMIT);
+                const QList<LocalPackage>& installed = local->packages();
+                for (PackageSearchResult& pkg : packages) {
+                    // The local list is sorted by name
+                    auto it = std::lower_bound(installed.cbegin(), installed.cend(), pkg.name, [](const LocalPackage& a, const QString& name){ return a.name < name; });
+                    if (it != installed.cend() && it->name == pkg.name) pkg.installedVersion = it->version;
+                }
+                return packages;
+            }));
+        });
+    });
+}
+
+void PackageManager::planCacheCleanup(const CacheRetentionPolicy& policy, std::function<void(const CacheCleanupPlan&)> callback)
+{
+    withLocalDatabase([this, policy, callback](std::shared_ptr<const LocalDatabase> local){
+        QStringList cacheDirs = PacmanConfigManager::readCacheDirs();
+
+        auto *watcher = new QFutureWatcher<CacheCleanupPlan>(this);
+        connect(watcher, &QFutureWatcher<CacheCleanupPlan>::finished, this, [watcher, callback](){
+            CacheCleanupPlan plan = watcher->result();
+            watcher->deleteLater();
+            callback(plan);
+        });
+        watcher->setFuture(QtConcurrent::run([local, cacheDirs, policy](){
+            QSet<QString> installed;
+            for (const LocalPackage& pkg : local->packages()) installed.insert(pkg.name);
+            return CachePlanner::plan(CacheScanner::scan(cacheDirs), policy, installed);
+        }));
+    });
+}
+
+void PackageManager::cleanCache(const CacheCleanupPlan& plan)
+{
+    removeCachedFiles(plan, "Cleaning pacman cache...", [this](int exitCode){
+        finishOperation(exitCode == 0, exitCode);
+    });
+}
+
+void PackageManager::removeCachedFiles(const CacheCleanupPlan& plan, const QString& description, std::function<void(int)> done)
+{
+    if (plan.isEmpty()) {
+        done(0);
+        return;
+    }
+
+    // xargs finds the uptater-op shim on PATH, so it is still one privileged batch
+    QString listPath = writeTargetList("cache-cleanup.list", plan.filePaths());
+    if (listPath.isEmpty()) {
+        done(1);
+        return;
+    }
+
+    m_runner->run("xargs -0 -r uptater-op clean-cache < " + shellQuote(listPath), description, false, true, [done](QString, int exitCode){
+        done(exitCode);
+    });
+}
+
+void PackageManager::planOrphanRemoval(std::function<void(const OrphanRemovalPlan&)> callback)
+{
+    withLocalDatabase([callback](std::shared_ptr<const LocalDatabase> db){
+        OrphanRemovalPlan plan;
+        const QList<LocalPackage>& packages = db->packages();
+        for (qsizetype i = 0; i < packages.size(); ++i) {
+            switch (db->orphanKind(i)) {
+                case OrphanKind::Orphan:
+                case OrphanKind::RecursiveOrphan:
+                    plan.removable << packages[i].name;
+                    plan.removableBytes += packages[i].installedSize;
+                    break;
+                case OrphanKind::OptionalOnly:
+                    plan.optionalOnly << packages[i].name;
+                    plan.optionalOnlyBytes += packages[i].installedSize;
+                    break;
+                case OrphanKind::None:
+                    break;
+            }
+        }
+        callback(plan);
+    });
+}
+
+void PackageManager::removePackages(const QStringList& names)
+{
+    // One transaction for the whole set, so packages that only need each other go together
+    QString listPath = writeTargetList("remove-packages.list", names);
+    if (names.isEmpty() || listPath.isEmpty()) {
+        finishOperation(names.isEmpty(), names.isEmpty() ? 0 : 1);
+        return;
+    }
+    QString desc = QString("Removing %1 packages...").arg(names.size());
+    m_runner->run("xargs -0 -r -a " + shellQuote(listPath) + " uptater-op remove", desc, false, true, [this](QString, int exitCode){
+        finishOperation(exitCode == 0, exitCode);
     });
 }
 
 void PackageManager::clearAllCache()
 {
-    m_runner->run("rm -rf /var/cache/pacman/pkg/*", "Completely clearing pacman cache...", false, true, [this](QString, int exitCode){
-        emit operationFinished(exitCode == 0, isCancelled(exitCode));
+    // Every package file (and its signature) in every configured CacheDir, named one by one
+    // like any other cleanup, so nothing outside the caches pacman.conf lists can be touched
+    QStringList cacheDirs = PacmanConfigManager::readCacheDirs();
+    auto *watcher = new QFutureWatcher<CacheCleanupPlan>(this);
+    connect(watcher, &QFutureWatcher<CacheCleanupPlan>::finished, this, [this, watcher](){
+        CacheCleanupPlan plan = watcher->result();
+        watcher->deleteLater();
+        removeCachedFiles(plan, "Completely clearing pacman cache...", [this](int exitCode){
+            finishOperation(exitCode == 0, exitCode);
+        });
     });
+    watcher->setFuture(QtConcurrent::run([cacheDirs](){
+        CacheCleanupPlan plan;
+        plan.removals = CacheScanner::scan(cacheDirs);
+        for (const CachedPackage& package : plan.removals) plan.reclaimableBytes += package.size + package.signatureSize;
+        return plan;
+    }));
 }
 
-void PackageManager::deleteCachedPackage(const QString& fileName)
+void PackageManager::deleteCachedPackage(const QString& filePath)
 {
-    QString script = QString("rm -f /var/cache/pacman/pkg/%1 /var/cache/pacman/pkg/%1.sig").arg(fileName);
-    m_runner->run(script, "Deleting cached package: " + fileName, false, true, [this](QString, int exitCode){
-        emit operationFinished(exitCode == 0, isCancelled(exitCode));
+    QString script = QString("uptater-op clean-cache %1 %2").arg(shellQuote(filePath), shellQuote(filePath + ".sig"));
+    m_runner->run(script, "Deleting cached package: " + QFileInfo(filePath).fileName(), false, true, [this](QString, int exitCode){
+        finishOperation(exitCode == 0, exitCode);
     });
 }
 
 void PackageManager::repairKeyring()
 {
-    m_runner->run("pacman -Sy archlinux-keyring --noconfirm && pacman-key --populate archlinux", "Repairing Pacman Keyring...", false, true, [this](QString, int exitCode){
-        emit operationFinished(exitCode == 0, isCancelled(exitCode));
+    m_runner->run("uptater-op install --refresh archlinux-keyring && uptater-op populate-keyring", "Repairing Pacman Keyring...", false, true, [this](QString, int exitCode){
+        finishOperation(exitCode == 0, exitCode);
     });
 }
 
@@ -152,8 +957,8 @@ void PackageManager::installYay(const QString& variant) {
         "pacman -S --needed %2 --noconfirm"
     ).arg(homeCache, deps);
 
-    m_runner->run(step1, "Preparing system...", false, true, [this, variant](QString, int exitCode){
-        if (exitCode != 0) { emit operationFinished(false, isCancelled(exitCode)); return; }
+    runWithOwnPrompt(step1, "Preparing system...", [this, variant](QString, int exitCode){
+        if (exitCode != 0) { finishOperation(false, exitCode); return; }
 
         // --- GITHUB FALLBACK ROUTE ---
         if (variant == "github") {
@@ -162,14 +967,14 @@ void PackageManager::installYay(const QString& variant) {
             "curl -s https://api.github.com/repos/Jguer/yay/releases/latest | grep browser_download_url | grep _x86_64.tar.gz | cut -d '\"' -f 4 | wget -qi - && "
             "tar -xzf *.tar.gz";
 
-            m_runner->run(step2, "Downloading release...", false, false, [this](QString, int exitCode){
-                if (exitCode != 0) { emit operationFinished(false, isCancelled(exitCode)); return; }
+            runWithDeadline(step2, "Downloading release...", FetchTimeoutMs, [this](QString, int exitCode){
+                if (exitCode != 0) { finishOperation(false, exitCode); return; }
 
                 emit statusMessageChanged("Waiting for password to install GitHub binary...");
                 QString step3 = "install -Dm755 /tmp/yay_github/*/yay /usr/bin/yay";
 
-                m_runner->run(step3, "Installing package...", false, true, [this](QString, int exitCode){
-                    emit operationFinished(exitCode == 0, isCancelled(exitCode));
+                runWithOwnPrompt(step3, "Installing package...", [this](QString, int exitCode){
+                    finishOperation(exitCode == 0, exitCode);
                 });
             });
             return;
@@ -180,22 +985,22 @@ void PackageManager::installYay(const QString& variant) {
         QString repoUrl = QString("https://aur.archlinux.org/%1.git").arg(variant);
         QString step2 = QString("rm -rf /tmp/%1 && git clone %2 /tmp/%1").arg(variant, repoUrl);
 
-        m_runner->run(step2, "Cloning repository...", false, false, [this, variant](QString, int exitCode){
-            if (exitCode != 0) { emit operationFinished(false, isCancelled(exitCode)); return; }
+        runWithDeadline(step2, "Cloning repository...", FetchTimeoutMs, [this, variant](QString, int exitCode){
+            if (exitCode != 0) { finishOperation(false, exitCode); return; }
 
             emit statusMessageChanged(QString("Building %1 package (this may take a minute)...").arg(variant));
 
             // Step 3: Explicitly disable debug package generation before compiling
             QString step3 = QString("cd /tmp/%1 && echo 'options=(!debug)' >> PKGBUILD && makepkg -c --noconfirm").arg(variant);
 
-            m_runner->run(step3, "Building package...", false, false, [this, variant](QString, int exitCode){
-                if (exitCode != 0) { emit operationFinished(false, isCancelled(exitCode)); return; }
+            runWithDeadline(step3, "Building package...", BuildTimeoutMs, [this, variant](QString, int exitCode){
+                if (exitCode != 0) { finishOperation(false, exitCode); return; }
 
                 emit statusMessageChanged("Waiting for password to install final package...");
                 QString step4 = QString("pacman -U /tmp/%1/*.pkg.tar.zst --noconfirm").arg(variant);
 
-                m_runner->run(step4, "Installing package...", false, true, [this](QString, int exitCode){
-                    emit operationFinished(exitCode == 0, isCancelled(exitCode));
+                runWithOwnPrompt(step4, "Installing package...", [this](QString, int exitCode){
+                    finishOperation(exitCode == 0, exitCode);
                 });
             });
         });
@@ -221,21 +1026,21 @@ void PackageManager::uninstallYay() {
         "rm -rf '%1' 2>/dev/null || true"
     ).arg(homeCache);
 
-    m_runner->run(cmd, "Uninstalling yay...", false, true, [this](QString, int exitCode){
-        emit operationFinished(exitCode == 0, isCancelled(exitCode));
+    runWithOwnPrompt(cmd, "Uninstalling yay...", [this](QString, int exitCode){
+        finishOperation(exitCode == 0, exitCode);
     });
 }
 
 void PackageManager::updateAur() {
-    m_runner->run("yay --aur", "Updating AUR Packages...", false, false, [this](QString, int exitCode){
-        emit operationFinished(exitCode == 0, isCancelled(exitCode));
+    runWithDeadline("yay --aur", "Updating AUR Packages...", AurUpdateTimeoutMs, [this](QString, int exitCode){
+        finishOperation(exitCode == 0, exitCode);
     });
 }
 
 void PackageManager::cleanAurLeftovers() {
     m_runner->run("yay -Yc", "Cleaning AUR leftovers...", false, false, [this](QString, int exitCode){
         bool success = (exitCode == 0 || exitCode == 1);
-        emit operationFinished(success, isCancelled(exitCode));
+        finishOperation(success, exitCode);
     });
 }
 
@@ -245,7 +1050,7 @@ void PackageManager::installOfflineUpdater() {
     QString cmd = "yay -S systemd-system-update-pacman --noconfirm --sudo pkexec --sudoflags \"\"";
 
     m_runner->run(cmd, "Installing offline update tool...", false, false, [this](QString, int exitCode){
-        emit operationFinished(exitCode == 0, isCancelled(exitCode));
+        finishOperation(exitCode == 0, exitCode);
     });
 }
 
@@ -253,32 +1058,32 @@ void PackageManager::installOfflineUpdaterManual() {
     emit statusMessageChanged("Installing build dependencies...");
 
     // Step 1: Ensure git and base-devel are installed before trying to build
-    QString step1 = "pacman -S --needed git base-devel --noconfirm";
+    QString step1 = "uptater-op install --needed git base-devel";
 
     m_runner->run(step1, "Preparing system...", false, true, [this](QString, int exitCode){
-        if (exitCode != 0) { emit operationFinished(false, isCancelled(exitCode)); return; }
+        if (exitCode != 0) { finishOperation(false, exitCode); return; }
 
         emit statusMessageChanged("Cloning offline updater from AUR...");
         QString step2 = "rm -rf /tmp/sysup && git clone https://aur.archlinux.org/systemd-system-update-pacman.git /tmp/sysup";
 
         // Step 2: Clone Repo (User Space)
-        m_runner->run(step2, "Cloning repository...", false, false, [this](QString, int exitCode){
-            if(exitCode != 0) { emit operationFinished(false, isCancelled(exitCode)); return; }
+        runWithDeadline(step2, "Cloning repository...", FetchTimeoutMs, [this](QString, int exitCode){
+            if(exitCode != 0) { finishOperation(false, exitCode); return; }
 
             emit statusMessageChanged("Building offline update package...");
 
             // Step 3: Compile and explicitly skip debug packages (User Space)
             QString step3 = "cd /tmp/sysup && echo 'options=(!debug)' >> PKGBUILD && makepkg -c --noconfirm";
 
-            m_runner->run(step3, "Building package...", false, false, [this](QString, int exitCode){
-                if(exitCode != 0) { emit operationFinished(false, isCancelled(exitCode)); return; }
+            runWithDeadline(step3, "Building package...", BuildTimeoutMs, [this](QString, int exitCode){
+                if(exitCode != 0) { finishOperation(false, exitCode); return; }
 
                 emit statusMessageChanged("Waiting for password to install final package...");
                 QString step4 = "pacman -U /tmp/sysup/*.pkg.tar.zst --noconfirm";
 
                 // Step 4: Install the final compiled package (Requires Root)
-                m_runner->run(step4, "Installing package...", false, true, [this](QString, int exitCode){
-                    emit operationFinished(exitCode == 0, isCancelled(exitCode));
+                runWithOwnPrompt(step4, "Installing package...", [this](QString, int exitCode){
+                    finishOperation(exitCode == 0, exitCode);
                 });
             });
         });
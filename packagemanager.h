@@ -3,9 +3,35 @@
 #include <QObject>
 #include <QStringList>
 #include <QList>
+#include <QHash>
+#include <QCache>
+#include <functional>
+#include <memory>
 #include "dashboardwidget.h"
+#include "cachescanner.h"
+#include "cacheplanner.h"
+#include "fileindex.h"
+#include "packagesearch.h"
+#include "systemstats.h"
 
 class CommandRunner;
+class QFileSystemWatcher;
+class QTimer;
+class LocalDatabase;
+class DependencyGraph;
+class PackageTable;
+class CriticalSet;
+class SyncDatabaseFetcher;
+
+// Dependency-installed packages nothing needed keeps alive, ready for one pacman -Rns
+struct OrphanRemovalPlan {
+    QStringList removable;          // orphans and packages only orphans depend on
+    qint64 removableBytes = 0;      // installed size
+    QStringList optionalOnly;       // only optional dependencies of needed packages point here
+    qint64 optionalOnlyBytes = 0;
+
+    bool isEmpty() const { return removable.isEmpty() && optionalOnly.isEmpty(); }
+};
 
 class PackageManager : public QObject
 {
@@ -16,15 +42,48 @@ public:
 
     // High-level operations
     void checkSystemUpdates();
-    void installSystemUpdates(bool offlineUpdate, bool autoCleanCache, int oldVersionsToKeep);
+    void cancelUpdateCheck();
+    bool isCheckingUpdates() const;
+    // Server URL templates ($repo, $arch) to use for update checks instead of pacman.conf's mirrors
+    void setSyncServers(const QStringList& servers) { m_syncServers = servers; }
+    void installSystemUpdates(bool offlineUpdate, bool autoCleanCache, const CacheRetentionPolicy& retention);
     void cancelScheduledUpdate();
     void fetchPackageList(DashboardWidget::PackageFilter filter);
 
+    // Dependency graph of the current local database, built on a worker once per database change
+    void withDependencyGraph(std::function<void(std::shared_ptr<const LocalDatabase>, std::shared_ptr<const DependencyGraph>)> callback);
+    // Critical-package rules compiled against the current local database
+    void compileCriticalRules(const QStringList& rules, std::function<void(std::shared_ptr<const CriticalSet>)> callback);
+    // Details pane data; the version is left empty if name isn't installed. A cached package is
+    // answered at once; otherwise callback runs with what the dependency graph knows and again
+    // once the rest has been read from disk. Every answer carries the call's request number,
+    // higher for later calls, so a late answer can be recognised as stale.
+    void describePackage(const QString& name, std::function<void(const PackageDetails&)> callback);
+    // Loads details of names into the cache before they are asked for, nearest first and a few
+    // at a time; a new call replaces whatever the previous one left unread
+    void prefetchPackageDetails(const QStringList& names);
+    // Owners of a path, file name or path fragment, like pacman -Qo and -F; an empty query
+    // only makes sure the index is ready
+    void searchFiles(const QString& query);
+    // Sync repo packages matching query, best first, each marked with its installed version
+    void searchRepositories(const QString& query);
+    // Recomputes on workers whichever dashboard statistics' sources changed since the last call
+    void refreshStatistics();
+
     // Utilities
-    void runRawCommand(const QString& cmd, const QString& desc);
-    void cleanCache(int oldVersionsToKeep);
+    // Scripts pass allowHelper = false so they always get their own pkexec prompt
+    void runRawCommand(const QString& cmd, const QString& desc, bool allowHelper = true);
+    // Works out on a worker which cached files a retention policy removes, without touching anything
+    void planCacheCleanup(const CacheRetentionPolicy& policy, std::function<void(const CacheCleanupPlan&)> callback);
+    // Deletes exactly the planned files in one privileged batch
+    void cleanCache(const CacheCleanupPlan& plan);
+    // Removes every package file in every CacheDir pacman.conf names
     void clearAllCache();
-    void deleteCachedPackage(const QString& fileName);
+    void planOrphanRemoval(std::function<void(const OrphanRemovalPlan&)> callback);
+    // pacman -Rns on all of names in a single transaction
+    void removePackages(const QStringList& names);
+    // filePath is absolute; its .sig goes with it
+    void deleteCachedPackage(const QString& filePath);
     void repairKeyring();
 
     // Yay & AUR Tooling
@@ -37,12 +96,127 @@ public:
 
 signals:
     void updatesCheckFinished(const QList<UpdatePackageInfo>& updates, bool errorFound);
-    void packageListFetched(const QStringList& packages);
-    void operationFinished(bool success, bool cancelled);
+    // Rows of table the current installed-package filter selected, in name order
+    void packageRowsFetched(std::shared_ptr<const PackageTable> table, const QList<quint32>& rows);
+    void cachedPackagesFetched(const QList<CachedPackage>& packages);
+    void fileOwnersFound(const QList<FileOwner>& owners);
+    void repositoryPackagesFound(const QList<PackageSearchResult>& packages);
+    void packageListFinished(int count);
+    // Sent once per part of stats that was recomputed
+    void statisticsChanged(const SystemStats& stats);
+    // The local database changed under a listing that was already shown, by us or by anything else
+    void installedPackagesChanged();
+    // Files were added to or removed from a CacheDir outside a listing we asked for
+    void cachedPackagesChanged();
+    void operationFinished(bool success, bool cancelled, bool timedOut);
     void statusMessageChanged(const QString& message);
 
 private:
     bool isCancelled(int exitCode);
+    void finishOperation(bool success, int exitCode);
+    // Watches DBPath, its local and sync directories and the CacheDirs for other pacman processes
+    void watchPacmanDirectories();
+    // Acts on what the watcher saw once no transaction holds db.lck
+    void applyPacmanChanges();
+    void invalidateCacheListing();
+    // Runs callback with a current snapshot of the local database, loading it on a worker first if needed
+    void withLocalDatabase(std::function<void(std::shared_ptr<const LocalDatabase>)> callback);
+    // Joins the local database against the sync databases under syncDbPath on a worker
+    void computeUpdates(const QString& syncDbPath);
+    void refreshLocalDatabase();
+    // Runs callback with the file index, first updating it on a worker if the local database moved on
+    void withFileIndex(std::function<void(std::shared_ptr<const FileIndex>)> callback);
+    // Columnar view of the current local database, built on a worker once per database change
+    void withPackageTable(std::function<void(std::shared_ptr<const PackageTable>)> callback);
+    // Same for the repository search index; it is checked again after every database sync
+    void withSearchIndex(std::function<void(std::shared_ptr<const PackageSearchIndex>)> callback);
+    // Reads the on-disk part of details, for db's package at index, on a worker; caches the
+    // result and passes it to callback. prefetch loads count against MaxDetailPrefetches.
+    void loadPackageDetails(std::shared_ptr<const LocalDatabase> db, int index, const PackageDetails& details,
+                            std::function<void(const PackageDetails&)> callback, bool prefetch);
+    void startPrefetches();
+    // Drops the details cache once the local database it was read from is replaced
+    void useDetailsSource(std::shared_ptr<const LocalDatabase> db);
+    void removeCachedFiles(const CacheCleanupPlan& plan, const QString& description, std::function<void(int)> done);
+    // Root jobs that do more than the helper's operations (installing packages built here,
+    // placing binaries) skip the helper and get a pkexec prompt of their own
+    void runWithOwnPrompt(const QString& command, const QString& description, std::function<void(QString, int)> callback);
+    // User-space steps that can stall on a dead mirror or a hung build are stopped after timeoutMs,
+    // and the operation finishes as timed out
+    void runWithDeadline(const QString& command, const QString& description, int timeoutMs, std::function<void(QString, int)> callback);
 
     CommandRunner* m_runner;
+    SyncDatabaseFetcher* m_syncFetcher;
+    // Private copy of the sync databases that update checks refresh and read
+    QString m_syncDbPath;
+    QStringList m_syncServers;
+    int m_listGeneration = 0;
+    std::shared_ptr<const LocalDatabase> m_localDb;
+    QString m_localDbSnapshotPath;
+    bool m_localDbLoading = false;
+    // Loaded from last session's file and not yet checked against the live database
+    bool m_localDbProvisional = false;
+    // An operation finished since m_localDb was read
+    bool m_localDbDirty = false;
+    // Fingerprint of the database listings were last drawn from; 0 before the first
+    quint64 m_localDbServedFingerprint = 0;
+    QList<std::function<void(std::shared_ptr<const LocalDatabase>)>> m_localDbWaiters;
+    std::shared_ptr<const DependencyGraph> m_dependencyGraph;
+    // The database m_dependencyGraph was built from
+    std::shared_ptr<const LocalDatabase> m_dependencyGraphSource;
+    bool m_dependencyGraphLoading = false;
+    QList<std::function<void(std::shared_ptr<const LocalDatabase>, std::shared_ptr<const DependencyGraph>)>> m_dependencyGraphWaiters;
+    std::shared_ptr<const PackageTable> m_packageTable;
+    std::shared_ptr<const LocalDatabase> m_packageTableSource;
+    bool m_packageTableLoading = false;
+    QList<std::function<void(std::shared_ptr<const PackageTable>)>> m_packageTableWaiters;
+    QString m_fileIndexPath;
+    std::shared_ptr<const FileIndex> m_fileIndex;
+    // The local database m_fileIndex was last checked against
+    std::shared_ptr<const LocalDatabase> m_fileIndexSource;
+    bool m_fileIndexLoading = false;
+    QList<std::function<void(std::shared_ptr<const FileIndex>)>> m_fileIndexWaiters;
+    QString m_searchIndexPath;
+    std::shared_ptr<const PackageSearchIndex> m_searchIndex;
+    // Sync databases may have changed since m_searchIndex was checked
+    bool m_searchIndexDirty = true;
+    bool m_searchIndexLoading = false;
+    QList<std::function<void(std::shared_ptr<const PackageSearchIndex>)>> m_searchIndexWaiters;
+    // Rows of each installed-package filter, for m_filterRowsTable only
+    QHash<int, QList<quint32>> m_filterRows;
+    std::shared_ptr<const PackageTable> m_filterRowsTable;
+    QList<CachedPackage> m_cachedPackages;
+    bool m_cachedPackagesValid = false;
+    // Bumped whenever a CacheDir may have changed, so a scan started before that isn't kept
+    int m_cacheChangeCount = 0;
+    QFileSystemWatcher* m_pacmanWatcher;
+    QTimer* m_pacmanChangeTimer;
+    QString m_watchedDbPath;
+    enum PacmanChange { LocalChange = 1, SyncChange = 2, CacheChange = 4 };
+    int m_pendingPacmanChanges = 0;
+    // Details read so far, bounded by their approximate size in bytes; least recently used go first
+    QCache<QString, PackageDetails> m_detailsCache;
+    std::shared_ptr<const LocalDatabase> m_detailsCacheSource;
+    // Loads in flight by package, each with the database it reads and whoever is waiting for it
+    struct DetailsLoad {
+        quint64 id = 0;
+        std::shared_ptr<const LocalDatabase> db;
+        QList<std::function<void(const PackageDetails&)>> waiters;
+    };
+    QHash<QString, DetailsLoad> m_detailsLoads;
+    quint64 m_lastDetailsLoad = 0;
+    quint64 m_lastDetailsRequest = 0;
+    // Prefetches waiting for one of the few worker slots they may take at once
+    static constexpr int MaxDetailPrefetches = 4;
+    // Deadlines for the AUR steps: a clone or download, one package's makepkg, a whole yay --aur run
+    static constexpr int FetchTimeoutMs = 10 * 60 * 1000;
+    static constexpr int BuildTimeoutMs = 60 * 60 * 1000;
+    static constexpr int AurUpdateTimeoutMs = 8 * 60 * 60 * 1000;
+    QStringList m_pendingPrefetches;
+    int m_activePrefetches = 0;
+    SystemStats m_stats;
+    // What each part of m_stats was last computed from; set when its worker starts
+    quint64 m_statsFingerprint = 0;
+    QString m_statsCacheStamp;
+    QString m_statsLogStamp;
 };
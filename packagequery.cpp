@@ -0,0 +1,209 @@
+#include "packagequery.h"
+#include "packagetable.h"
+#include "vercmp.h"
+#include <QDateTime>
+#include <QLatin1String>
+#include <algorithm>
+#include <string_view>
+
+static std::string_view toStdView(QByteArrayView view)
+{
+    return std::string_view(view.data(), size_t(view.size()));
+}
+
+void PackageQuery::takeOperator(QString* value, Op* op)
+{
+    static const struct { QLatin1String text; Op op; } operators[] = {
+        { QLatin1String(">="), Op::GreaterEqual }, { QLatin1String("<="), Op::LessEqual },
+        { QLatin1String(">"), Op::Greater }, { QLatin1String("<"), Op::Less }, { QLatin1String("="), Op::Equal },
+    };
+    for (const auto& candidate : operators) {
+        if (value->startsWith(candidate.text)) {
+            value->remove(0, candidate.text.size());
+            *op = candidate.op;
+            return;
+        }
+    }
+}
+
+// "100M", "1.5G", "512KiB" or plain bytes; -1 if it isn't a size
+static qint64 parseSize(const QString& value)
+{
+    static const QRegularExpression pattern("^(\\d+(?:\\.\\d+)?)([KMGT]?)(?:i?B)?$", QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatch match = pattern.match(value);
+    if (!match.hasMatch()) return -1;
+
+    double number = match.captured(1).toDouble();
+    QString unit = match.captured(2).toUpper();
+    switch (unit.isEmpty() ? '\0' : unit[0].toLatin1()) {
+        case 'T': number *= 1024.0;
+            [[fallthrough]];
+        case 'G': number *= 1024.0;
+            [[fallthrough]];
+        case 'M': number *= 1024.0;
+            [[fallthrough]];
+        case 'K': number *= 1024.0;
+            break;
+        default: break;
+    }
+    return qint64(number);
+}
+
+PackageQuery PackageQuery::parse(const QString& text)
+{
+    PackageQuery query;
+    const QStringList words = text.simplified().split(' ', Qt::SkipEmptyParts);
+
+    for (QString word : words) {
+        Term term;
+        if (word.size() > 1 && word.startsWith('-')) {
+            term.negated = true;
+            word.remove(0, 1);
+        }
+
+        QString value = word;
+        qsizetype colon = word.indexOf(':');
+        if (colon > 0 && !word.startsWith('/')) {
+            QString key = word.left(colon).toLower();
+            value = word.mid(colon + 1);
+            if (key == "name") term.field = Field::Name;
+            else if (key == "version" || key == "ver") term.field = Field::Version;
+            else if (key == "repo") term.field = Field::Repo;
+            else if (key == "size") term.field = Field::Size;
+            else if (key == "installed" || key == "date") term.field = Field::InstallDate;
+            else if (key == "reason") term.field = Field::Reason;
+            else {
+                query.m_error = QString("Unknown field \"%1\"").arg(key);
+                return query;
+            }
+        }
+        if (value.isEmpty()) continue;
+
+        switch (term.field) {
+            case Field::Name:
+            case Field::Version:
+                if (value.size() > 2 && value.startsWith('/') && value.endsWith('/')) {
+                    term.op = Op::Regex;
+                    term.regex = QRegularExpression(value.mid(1, value.size() - 2), QRegularExpression::CaseInsensitiveOption);
+                    if (!term.regex.isValid()) {
+                        query.m_error = QString("Bad pattern: %1").arg(term.regex.errorString());
+                        return query;
+                    }
+                } else {
+                    term.text = value.toLower().toUtf8();
+                }
+                break;
+
+            case Field::Repo:
+                // Foreign packages have no repo, so they match an empty name
+                term.op = Op::Equal;
+                value = value.toLower();
+                if (value != "foreign" && value != "aur" && value != "local") term.text = value.toUtf8();
+                break;
+
+            case Field::Size: {
+                term.op = Op::GreaterEqual;
+                takeOperator(&value, &term.op);
+                term.low = parseSize(value);
+                if (term.low < 0) {
+                    query.m_error = QString("Bad size \"%1\" (try 100M or 1.5G)").arg(value);
+                    return query;
+                }
+                term.high = term.low + 1;
+                break;
+            }
+
+            case Field::InstallDate: {
+                term.op = Op::GreaterEqual;
+                takeOperator(&value, &term.op);
+                QDate date = QDate::fromString(value, Qt::ISODate);
+                if (!date.isValid()) {
+                    query.m_error = QString("Bad date \"%1\" (try 2024-01-31)").arg(value);
+                    return query;
+                }
+                term.low = date.startOfDay().toSecsSinceEpoch();
+                term.high = date.addDays(1).startOfDay().toSecsSinceEpoch();
+                break;
+            }
+
+            case Field::Reason:
+                term.op = Op::Equal;
+                if (value.startsWith("exp", Qt::CaseInsensitive)) term.low = 1;
+                else if (value.startsWith("dep", Qt::CaseInsensitive)) term.low = 0;
+                else {
+                    query.m_error = QString("Bad reason \"%1\" (explicit or dependency)").arg(value);
+                    return query;
+                }
+                break;
+        }
+        query.m_terms.append(term);
+    }
+    return query;
+}
+
+bool PackageQuery::matchTerm(const Term& term, const PackageTable& table, quint32 row)
+{
+    auto inRange = [&term](qint64 value) {
+        switch (term.op) {
+            case Op::Less:         return value < term.low;
+            case Op::LessEqual:    return value < term.high;
+            case Op::Greater:      return value >= term.high;
+            case Op::GreaterEqual: return value >= term.low;
+            default:               return value >= term.low && value < term.high;
+        }
+    };
+
+    switch (term.field) {
+        case Field::Name:
+        case Field::Version: {
+            QByteArrayView value = term.field == Field::Name ? table.name(row) : table.version(row);
+            if (term.op == Op::Regex) return term.regex.match(QString::fromUtf8(value)).hasMatch();
+            // Names and versions are ASCII, so a Latin-1 comparison folds case correctly
+            return QLatin1String(value.data(), value.size()).contains(QLatin1String(term.text), Qt::CaseInsensitive);
+        }
+        case Field::Repo:        return table.repo(row) == QByteArrayView(term.text);
+        case Field::Size:        return inRange(table.installedSize(row));
+        case Field::InstallDate: return inRange(table.installDate(row));
+        case Field::Reason:      return table.isExplicit(row) == (term.low == 1);
+    }
+    return false;
+}
+
+bool PackageQuery::matches(const PackageTable& table, quint32 row) const
+{
+    for (const Term& term : m_terms) {
+        if (matchTerm(term, table, row) == term.negated) return false;
+    }
+    return true;
+}
+
+QList<quint32> PackageQuery::run(const PackageTable& table, const QList<quint32>& rows, SortKey key, Qt::SortOrder order,
+                                 const std::function<bool()>& cancelled) const
+{
+    QList<quint32> result;
+    result.reserve(rows.size());
+    for (qsizetype i = 0; i < rows.size(); ++i) {
+        if ((i & 1023) == 0 && cancelled && cancelled()) return {};
+        if (matches(table, rows[i])) result.append(rows[i]);
+    }
+
+    // Rows arrive in name order, so a stable sort leaves ties sorted by name
+    auto less = [&table, key](quint32 a, quint32 b) {
+        switch (key) {
+            case SortKey::Version:     return vercmp(toStdView(table.version(a)), toStdView(table.version(b))) < 0;
+            case SortKey::Repository:  return toStdView(table.repo(a)) < toStdView(table.repo(b));
+            case SortKey::Size:        return table.installedSize(a) < table.installedSize(b);
+            case SortKey::InstallDate: return table.installDate(a) < table.installDate(b);
+            default:                   return false;
+        }
+    };
+    if (key != SortKey::Name) {
+        if (order == Qt::AscendingOrder) std::stable_sort(result.begin(), result.end(), less);
+        else std::stable_sort(result.begin(), result.end(), [&less](quint32 a, quint32 b){ return less(b, a); });
+    } else if (order == Qt::DescendingOrder) {
+        std::reverse(result.begin(), result.end());
+    }
+
+    if (cancelled && cancelled()) return {};
+    return result;
+}
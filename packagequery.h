@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+#include <functional>
+
+class PackageTable;
+
+// The filter field of the installed-package views. Whitespace separated terms, all of which
+// must match:
+//   word                  name contains word, ignoring case
+//   /regex/               name matches regex; name:/regex/ and version:/regex/ work too
+//   name:x, version:x     that field contains x
+//   repo:extra            from that sync repo; repo:foreign for AUR and local packages
+//   size:>100M            installed size against >, >=, <, <= or = (>= if none), K/M/G/T 1024-based
+//   installed:<2024-01-01 install date, same operators, by whole days
+//   reason:explicit       or reason:dependency
+//   -term                 any of the above, negated
+class PackageQuery
+{
+public:
+    // The installed views' columns, in order, which are also what results sort by
+    enum class SortKey { Name, Version, Repository, Size, InstallDate };
+
+    static PackageQuery parse(const QString& text);
+
+    bool isEmpty() const { return m_terms.isEmpty(); }
+    // Why the query can't run (an unknown field, a bad pattern, size or date); empty if it can
+    QString error() const { return m_error; }
+    bool matches(const PackageTable& table, quint32 row) const;
+
+    // The matching rows of rows, which must be in table (name) order, sorted by key. Checks
+    // cancelled() as it goes and returns nothing once it says so.
+    QList<quint32> run(const PackageTable& table, const QList<quint32>& rows, SortKey key, Qt::SortOrder order,
+                       const std::function<bool()>& cancelled) const;
+
+private:
+    enum class Field { Name, Version, Repo, Size, InstallDate, Reason };
+    enum class Op { Contains, Regex, Equal, Less, LessEqual, Greater, GreaterEqual };
+
+    struct Term {
+        Field field = Field::Name;
+        Op op = Op::Contains;
+        bool negated = false;
+        QByteArray text;            // what Contains looks for; the repo name for Repo
+        QRegularExpression regex;
+        // Comparisons test against [low, high): one byte wide for sizes, a day for dates.
+        // For Reason, low is 1 for explicit.
+        qint64 low = 0;
+        qint64 high = 0;
+    };
+
+    // Splits a leading comparison off value; op is left alone if there is none
+    static void takeOperator(QString* value, Op* op);
+    static bool matchTerm(const Term& term, const PackageTable& table, quint32 row);
+
+    QList<Term> m_terms;
+    QString m_error;
+};
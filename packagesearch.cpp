@@ -0,0 +1,253 @@
+#include "packagesearch.h"
+#include "syncdatabase.h"
+#include "localdatabase.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QRegularExpression>
+#include <QtConcurrent>
+#include <algorithm>
+#include <numeric>
+#include <sys/stat.h>
+
+// Saved index: QDataStream (Qt_6_0) of magic, format version, the database stamps, the
+// string pool's arena and offsets, the package columns and the posting lists. Bump the version whenever any of them changes shape.
+static const quint32 kIndexMagic = 0x55505349; // "UPSI"
+static const quint32 kIndexVersion = 2;
+
+static quint32 trigramAt(const char* data)
+{
+    return (quint32(uchar(data[0])) << 16) | (quint32(uchar(data[1])) << 8) | quint32(uchar(data[2]));
+}
+
+static void collectTrigrams(QByteArrayView utf8, QList<quint32>& out)
+{
+    for (qsizetype i = 0; i + 3 <= utf8.size(); ++i) out.append(trigramAt(utf8.data() + i));
+}
+
+PackageSearchIndex::Stamp PackageSearchIndex::stampFile(const QString& path)
+{
+    Stamp stamp;
+    stamp.path = path;
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) == 0) {
+        stamp.mtimeNs = static_cast<qint64>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        stamp.size = st.st_size;
+    }
+    return stamp;
+}
+
+std::shared_ptr<const PackageSearchIndex> PackageSearchIndex::update(const QString& indexPath, const QStringList& repos, const QStringList& dbFiles)
+{
+    QList<Stamp> stamps;
+    for (const QString& dbFile : dbFiles) stamps.append(stampFile(dbFile));
+
+    std::shared_ptr<PackageSearchIndex> saved = load(indexPath);
+    if (saved && saved->m_stamps == stamps) return saved;
+
+    // One repo per thread, as for update checks
+    QList<qsizetype> order(repos.size());
+    std::iota(order.begin(), order.end(), 0);
+    const QList<QList<SyncPackage>> sync = QtConcurrent::blockingMapped<QList<QList<SyncPackage>>>(order, [&repos, &dbFiles](qsizetype i){
+        return SyncDatabase::readPackages(dbFiles.value(i), repos[i]);
+    });
+
+    auto index = std::make_shared<PackageSearchIndex>();
+    index->m_stamps = stamps;
+    StringPool& strings = index->m_strings;
+    for (const QList<SyncPackage>& repo : sync) {
+        for (const SyncPackage& pkg : repo) {
+            QStringList aliases = pkg.groups;
+            for (const QString& provide : pkg.provides) aliases << LocalDatabase::dependencyName(provide);
+
+            index->m_names.append(strings.intern(pkg.name));
+            index->m_versions.append(strings.intern(pkg.version));
+            index->m_repos.append(strings.intern(pkg.repo));
+            index->m_descriptions.append(strings.intern(pkg.description));
+            index->m_keys.append(strings.intern(pkg.name.toLower()));
+            index->m_aliases.append(strings.intern(aliases.join('\n').toLower()));
+            index->m_texts.append(strings.intern(pkg.description.toLower()));
+            index->addTrigrams(quint32(index->m_names.size() - 1));
+        }
+    }
+
+    index->save(indexPath);
+    return index;
+}
+
+void PackageSearchIndex::addTrigrams(quint32 package)
+{
+    // Fields are collected apart so no trigram spans two of them
+    QList<quint32> trigrams;
+    collectTrigrams(m_strings.view(m_keys[package]), trigrams);
+    collectTrigrams(m_strings.view(m_aliases[package]), trigrams);
+    collectTrigrams(m_strings.view(m_texts[package]), trigrams);
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    // Packages are added in order, so every posting list stays sorted
+    for (quint32 trigram : trigrams) m_postings[trigram].append(package);
+}
+
+std::shared_ptr<PackageSearchIndex> PackageSearchIndex::load(const QString& indexPath)
+{
+    QFile file(indexPath);
+    if (!file.open(QIODevice::ReadOnly)) return nullptr;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, version;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != kIndexMagic || version != kIndexVersion) return nullptr;
+
+    auto index = std::make_shared<PackageSearchIndex>();
+    quint32 stampCount;
+    in >> stampCount;
+    for (quint32 i = 0; i < stampCount && in.status() == QDataStream::Ok; ++i) {
+        Stamp stamp;
+        in >> stamp.path >> stamp.mtimeNs >> stamp.size;
+        index->m_stamps.append(stamp);
+    }
+
+    QByteArray arena;
+    QList<quint32> offsets;
+    in >> arena >> offsets;
+    in >> index->m_names >> index->m_versions >> index->m_repos >> index->m_descriptions
+       >> index->m_keys >> index->m_aliases >> index->m_texts >> index->m_postings;
+    if (in.status() != QDataStream::Ok || !index->m_strings.fromRaw(arena, offsets)) return nullptr;
+
+    // Columns have to line up and may only refer to strings the pool holds
+    const qsizetype count = index->m_names.size();
+    for (const QList<quint32>* column : { &index->m_names, &index->m_versions, &index->m_repos, &index->m_descriptions,
+                                          &index->m_keys, &index->m_aliases, &index->m_texts }) {
+        if (column->size() != count) return nullptr;
+        for (quint32 id : *column) {
+            if (id >= index->m_strings.count()) return nullptr;
+        }
+    }
+    // Posting lists are used as package ids and intersected as they are: every id has to be a
+    // package, in strictly ascending order, as addTrigrams() leaves them
+    for (const QList<quint32>& postings : std::as_const(index->m_postings)) {
+        for (qsizetype i = 0; i < postings.size(); ++i) {
+            if (postings[i] >= quint64(count) || (i > 0 && postings[i] <= postings[i - 1])) return nullptr;
+        }
+    }
+    return index;
+}
+
+bool PackageSearchIndex::save(const QString& indexPath) const
+{
+    QDir().mkpath(QFileInfo(indexPath).absolutePath());
+    QSaveFile file(indexPath);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kIndexMagic << kIndexVersion;
+    out << quint32(m_stamps.size());
+    for (const Stamp& stamp : m_stamps) out << stamp.path << stamp.mtimeNs << stamp.size;
+    out << m_strings.arena() << m_strings.offsets();
+    out << m_names << m_versions << m_repos << m_descriptions << m_keys << m_aliases << m_texts << m_postings;
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool PackageSearchIndex::candidates(const QByteArray& term, QList<quint32>* out) const
+{
+    if (term.size() < 3) return false;
+
+    QList<const QList<quint32>*> lists;
+    for (qsizetype i = 0; i + 3 <= term.size(); ++i) {
+        auto it = m_postings.constFind(trigramAt(term.constData() + i));
+        if (it == m_postings.constEnd()) {
+            out->clear();
+            return true;
+        }
+        lists.append(&it.value());
+    }
+
+    // Shortest list first keeps every intersection as small as it can be
+    std::sort(lists.begin(), lists.end(), [](const QList<quint32>* a, const QList<quint32>* b){ return a->size() < b->size(); });
+    *out = *lists.first();
+    QList<quint32> merged;
+    for (qsizetype i = 1; i < lists.size() && !out->isEmpty(); ++i) {
+        merged.clear();
+        std::set_intersection(out->cbegin(), out->cend(), lists[i]->cbegin(), lists[i]->cend(), std::back_inserter(merged));
+        out->swap(merged);
+    }
+    return true;
+}
+
+int PackageSearchIndex::score(quint32 package, QByteArrayView term) const
+{
+    QByteArrayView key = m_strings.view(m_keys[package]);
+    if (key == term) return 100;
+    if (key.startsWith(term)) return 60;
+    if (key.contains(term)) return 40;
+    if (m_strings.view(m_aliases[package]).contains(term)) return 20;
+    if (m_strings.view(m_texts[package]).contains(term)) return 5;
+    return 0;
+}
+
+QList<PackageSearchResult> PackageSearchIndex::search(const QString& query, int limit) const
+{
+    QList<PackageSearchResult> results;
+    QList<QByteArray> terms;
+    for (const QString& term : query.toLower().split(QRegularExpression("\\s+"), Qt::SkipEmptyParts)) terms << term.toUtf8();
+    if (terms.isEmpty() || limit <= 0) return results;
+
+    // Trigrams only narrow things down; every candidate is still checked term by term below
+    QList<quint32> pool;
+    bool narrowed = false;
+    for (const QByteArray& term : terms) {
+        QList<quint32> found;
+        if (!candidates(term, &found)) continue;
+        if (!narrowed) {
+            pool = found;
+            narrowed = true;
+            continue;
+        }
+        QList<quint32> merged;
+        std::set_intersection(pool.cbegin(), pool.cend(), found.cbegin(), found.cend(), std::back_inserter(merged));
+        pool.swap(merged);
+    }
+    if (!narrowed) {
+        pool.resize(m_names.size());
+        std::iota(pool.begin(), pool.end(), 0);
+    }
+
+    QList<std::pair<int, quint32>> ranked;
+    for (quint32 id : pool) {
+        int total = 0;
+        for (const QByteArray& term : terms) {
+            int termScore = score(id, term);
+            if (termScore == 0) { total = 0; break; }
+            total += termScore;
+        }
+        if (total > 0) ranked.append({ total, id });
+    }
+
+    // Best score first, then shorter names (the package itself before its plugins), then by name
+    auto better = [this](const std::pair<int, quint32>& a, const std::pair<int, quint32>& b){
+        if (a.first != b.first) return a.first > b.first;
+        QByteArrayView ka = m_strings.view(m_keys[a.second]);
+        QByteArrayView kb = m_strings.view(m_keys[b.second]);
+        if (ka.size() != kb.size()) return ka.size() < kb.size();
+        return ka.compare(kb) < 0;
+    };
+    qsizetype count = std::min<qsizetype>(limit, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(), better);
+
+    results.reserve(count);
+    for (qsizetype i = 0; i < count; ++i) {
+        quint32 id = ranked[i].second;
+        PackageSearchResult result;
+        result.name = m_strings.string(m_names[id]);
+        result.version = m_strings.string(m_versions[id]);
+        result.repo = m_strings.string(m_repos[id]);
+        result.description = m_strings.string(m_descriptions[id]);
+        results.append(result);
+    }
+    return results;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <memory>
+#include "stringpool.h"
+
+struct PackageSearchResult {
+    QString name;
+    QString version;
+    QString repo;
+    QString description;
+    QString installedVersion;   // empty if not installed
+
+    bool isInstalled() const { return !installedVersion.isEmpty(); }
+};
+
+// Search over every sync repo's names, descriptions, groups and provides. Each package's
+// lowercased text is broken into trigrams with a sorted posting list per trigram, so a
+// query only verifies the packages holding all of its trigrams instead of every package.
+// Packages are columns of string pool ids; matching runs on the pooled UTF-8 bytes.
+class PackageSearchIndex
+{
+public:
+    // Loads the index saved at indexPath if it was built from exactly these database files,
+    // otherwise builds it from them and saves it there. dbFiles is parallel to repos.
+    // Blocking; call it from a worker.
+    static std::shared_ptr<const PackageSearchIndex> update(const QString& indexPath, const QStringList& repos, const QStringList& dbFiles);
+
+    int packageCount() const { return m_names.size(); }
+
+    // Every whitespace-separated term has to appear somewhere in a package; exact and
+    // prefix name matches rank first, description-only matches last
+    QList<PackageSearchResult> search(const QString& query, int limit) const;
+
+private:
+    // A database file as it was when the index was built
+    struct Stamp {
+        QString path;
+        qint64 mtimeNs = 0;
+        qint64 size = -1;
+        bool operator==(const Stamp& other) const { return path == other.path && mtimeNs == other.mtimeNs && size == other.size; }
+    };
+    static Stamp stampFile(const QString& path);
+
+    static std::shared_ptr<PackageSearchIndex> load(const QString& indexPath);
+    bool save(const QString& indexPath) const;
+    void addTrigrams(quint32 package);
+
+    // Packages holding every trigram of term, ascending; false if term is too short to have any
+    bool candidates(const QByteArray& term, QList<quint32>* out) const;
+    // 0 if term appears nowhere in package, otherwise higher the closer it is to the name
+    int score(quint32 package, QByteArrayView term) const;
+
+    QList<Stamp> m_stamps;
+    StringPool m_strings;
+    // One entry per package, each a pool id
+    QList<quint32> m_names;
+    QList<quint32> m_versions;
+    QList<quint32> m_repos;
+    QList<quint32> m_descriptions;
+    QList<quint32> m_keys;          // lowercased name
+    QList<quint32> m_aliases;       // lowercased provides and groups, one per line
+    QList<quint32> m_texts;         // lowercased description
+    QHash<quint32, QList<quint32>> m_postings;
+};
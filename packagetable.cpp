@@ -0,0 +1,30 @@
+#include "packagetable.h"
+
+std::shared_ptr<PackageTable> PackageTable::fromLocal(const LocalDatabase& db)
+{
+    auto table = std::make_shared<PackageTable>();
+    const QList<LocalPackage>& packages = db.packages();
+    const qsizetype count = packages.size();
+
+    table->m_emptyString = table->m_strings.intern(QByteArrayView());
+    table->m_names.reserve(count);
+    table->m_versions.reserve(count);
+    table->m_repos.reserve(count);
+    table->m_flags.reserve(count);
+    table->m_orphans.reserve(count);
+    table->m_sizes.reserve(count);
+    table->m_installDates.reserve(count);
+
+    // Repos collapse to a handful of ids and versions repeat across split packages
+    for (qsizetype i = 0; i < count; ++i) {
+        const LocalPackage& pkg = packages[i];
+        table->m_names.append(table->m_strings.intern(pkg.name));
+        table->m_versions.append(table->m_strings.intern(pkg.version));
+        table->m_repos.append(table->m_strings.intern(pkg.repo));
+        table->m_flags.append(pkg.explicitlyInstalled ? Explicit : 0);
+        table->m_orphans.append(db.orphanKind(i));
+        table->m_sizes.append(pkg.installedSize);
+        table->m_installDates.append(pkg.installDate);
+    }
+    return table;
+}
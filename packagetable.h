@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <memory>
+#include "stringpool.h"
+#include "localdatabase.h"
+
+// The installed packages as columns indexed by a dense row id (the local database's order,
+// so sorted by name), with every string interned in one pool. Views filter and sort row ids
+// and only turn the few strings they show into QStrings.
+class PackageTable
+{
+public:
+    // Copied from db's decoded records, which stay: the table is an index for the views
+    // on top of them, not a replacement, and costs its pool on top of their memory
+    static std::shared_ptr<PackageTable> fromLocal(const LocalDatabase& db);
+
+    quint32 rowCount() const { return quint32(m_names.size()); }
+
+    QByteArrayView name(quint32 row) const { return m_strings.view(m_names[row]); }
+    QByteArrayView version(quint32 row) const { return m_strings.view(m_versions[row]); }
+    QByteArrayView repo(quint32 row) const { return m_strings.view(m_repos[row]); }
+    QString nameString(quint32 row) const { return m_strings.string(m_names[row]); }
+    QString versionString(quint32 row) const { return m_strings.string(m_versions[row]); }
+
+    bool isExplicit(quint32 row) const { return m_flags[row] & Explicit; }
+    bool isForeign(quint32 row) const { return m_repos[row] == m_emptyString; }
+    OrphanKind orphanKind(quint32 row) const { return m_orphans[row]; }
+    qint64 installedSize(quint32 row) const { return m_sizes[row]; }
+    qint64 installDate(quint32 row) const { return m_installDates[row]; }
+
+    const StringPool& strings() const { return m_strings; }
+
+private:
+    enum Flag : quint8 { Explicit = 1 };
+
+    StringPool m_strings;
+    quint32 m_emptyString = 0;
+    QList<quint32> m_names;
+    QList<quint32> m_versions;
+    QList<quint32> m_repos;
+    QList<quint8> m_flags;
+    QList<OrphanKind> m_orphans;
+    QList<qint64> m_sizes;
+    QList<qint64> m_installDates;
+};
@@ -3,6 +3,7 @@
 #include <QTextStream>
 #include <QDir>
 #include <QRegularExpression>
+#include <sys/utsname.h>
 
 PacmanConfigManager::PacmanConfigManager(QObject *parent) : QObject(parent)
 {
@@ -58,13 +59,9 @@ void PacmanConfigManager::readConfig()
     }
 }
 
-void PacmanConfigManager::writeConfig()
+QString PacmanConfigManager::applyOptions(const QString& text, const QMap<QString, bool>& toggles, int parallelDownloads)
 {
-    QFile inputFile(PACMAN_CONF_PATH);
-    if (!inputFile.open(QIODevice::ReadOnly | QIODevice::Text)) return;
-    QStringList lines = QTextStream(&inputFile).readAll().split('\n');
-    inputFile.close();
-
+    QStringList lines = text.split('\n');
     QStringList optionsFound;
     bool inOptionsSection = false;
 
@@ -78,16 +75,15 @@ void PacmanConfigManager::writeConfig()
         QString cleanLine = isCommented ? trimmedLine.mid(1).trimmed() : trimmedLine;
 
         for (const QString& option : PACMAN_TOGGLE_OPTIONS) {
-            if (cleanLine.startsWith(option)) {
-                lines[i] = m_pacmanConfigToggles[option] ? option : "#" + option;
+            if (toggles.contains(option) && cleanLine.startsWith(option)) {
+                lines[i] = toggles[option] ? option : "#" + option;
                 optionsFound << option;
             }
         }
 
-        if (cleanLine.startsWith("ParallelDownloads")) {
-            QString newLine = QString("ParallelDownloads = %1").arg(m_parallelDownloadsCount);
-            if (!m_pacmanConfigToggles["ParallelDownloads"]) newLine.prepend("#");
-            lines[i] = newLine;
+        // Switching it off keeps whatever count the line had
+        if (toggles.contains("ParallelDownloads") && cleanLine.startsWith("ParallelDownloads")) {
+            lines[i] = toggles["ParallelDownloads"] ? QString("ParallelDownloads = %1").arg(parallelDownloads) : "#" + cleanLine;
             optionsFound << "ParallelDownloads";
         }
     }
@@ -97,30 +93,187 @@ void PacmanConfigManager::writeConfig()
 
     if (optionsIndex != -1) {
         for (const QString& option : PACMAN_TOGGLE_OPTIONS) {
-            if (m_pacmanConfigToggles[option] && !optionsFound.contains(option)) {
+            if (toggles.value(option) && !optionsFound.contains(option)) {
                 lines.insert(optionsIndex + 1, option);
             }
         }
     }
+    return lines.join('\n');
+}
+
+void PacmanConfigManager::writeConfig()
+{
+    // The helper rewrites pacman.conf itself from these; no file of ours is copied over it
+    QStringList parameters;
+    if (!m_backupCreated) {
+        parameters << "--backup";
+        m_backupCreated = true;
+    }
+    for (const QString& option : PACMAN_TOGGLE_OPTIONS) {
+        parameters << QString("%1=%2").arg(option, m_pacmanConfigToggles[option] ? "on" : "off");
+    }
+    parameters << (m_pacmanConfigToggles["ParallelDownloads"] ? QString("ParallelDownloads=%1").arg(m_parallelDownloadsCount)
+                                                             : QString("ParallelDownloads=off"));
+
+    emit commandRequested("uptater-op write-config " + parameters.join(' '), "Applying pacman.conf changes...");
+}
+
+QStringList PacmanConfigManager::readCacheDirs(const QString& configPath)
+{
+    QStringList dirs;
+
+    QFile configFile(configPath);
+    if (configFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream in(&configFile);
+        bool inOptionsSection = false;
+
+        while (!in.atEnd()) {
+            QString trimmedLine = in.readLine().trimmed();
+
+            if (trimmedLine.startsWith("[options]")) { inOptionsSection = true; continue; }
+            if (trimmedLine.startsWith("[")) { inOptionsSection = false; continue; }
+            if (!inOptionsSection || !trimmedLine.startsWith("CacheDir")) continue;
+
+            // A single CacheDir line may list several space separated directories
+            for (const QString& dir : trimmedLine.section('=', 1).split(' ', Qt::SkipEmptyParts)) {
+                QString clean = QDir::cleanPath(dir);
+                if (!dirs.contains(clean)) dirs << clean;
+            }
+        }
+    }
+
+    if (dirs.isEmpty()) dirs << "/var/cache/pacman/pkg";
+    return dirs;
+}
+
+QStringList PacmanConfigManager::readRepositories(const QString& configPath)
+{
+    QStringList repos;
+
+    QFile configFile(configPath);
+    if (configFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream in(&configFile);
+        while (!in.atEnd()) {
+            QString trimmedLine = in.readLine().trimmed();
+            if (!trimmedLine.startsWith("[") || !trimmedLine.endsWith("]")) continue;
+
+            QString section = trimmedLine.mid(1, trimmedLine.size() - 2).trimmed();
+            if (section != "options" && !section.isEmpty() && !repos.contains(section)) repos << section;
+        }
+    }
+    return repos;
+}
+
+QString PacmanConfigManager::readDBPath(const QString& configPath)
+{
+    QString dbPath = "/var/lib/pacman/";
+
+    QFile configFile(configPath);
+    if (configFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream in(&configFile);
+        bool inOptionsSection = false;
+
+        while (!in.atEnd()) {
+            QString trimmedLine = in.readLine().trimmed();
+
+            if (trimmedLine.startsWith("[options]")) { inOptionsSection = true; continue; }
+            if (trimmedLine.startsWith("[")) { inOptionsSection = false; continue; }
+            if (!inOptionsSection || trimmedLine.section('=', 0, 0).trimmed() != "DBPath") continue;
+
+            QString value = trimmedLine.section('=', 1).trimmed();
+            if (!value.isEmpty()) dbPath = QDir::cleanPath(value) + "/";
+        }
+    }
+    return dbPath;
+}
+
+QString PacmanConfigManager::readLogFile(const QString& configPath)
+{
+    // A single path without spaces, so the list reader covers it; pacman keeps the last one given
+    QStringList values = readOptionList("LogFile", configPath);
+    return values.isEmpty() ? QString("/var/log/pacman.log") : QDir::cleanPath(values.last());
+}
+
+QStringList PacmanConfigManager::readOptionList(const QString& key, const QString& configPath)
+{
+    QStringList values;
+
+    QFile configFile(configPath);
+    if (configFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream in(&configFile);
+        bool inOptionsSection = false;
+
+        while (!in.atEnd()) {
+            QString trimmedLine = in.readLine().trimmed();
+
+            if (trimmedLine.startsWith("[options]")) { inOptionsSection = true; continue; }
+            if (trimmedLine.startsWith("[")) { inOptionsSection = false; continue; }
+            if (!inOptionsSection || trimmedLine.section('=', 0, 0).trimmed() != key) continue;
+
+            values << trimmedLine.section('=', 1).split(' ', Qt::SkipEmptyParts);
+        }
+    }
+    return values;
+}
+
+// Server lines of a mirrorlist-style file, unsubstituted
+static QStringList readServerLines(const QString& path)
+{
+    QStringList servers;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return servers;
+
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QString trimmedLine = in.readLine().trimmed();
+        if (trimmedLine.section('=', 0, 0).trimmed() != "Server") continue;
+        QString url = trimmedLine.section('=', 1).trimmed();
+        if (!url.isEmpty()) servers << url;
+    }
+    return servers;
+}
+
+QMap<QString, QStringList> PacmanConfigManager::readServers(const QString& configPath)
+{
+    QMap<QString, QStringList> servers;
+    QString arch = readArchitecture(configPath);
+
+    QFile configFile(configPath);
+    if (configFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream in(&configFile);
+        QString section;
 
-    QString tempPath = QDir::temp().filePath("pacman.conf.new");
-    QFile outFile(tempPath);
-    if (outFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QTextStream out(&outFile);
-        out << lines.join('\n');
-        outFile.close();
-
-        QString command;
-        if (!m_backupCreated) {
-            command = QString("cp %1 %1.uptater.bak && cp %2 %1").arg(PACMAN_CONF_PATH, tempPath);
-            m_backupCreated = true;
-        } else {
-            command = QString("cp %1 %2").arg(tempPath, PACMAN_CONF_PATH);
+        while (!in.atEnd()) {
+            QString trimmedLine = in.readLine().trimmed();
+
+            if (trimmedLine.startsWith("[") && trimmedLine.endsWith("]")) {
+                section = trimmedLine.mid(1, trimmedLine.size() - 2).trimmed();
+                continue;
+            }
+            if (section.isEmpty() || section == "options") continue;
+
+            QString key = trimmedLine.section('=', 0, 0).trimmed();
+            QString value = trimmedLine.section('=', 1).trimmed();
+            QStringList urls;
+            if (key == "Server" && !value.isEmpty()) urls << value;
+            else if (key == "Include") urls = readServerLines(value);
+
+            for (QString url : urls) {
+                url.replace("$repo", section).replace("$arch", arch);
+                if (!servers[section].contains(url)) servers[section] << url;
+            }
         }
+    }
+    return servers;
+}
 
-        // Clean emission without redundant "sudo sh -c"
-        emit commandRequested(command, "Applying pacman.conf changes...");
+QString PacmanConfigManager::readArchitecture(const QString& configPath)
+{
+    for (const QString& arch : readOptionList("Architecture", configPath)) {
+        if (arch != "auto") return arch;
     }
+    struct utsname name;
+    return uname(&name) == 0 ? QString::fromLatin1(name.machine) : QString("x86_64");
 }
 
 bool PacmanConfigManager::isOptionEnabled(const QString &optionName) const
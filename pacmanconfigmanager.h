@@ -20,6 +20,25 @@ public:
     bool isOptionEnabled(const QString& optionName) const;
     int getParallelDownloadsCount() const;
 
+    // Every CacheDir from [options], falling back to pacman's default
+    static QStringList readCacheDirs(const QString& configPath = PACMAN_CONF_PATH);
+    // Repository sections in the order pacman searches them
+    static QStringList readRepositories(const QString& configPath = PACMAN_CONF_PATH);
+    // DBPath from [options], with a trailing slash, falling back to pacman's default
+    static QString readDBPath(const QString& configPath = PACMAN_CONF_PATH);
+    // All space separated values of a repeatable [options] key such as IgnorePkg
+    static QStringList readOptionList(const QString& key, const QString& configPath = PACMAN_CONF_PATH);
+    // LogFile from [options], falling back to pacman's default
+    static QString readLogFile(const QString& configPath = PACMAN_CONF_PATH);
+    // Mirror URLs of every repository, in preference order, with Include files followed
+    // and $repo/$arch already substituted
+    static QMap<QString, QStringList> readServers(const QString& configPath = PACMAN_CONF_PATH);
+    // pacman.conf text with the toggles named in toggles (PACMAN_TOGGLE_OPTIONS and
+    // ParallelDownloads, set to parallelDownloads when on) switched, every other line kept
+    static QString applyOptions(const QString& text, const QMap<QString, bool>& toggles, int parallelDownloads);
+    // Architecture from [options], resolving "auto" the way pacman does
+    static QString readArchitecture(const QString& configPath = PACMAN_CONF_PATH);
+
 public slots:
     void toggleOption(const QString& optionName);
     void setParallelDownloadsCount(int value);
@@ -0,0 +1,496 @@
+#include "privilegedhelper.h"
+#include "pacmanconfigmanager.h"
+#include <QCoreApplication>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QFile>
+#include <QStandardPaths>
+#include <QDataStream>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QMap>
+#include <QFileInfo>
+#include <QDir>
+#include <QTimer>
+#include <QtEndian>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <cstdlib>
+#include <memory>
+#include <csignal>
+#include <fcntl.h>
+#include <pwd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+QByteArray HelperProtocol::encode(quint8 type, const QByteArray& payload)
+{
+    QByteArray frame(5, Qt::Uninitialized);
+    qToBigEndian<quint32>(static_cast<quint32>(payload.size()), frame.data());
+    frame[4] = static_cast<char>(type);
+    frame.append(payload);
+    return frame;
+}
+
+bool HelperProtocol::decode(QByteArray& buffer, quint8* type, QByteArray* payload)
+{
+    if (buffer.size() < 5) return false;
+    quint32 length = qFromBigEndian<quint32>(buffer.constData());
+    if (buffer.size() < 5 + static_cast<qsizetype>(length)) return false;
+
+    *type = static_cast<quint8>(buffer[4]);
+    *payload = buffer.mid(5, length);
+    buffer.remove(0, 5 + length);
+    return true;
+}
+
+PrivilegedHelper::PrivilegedHelper(uid_t callerUid, QObject* parent)
+: QObject(parent), m_server(new QLocalServer(this)), m_socketPath(socketPath(callerUid)), m_callerUid(callerUid)
+{
+    connect(m_server, &QLocalServer::newConnection, this, &PrivilegedHelper::onNewConnection);
+}
+
+QString PrivilegedHelper::socketPath(uid_t uid)
+{
+    return QString("/run/uptater-%1/helper.sock").arg(uid);
+}
+
+bool PrivilegedHelper::listen()
+{
+    // Only root can create entries in /run, so a directory found there is one we made
+    // earlier; anything else under that name (a link, another owner) is refused
+    QByteArray dir = QFile::encodeName(QFileInfo(m_socketPath).path());
+    struct stat info;
+    if (mkdir(dir.constData(), 0711) != 0 && errno != EEXIST) return false;
+    if (lstat(dir.constData(), &info) != 0 || !S_ISDIR(info.st_mode) || info.st_uid != 0) return false;
+    if (chmod(dir.constData(), 0711) != 0) return false;
+
+    QLocalServer::removeServer(m_socketPath);
+    if (!m_server->listen(m_socketPath)) return false;
+
+    // The socket itself is the caller's alone; connections are checked again in onNewConnection()
+    QByteArray path = QFile::encodeName(m_socketPath);
+    struct passwd* pw = getpwuid(m_callerUid);
+    if (!pw || fchownat(AT_FDCWD, path.constData(), m_callerUid, pw->pw_gid, AT_SYMLINK_NOFOLLOW) != 0
+        || chmod(path.constData(), 0600) != 0) {
+        m_server->close();
+        return false;
+    }
+    return true;
+}
+
+// Programs are looked up in root's own PATH, never the caller's
+static const QStringList kRootPath = { "/usr/local/sbin", "/usr/local/bin", "/usr/bin" };
+
+bool PrivilegedHelper::isPackageName(const QString& name)
+{
+    static const QRegularExpression pattern("^[A-Za-z0-9@_+][A-Za-z0-9@._+-]{0,254}$");
+    return pattern.match(name).hasMatch();
+}
+
+// path rebuilt on its parent's real location, if that is one of cacheDirs (already canonical)
+// and the name is a package file or a signature; empty otherwise
+static QString resolveCachedFile(const QString& path, const QStringList& cacheDirs)
+{
+    static const QRegularExpression packageFile("\\.pkg\\.tar(\\.[A-Za-z0-9]+)?(\\.sig)?$");
+    QFileInfo info(path);
+    if (!info.isAbsolute() || !packageFile.match(info.fileName()).hasMatch()) return QString();
+
+    // Resolving the parent keeps a symlinked directory or ".." from pointing the removal elsewhere
+    QString parent = QFileInfo(info.absolutePath()).canonicalFilePath();
+    if (parent.isEmpty() || !cacheDirs.contains(parent)) return QString();
+    return parent + "/" + info.fileName();
+}
+
+static QStringList canonicalCacheDirs()
+{
+    QStringList dirs;
+    for (const QString& dir : PacmanConfigManager::readCacheDirs()) {
+        QString canonical = QFileInfo(dir).canonicalFilePath();
+        if (!canonical.isEmpty()) dirs << canonical;
+    }
+    return dirs;
+}
+
+// write-config's parameters; returns what is wrong with them, if anything
+static QString parseConfigParameters(const QStringList& parameters, QMap<QString, bool>* toggles, int* parallelDownloads, bool* backup)
+{
+    for (const QString& parameter : parameters) {
+        if (parameter == "--backup") {
+            *backup = true;
+            continue;
+        }
+        QString key = parameter.section('=', 0, 0);
+        QString value = parameter.section('=', 1);
+        if (key == "ParallelDownloads") {
+            bool ok = false;
+            int count = value.toInt(&ok);
+            if (value == "off") toggles->insert(key, false);
+            else if (ok && count >= 1 && count <= 99) {
+                toggles->insert(key, true);
+                *parallelDownloads = count;
+            }
+            else return QString("ParallelDownloads takes a count from 1 to 99 or off, not \"%1\"").arg(value);
+        }
+        else if (PACMAN_TOGGLE_OPTIONS.contains(key) && (value == "on" || value == "off")) {
+            toggles->insert(key, value == "on");
+        }
+        else return QString("write-config does not take \"%1\"").arg(parameter);
+    }
+    return toggles->isEmpty() ? "write-config needs at least one option" : QString();
+}
+
+QString PrivilegedHelper::plan(const QString& operation, const QStringList& parameters, QStringList* argv)
+{
+    argv->clear();
+
+    if (operation == "write-config") {
+        QMap<QString, bool> toggles;
+        int parallelDownloads = 0;
+        bool backup = false;
+        return parseConfigParameters(parameters, &toggles, &parallelDownloads, &backup);
+    }
+
+    // Flags come first; anything starting with '-' later on is rejected with them
+    QStringList flags;
+    QStringList operands;
+    for (const QString& parameter : parameters) {
+        if (parameter.startsWith('-')) flags << parameter;
+        else operands << parameter;
+    }
+    auto checkFlags = [&operation, &flags](const QStringList& allowed) {
+        for (const QString& flag : flags) {
+            if (!allowed.contains(flag)) return QString("%1 does not take %2").arg(operation, flag);
+        }
+        return QString();
+    };
+    auto checkPackages = [&operation, &operands]() {
+        if (operands.isEmpty()) return QString("%1 needs at least one package").arg(operation);
+        for (const QString& name : operands) {
+            if (!isPackageName(name)) return QString("\"%1\" is not a package name").arg(name);
+        }
+        return QString();
+    };
+    auto noOperands = [&operation, &operands]() {
+        return operands.isEmpty() ? QString() : QString("%1 takes no arguments").arg(operation);
+    };
+
+    QString error;
+    if (operation == "upgrade") {
+        if (!(error = checkFlags({"--download-only"})).isEmpty() || !(error = noOperands()).isEmpty()) return error;
+        *argv = { "pacman", flags.isEmpty() ? "-Syu" : "-Syuw", "--noconfirm" };
+        return QString();
+    }
+    if (operation == "install") {
+        if (!(error = checkFlags({"--needed", "--refresh"})).isEmpty() || !(error = checkPackages()).isEmpty()) return error;
+        *argv = { "pacman", flags.contains("--refresh") ? "-Sy" : "-S", "--noconfirm" };
+        if (flags.contains("--needed")) *argv << "--needed";
+        *argv << "--" << operands;
+        return QString();
+    }
+    if (operation == "remove") {
+        if (!(error = checkFlags({})).isEmpty() || !(error = checkPackages()).isEmpty()) return error;
+        *argv = QStringList{ "pacman", "-Rns", "--noconfirm", "--" } + operands;
+        return QString();
+    }
+    if (operation == "clean-cache") {
+        if (!(error = checkFlags({})).isEmpty()) return error;
+        if (operands.isEmpty()) return "clean-cache needs at least one file";
+        const QStringList cacheDirs = canonicalCacheDirs();
+        for (const QString& path : operands) {
+            if (resolveCachedFile(path, cacheDirs).isEmpty()) return QString("%1 is not a package file in a CacheDir").arg(path);
+        }
+        return QString();
+    }
+    if (operation == "refresh-mirrors") {
+        static const QRegularExpression country("^\\p{L}[\\p{L} .,'()-]{0,63}$");
+        if (!(error = checkFlags({})).isEmpty()) return error;
+        if (operands.size() != 1 || !country.match(operands.first()).hasMatch()) return "refresh-mirrors takes one country name";
+        *argv = { "reflector", "--verbose", "--country", operands.first(), "--protocol", "https", "--sort", "rate", "--save", "/etc/pacman.d/mirrorlist" };
+        return QString();
+    }
+    if (operation == "populate-keyring" || operation == "schedule-update" || operation == "cancel-scheduled-update") {
+        if (!parameters.isEmpty()) return QString("%1 takes no arguments").arg(operation);
+        if (operation == "populate-keyring") *argv = { "pacman-key", "--populate", "archlinux" };
+        else if (operation == "schedule-update") *argv = { "schedule-system-update" };
+        return QString();
+    }
+    return QString("'%1' is not a helper operation").arg(operation);
+}
+
+int PrivilegedHelper::perform(const QString& operation, const QStringList& parameters, QString* error)
+{
+    if (operation == "clean-cache") {
+        // Like rm -f: a file that is already gone is not an error
+        const QStringList cacheDirs = canonicalCacheDirs();
+        int failures = 0;
+        for (const QString& path : parameters) {
+            QString resolved = resolveCachedFile(path, cacheDirs);
+            if (resolved.isEmpty() || ::unlink(QFile::encodeName(resolved).constData()) == 0 || errno == ENOENT) continue;
+            *error += QString("could not remove %1: %2\n").arg(resolved, QString::fromLocal8Bit(strerror(errno)));
+            ++failures;
+        }
+        return failures ? 1 : 0;
+    }
+
+    if (operation == "cancel-scheduled-update") {
+        if (::unlink("/system-update") == 0 || errno == ENOENT) return 0;
+        *error = QString("could not remove /system-update: %1\n").arg(QString::fromLocal8Bit(strerror(errno)));
+        return 1;
+    }
+
+    if (operation == "write-config") {
+        QMap<QString, bool> toggles;
+        int parallelDownloads = 0;
+        bool backup = false;
+        *error = parseConfigParameters(parameters, &toggles, &parallelDownloads, &backup);
+        if (!error->isEmpty()) return 1;
+
+        // The new file is derived from the one root owns; nothing the caller wrote is copied in
+        QFile current(PACMAN_CONF_PATH);
+        if (!current.open(QIODevice::ReadOnly)) {
+            *error = QString("could not read %1\n").arg(PACMAN_CONF_PATH);
+            return 1;
+        }
+        QByteArray original = current.readAll();
+        QByteArray updated = PacmanConfigManager::applyOptions(QString::fromUtf8(original), toggles, parallelDownloads).toUtf8();
+
+        auto writeFile = [error](const QString& path, const QByteArray& contents) {
+            QSaveFile file(path);
+            if (file.open(QIODevice::WriteOnly) && file.write(contents) == contents.size() && file.commit()) return true;
+            *error = QString("could not write %1\n").arg(path);
+            return false;
+        };
+        if (backup && !writeFile(PACMAN_CONF_PATH + ".uptater.bak", original)) return 1;
+        return writeFile(PACMAN_CONF_PATH, updated) ? 0 : 1;
+    }
+
+    *error = QString("'%1' is not carried out by the helper itself\n").arg(operation);
+    return 1;
+}
+
+int PrivilegedHelper::runDirect(const QString& operation, const QStringList& parameters)
+{
+    if (geteuid() != 0) {
+        fprintf(stderr, "uptater: %s needs root\n", qPrintable(operation));
+        return 1;
+    }
+
+    QStringList argv;
+    QString rejection = plan(operation, parameters, &argv);
+    if (!rejection.isEmpty()) {
+        fprintf(stderr, "uptater: %s\n", rejection.toLocal8Bit().constData());
+        return 1;
+    }
+    if (argv.isEmpty()) {
+        QString error;
+        int exitCode = perform(operation, parameters, &error);
+        fputs(error.toLocal8Bit().constData(), stderr);
+        return exitCode;
+    }
+
+    QString program = QStandardPaths::findExecutable(argv.first(), kRootPath);
+    if (program.isEmpty()) {
+        fprintf(stderr, "uptater: %s not found\n", qPrintable(argv.first()));
+        return 127;
+    }
+    argv[0] = program;
+
+    std::vector<QByteArray> storage;
+    for (const QString& arg : argv) storage.push_back(arg.toLocal8Bit());
+    std::vector<char*> args;
+    for (QByteArray& arg : storage) args.push_back(arg.data());
+    args.push_back(nullptr);
+    execv(args[0], args.data());
+    perror("uptater");
+    return 127;
+}
+
+void PrivilegedHelper::onNewConnection()
+{
+    while (QLocalSocket* socket = m_server->nextPendingConnection()) {
+        // Whatever the socket's mode, only processes of the user pkexec authenticated get in
+        struct ucred peer {};
+        socklen_t length = sizeof(peer);
+        if (getsockopt(int(socket->socketDescriptor()), SOL_SOCKET, SO_PEERCRED, &peer, &length) != 0
+            || peer.uid != m_callerUid) {
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+
+        auto buffer = std::make_shared<QByteArray>();
+
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket, buffer](){
+            buffer->append(socket->readAll());
+            quint8 type;
+            QByteArray payload;
+            while (HelperProtocol::decode(*buffer, &type, &payload)) {
+                handleMessage(socket, type, payload);
+            }
+        });
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void PrivilegedHelper::handleMessage(QLocalSocket* socket, quint8 type, const QByteArray& payload)
+{
+    if (type == HelperProtocol::Session && !m_hasSession) {
+        // The GUI holding this connection is our lifetime; once it goes, so do we
+        m_hasSession = true;
+        connect(socket, &QLocalSocket::disconnected, qApp, &QCoreApplication::quit);
+    }
+    else if (type == HelperProtocol::Request) {
+        startRequest(socket, payload);
+    }
+    else if (type == HelperProtocol::Cancel) {
+        signalRequest(socket, payload.toInt());
+    }
+}
+
+void PrivilegedHelper::signalRequest(QLocalSocket* socket, int sig)
+{
+    QProcess* process = m_requests.value(socket);
+    if (!process || process->processId() <= 0) return;
+
+    // pacman unwinds a transaction cleanly on SIGINT only; anything harsher mid-commit
+    // can leave the database locked or half-written
+    QString program = QFileInfo(process->program()).fileName();
+    if (program == "pacman" || program == "pacman-key") sig = SIGINT;
+    else if (sig != SIGINT && sig != SIGTERM && sig != SIGHUP && sig != SIGKILL) sig = SIGTERM;
+
+    ::kill(-static_cast<pid_t>(process->processId()), sig);
+}
+
+void PrivilegedHelper::startRequest(QLocalSocket* socket, const QByteArray& payload)
+{
+    QString operation;
+    QStringList parameters;
+    QDataStream stream(payload);
+    stream >> operation >> parameters;
+
+    QStringList argv;
+    QString rejection = stream.status() == QDataStream::Ok ? plan(operation, parameters, &argv) : "malformed request";
+    if (!rejection.isEmpty()) {
+        socket->write(HelperProtocol::encode(HelperProtocol::Rejected, rejection.toUtf8()));
+        return;
+    }
+
+    // Config writes and file removal are quick and done here, without a process
+    if (argv.isEmpty()) {
+        QString error;
+        int exitCode = perform(operation, parameters, &error);
+        if (!error.isEmpty()) socket->write(HelperProtocol::encode(HelperProtocol::ErrorOutput, error.toUtf8()));
+        socket->write(HelperProtocol::encode(HelperProtocol::Exit, QByteArray::number(exitCode)));
+        socket->flush();
+        return;
+    }
+
+    auto *process = new QProcess(this);
+    QProcessEnvironment env;
+    env.insert("PATH", "/usr/local/sbin:/usr/local/bin:/usr/bin");
+    env.insert("HOME", "/root");
+    env.insert("LC_ALL", "C");
+    env.insert("TERM", "dumb");
+    process->setProcessEnvironment(env);
+    process->setWorkingDirectory("/");
+    process->setStandardInputFile(QProcess::nullDevice());
+    process->setChildProcessModifier([](){ setpgid(0, 0); });
+    m_requests.insert(socket, process);
+
+    connect(process, &QProcess::readyReadStandardOutput, socket, [process, socket](){
+        socket->write(HelperProtocol::encode(HelperProtocol::Output, process->readAllStandardOutput()));
+    });
+    connect(process, &QProcess::readyReadStandardError, socket, [process, socket](){
+        socket->write(HelperProtocol::encode(HelperProtocol::ErrorOutput, process->readAllStandardError()));
+    });
+    connect(process, &QProcess::finished, socket, [this, process, socket](int exitCode, QProcess::ExitStatus status){
+        m_requests.remove(socket);
+        socket->write(HelperProtocol::encode(HelperProtocol::Exit, QByteArray::number(status == QProcess::NormalExit ? exitCode : 1)));
+        socket->flush();
+        process->deleteLater();
+    });
+    connect(process, &QProcess::errorOccurred, socket, [this, process, socket](QProcess::ProcessError error){
+        if (error != QProcess::FailedToStart) return;
+        m_requests.remove(socket);
+        socket->write(HelperProtocol::encode(HelperProtocol::Exit, "127"));
+        process->deleteLater();
+    });
+    // A client that goes away takes its command with it
+    connect(socket, &QLocalSocket::disconnected, this, [this, socket](){
+        signalRequest(socket, SIGTERM);
+        m_requests.remove(socket);
+    });
+
+    QString program = QStandardPaths::findExecutable(argv.takeFirst(), kRootPath);
+    if (program.isEmpty()) {
+        m_requests.remove(socket);
+        socket->write(HelperProtocol::encode(HelperProtocol::Exit, "127"));
+        process->deleteLater();
+        return;
+    }
+    process->start(program, argv);
+}
+
+int PrivilegedHelper::exec(int argc, char** argv)
+{
+    if (geteuid() != 0) {
+        fprintf(stderr, "uptater: the privileged helper must be started through pkexec\n");
+        return 1;
+    }
+
+    const char* callerUidEnv = getenv("PKEXEC_UID");
+    if (!callerUidEnv) {
+        fprintf(stderr, "uptater: PKEXEC_UID is not set\n");
+        return 1;
+    }
+    uid_t callerUid = static_cast<uid_t>(strtoul(callerUidEnv, nullptr, 10));
+
+    // Fork so pkexec (and the terminal job that ran it) returns as soon as we're listening
+    int readyPipe[2];
+    if (pipe(readyPipe) != 0) return 1;
+
+    pid_t pid = fork();
+    if (pid < 0) return 1;
+    if (pid > 0) {
+        close(readyPipe[1]);
+        char ready = 0;
+        ssize_t n = read(readyPipe[0], &ready, 1);
+        return (n == 1 && ready == 'R') ? 0 : 1;
+    }
+
+    close(readyPipe[0]);
+    setsid();
+
+    QCoreApplication app(argc, argv);
+    PrivilegedHelper helper(callerUid);
+    if (!helper.listen()) {
+        fprintf(stderr, "uptater: could not listen on %s\n", qPrintable(helper.m_socketPath));
+        return 1;
+    }
+
+    // Give the GUI a moment to attach its session connection before giving up
+    QTimer::singleShot(30000, &helper, [&helper](){
+        if (!helper.m_hasSession) QCoreApplication::quit();
+    });
+
+    (void)!write(readyPipe[1], "R", 1);
+    close(readyPipe[1]);
+
+    int devNull = open("/dev/null", O_RDWR);
+    if (devNull >= 0) {
+        dup2(devNull, STDIN_FILENO);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+        if (devNull > STDERR_FILENO) close(devNull);
+    }
+
+    int result = app.exec();
+    QLocalServer::removeServer(helper.m_socketPath);
+    rmdir(QFile::encodeName(QFileInfo(helper.m_socketPath).path()).constData());
+    return result;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <sys/types.h>
+
+class QLocalServer;
+class QLocalSocket;
+class QProcess;
+
+// Wire format shared by the helper, its shim clients and the GUI session:
+// quint32 big-endian payload length, quint8 message type, payload bytes.
+namespace HelperProtocol {
+    enum MessageType : quint8 {
+        Session = 1,     // GUI keeps this connection open for the helper's lifetime
+        Request = 2,     // QDataStream: QString operation, QStringList parameters
+        Output = 3,      // raw stdout bytes
+        ErrorOutput = 4, // raw stderr bytes
+        Exit = 5,        // exit code as decimal text
+        Rejected = 6,    // reason as UTF-8 text
+        Cancel = 7       // client was signalled; signal number as decimal text
+    };
+
+    QByteArray encode(quint8 type, const QByteArray& payload = QByteArray());
+    // Pops one complete frame off the front of buffer, if there is one
+    bool decode(QByteArray& buffer, quint8* type, QByteArray* payload);
+}
+
+// Root side of the helper. Started once per session through pkexec, it runs only the named
+// operations below. Each one builds its own command line from checked parameters, so nothing
+// a client sends becomes a program, an option or a path without passing those checks:
+//   upgrade [--download-only]                  pacman -Syu (-Syuw)
+//   install [--needed] [--refresh] <pkg>...    pacman -S (-Sy) from the sync repos, never a file
+//   remove <pkg>...                            pacman -Rns
+//   clean-cache <file>...                      deletes package files and their signatures lying
+//                                              directly in a CacheDir pacman.conf names
+//   refresh-mirrors <country>                  reflector, saving to /etc/pacman.d/mirrorlist
+//   write-config [--backup] <Option>=on|off... [options] toggles of pacman.conf, rewritten by
+//                ParallelDownloads=<n>|off     the helper itself from the file it finds there
+//   populate-keyring                           pacman-key --populate archlinux
+//   schedule-update                            schedule-system-update
+//   cancel-scheduled-update                    removes /system-update
+class PrivilegedHelper : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PrivilegedHelper(uid_t callerUid, QObject* parent = nullptr);
+
+    // Where the helper for uid listens: /run/uptater-<uid>/helper.sock. The directory belongs
+    // to root, so nothing the user runs can swap the socket for a link before it is chowned.
+    static QString socketPath(uid_t uid);
+
+    bool listen();
+
+    // Returns the reason operation may not run with parameters, or an empty string. If it may,
+    // argv gets the program and arguments it runs; operations the helper carries out itself
+    // (see perform()) leave it empty.
+    static QString plan(const QString& operation, const QStringList& parameters, QStringList* argv);
+    // Carries out an operation plan() accepted without a command; returns its exit code and
+    // says what went wrong in error
+    static int perform(const QString& operation, const QStringList& parameters, QString* error);
+    // What pacman accepts as a package or group name; never an option, a path or a URL
+    static bool isPackageName(const QString& name);
+
+    // Entry point for "uptater --privileged-helper"
+    static int exec(int argc, char** argv);
+    // Runs an operation in this process, for a root shell pkexec started without the helper
+    static int runDirect(const QString& operation, const QStringList& parameters);
+
+private slots:
+    void onNewConnection();
+
+private:
+    void handleMessage(QLocalSocket* socket, quint8 type, const QByteArray& payload);
+    void startRequest(QLocalSocket* socket, const QByteArray& payload);
+    void signalRequest(QLocalSocket* socket, int sig);
+
+    QLocalServer* m_server;
+    QString m_socketPath;
+    uid_t m_callerUid;
+    bool m_hasSession = false;
+    // Running request per client connection, for Cancel and disconnects
+    QHash<QLocalSocket*, QProcess*> m_requests;
+};
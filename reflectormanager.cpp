@@ -32,7 +32,7 @@ void ReflectorManager::setup()
 
 void ReflectorManager::onInstallReflector()
 {
-    emit commandRequested("pacman -S reflector --noconfirm", "Installing Reflector...");
+    emit commandRequested("uptater-op install reflector", "Installing Reflector...");
 }
 
 void ReflectorManager::onPopulateMirrorlistMenu()
@@ -74,7 +74,9 @@ void ReflectorManager::onCountryListFetched(int exitCode)
 
     connect(countryListWidget, &QListWidget::itemClicked, this, [this, countryListWidget](QListWidgetItem* item){
         QString countryName = item->text();
-        QString command = QString("reflector --verbose --country \"%1\" --protocol https --sort rate --save /etc/pacman.d/mirrorlist").arg(countryName);
+        QString quotedName = countryName;
+        quotedName.replace("'", "'\\''");
+        QString command = QString("uptater-op refresh-mirrors '%1'").arg(quotedName);
         QString description = QString("Refreshing mirrorlist for \"%1\"...").arg(countryName);
 
         emit commandRequested(command, description);
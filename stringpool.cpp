@@ -0,0 +1,53 @@
+#include "stringpool.h"
+#include <QHashFunctions>
+#include <algorithm>
+
+quint32 StringPool::intern(QByteArrayView text)
+{
+    // Kept at most half full, so probes stay short
+    if (m_slots.isEmpty() || (count() + 1) * 2 > quint32(m_slots.size())) grow();
+
+    const quint32 mask = quint32(m_slots.size() - 1);
+    for (quint32 slot = quint32(qHash(text)) & mask; ; slot = (slot + 1) & mask) {
+        quint32 id = m_slots[slot];
+        if (id == EmptySlot) {
+            id = count();
+            m_arena.append(text.data(), text.size());
+            m_offsets.append(quint32(m_arena.size()));
+            m_slots[slot] = id;
+            return id;
+        }
+        if (view(id) == text) return id;
+    }
+}
+
+void StringPool::insertSlot(quint32 id)
+{
+    const quint32 mask = quint32(m_slots.size() - 1);
+    quint32 slot = quint32(qHash(view(id))) & mask;
+    while (m_slots[slot] != EmptySlot) slot = (slot + 1) & mask;
+    m_slots[slot] = id;
+}
+
+void StringPool::grow()
+{
+    m_slots.fill(EmptySlot, std::max<qsizetype>(64, m_slots.size() * 2));
+    for (quint32 id = 0; id < count(); ++id) insertSlot(id);
+}
+
+bool StringPool::fromRaw(const QByteArray& arena, const QList<quint32>& offsets)
+{
+    if (offsets.isEmpty() || offsets.first() != 0 || offsets.last() != quint32(arena.size())) return false;
+    for (qsizetype i = 1; i < offsets.size(); ++i) {
+        if (offsets[i] < offsets[i - 1]) return false;
+    }
+
+    m_arena = arena;
+    m_offsets = offsets;
+    m_slots.clear();
+    qsizetype size = 64;
+    while (size < qsizetype(count()) * 2 + 2) size *= 2;
+    m_slots.fill(EmptySlot, size);
+    for (quint32 id = 0; id < count(); ++id) insertSlot(id);
+    return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <QString>
+
+// Strings stored once, back to back as UTF-8 in one buffer, and referred to by dense id.
+// Interning the same bytes twice returns the same id; nothing is ever removed.
+class StringPool
+{
+public:
+    quint32 intern(QByteArrayView text);
+    quint32 intern(const QString& text) { return intern(QByteArrayView(text.toUtf8())); }
+
+    QByteArrayView view(quint32 id) const
+    {
+        return QByteArrayView(m_arena.constData() + m_offsets[id], m_offsets[id + 1] - m_offsets[id]);
+    }
+    QString string(quint32 id) const { return QString::fromUtf8(view(id)); }
+
+    quint32 count() const { return quint32(m_offsets.size() - 1); }
+    qsizetype byteSize() const { return m_arena.size(); }
+
+    // The arena and offsets as they are, for saving; fromRaw() takes them back and rebuilds
+    // the lookup table, or returns false if they don't describe a pool
+    const QByteArray& arena() const { return m_arena; }
+    const QList<quint32>& offsets() const { return m_offsets; }
+    bool fromRaw(const QByteArray& arena, const QList<quint32>& offsets);
+
+private:
+    void insertSlot(quint32 id);
+    void grow();
+
+    QByteArray m_arena;
+    QList<quint32> m_offsets = { 0 };   // id i spans [m_offsets[i], m_offsets[i + 1])
+    // Open addressing over ids; empty slots hold EmptySlot. Ids never move, so it
+    // needs no pointers into the arena, which reallocates as it grows.
+    QList<quint32> m_slots;
+    static constexpr quint32 EmptySlot = 0xffffffff;
+};
@@ -0,0 +1,171 @@
+#include "syncdatabase.h"
+#include <QFile>
+#include <archive.h>
+#include <archive_entry.h>
+#include <QHash>
+#include <algorithm>
+#include <charconv>
+#include <memory>
+
+QString SyncDatabase::databaseFile(const QString& dbPath, const QString& repo)
+{
+    return dbPath + "sync/" + repo + ".db";
+}
+
+QString SyncDatabase::filesDatabaseFile(const QString& dbPath, const QString& repo)
+{
+    return dbPath + "sync/" + repo + ".files";
+}
+
+// "<name>-<version>-<rel>/..." -> "<name>"; names may contain dashes, version and rel never do
+static QString packageNameFromEntry(const char* path)
+{
+    QByteArray dir(path);
+    qsizetype slash = dir.indexOf('/');
+    if (slash != -1) dir.truncate(slash);
+
+    qsizetype relDash = dir.lastIndexOf('-');
+    if (relDash <= 0) return QString();
+    qsizetype versionDash = dir.lastIndexOf('-', relDash - 1);
+    if (versionDash <= 0) return QString();
+    return QString::fromUtf8(dir.constData(), versionDash);
+}
+
+QString SyncDatabase::optionalDependencyName(QByteArrayView value)
+{
+    qsizetype colon = value.indexOf(':');
+    return QString::fromUtf8(colon == -1 ? value : value.first(colon)).trimmed();
+}
+
+using ArchiveReader = std::unique_ptr<struct archive, decltype(&archive_read_free)>;
+
+static ArchiveReader openArchive(const QString& dbFile)
+{
+    ArchiveReader reader(archive_read_new(), archive_read_free);
+    archive_read_support_filter_all(reader.get());
+    archive_read_support_format_all(reader.get());
+    if (archive_read_open_filename(reader.get(), QFile::encodeName(dbFile).constData(), 64 * 1024) != ARCHIVE_OK) reader.reset();
+    return reader;
+}
+
+QStringList SyncDatabase::readPackageNames(const QString& dbFile)
+{
+    QStringList names;
+    ArchiveReader reader = openArchive(dbFile);
+    if (!reader) return names;
+
+    struct archive_entry* entry;
+    while (archive_read_next_header(reader.get(), &entry) == ARCHIVE_OK) {
+        // Every package has exactly one desc entry; directories and other files are skipped
+        const char* path = archive_entry_pathname(entry);
+        if (path && QByteArray(path).endsWith("/desc")) {
+            QString name = packageNameFromEntry(path);
+            if (!name.isEmpty()) names << name;
+        }
+        archive_read_data_skip(reader.get());
+    }
+    return names;
+}
+
+QList<SyncPackage> SyncDatabase::readPackages(const QString& dbFile, const QString& repo)
+{
+    QList<SyncPackage> packages;
+    ArchiveReader reader = openArchive(dbFile);
+    if (!reader) return packages;
+
+    // Older databases split depends out of desc; both files of a package share its directory
+    QHash<QByteArray, qsizetype> byDirectory;
+    QByteArray data;
+
+    struct archive_entry* entry;
+    while (archive_read_next_header(reader.get(), &entry) == ARCHIVE_OK) {
+        QByteArray path(archive_entry_pathname(entry));
+        qsizetype slash = path.indexOf('/');
+        QByteArray file = slash == -1 ? QByteArray() : path.mid(slash + 1);
+        if (file != "desc" && file != "depends") {
+            archive_read_data_skip(reader.get());
+            continue;
+        }
+
+        data.resize(archive_entry_size(entry));
+        la_ssize_t read = archive_read_data(reader.get(), data.data(), data.size());
+        if (read < 0) continue;
+        data.truncate(read);
+
+        QByteArray directory = path.left(slash);
+        qsizetype index = byDirectory.value(directory, -1);
+        if (index == -1) {
+            index = packages.size();
+            byDirectory.insert(directory, index);
+            packages.append(SyncPackage());
+            packages.last().repo = repo;
+        }
+
+        SyncPackage& pkg = packages[index];
+        forEachDescField(data, [&pkg](QByteArrayView key, QByteArrayView value){
+            if (key == "%NAME%") pkg.name = QString::fromUtf8(value);
+            else if (key == "%VERSION%") pkg.version = QString::fromUtf8(value);
+            else if (key == "%DESC%") pkg.description = QString::fromUtf8(value);
+            else if (key == "%FILENAME%") pkg.fileName = QString::fromUtf8(value);
+            else if (key == "%CSIZE%") pkg.downloadSize = toNumber(value);
+            else if (key == "%ISIZE%") pkg.installedSize = toNumber(value);
+            else if (key == "%GROUPS%") pkg.groups << QString::fromUtf8(value);
+            else if (key == "%DEPENDS%") pkg.depends << QString::fromUtf8(value);
+            else if (key == "%OPTDEPENDS%") pkg.optDepends << optionalDependencyName(value);
+            else if (key == "%PROVIDES%") pkg.provides << QString::fromUtf8(value);
+        });
+    }
+
+    packages.removeIf([](const SyncPackage& pkg){ return pkg.name.isEmpty() || pkg.version.isEmpty(); });
+    return packages;
+}
+
+bool SyncDatabase::readFileLists(const QString& filesFile, const std::function<void(const QString& package, const QByteArray& files)>& list)
+{
+    ArchiveReader reader = openArchive(filesFile);
+    if (!reader) return false;
+
+    QByteArray data;
+    struct archive_entry* entry;
+    while (archive_read_next_header(reader.get(), &entry) == ARCHIVE_OK) {
+        // Besides "files" each package directory carries its desc, which isn't needed here
+        const char* path = archive_entry_pathname(entry);
+        if (!path || !QByteArray(path).endsWith("/files")) {
+            archive_read_data_skip(reader.get());
+            continue;
+        }
+
+        data.resize(archive_entry_size(entry));
+        la_ssize_t read = archive_read_data(reader.get(), data.data(), data.size());
+        if (read < 0) continue;
+        data.truncate(read);
+
+        QString name = packageNameFromEntry(path);
+        if (!name.isEmpty()) list(name, data);
+    }
+    return true;
+}
+
+void SyncDatabase::forEachDescField(const QByteArray& data, const std::function<void(QByteArrayView key, QByteArrayView value)>& field)
+{
+    // Views into data throughout; checksums and signatures are never copied, let alone converted
+    QByteArrayView key;
+    QByteArrayView rest(data);
+    while (!rest.isEmpty()) {
+        qsizetype end = rest.indexOf('\n');
+        if (end == -1) end = rest.size();
+        QByteArrayView line = rest.first(end);
+        rest = rest.sliced(std::min(end + 1, rest.size()));
+
+        if (line.isEmpty()) { key = QByteArrayView(); continue; }
+        if (line.size() > 2 && line.startsWith('%') && line.endsWith('%')) { key = line; continue; }
+        if (!key.isEmpty()) field(key, line);
+    }
+}
+
+qint64 SyncDatabase::toNumber(QByteArrayView value)
+{
+    qint64 number = 0;
+    std::from_chars(value.data(), value.data() + value.size(), number);
+    return number;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <functional>
+
+struct SyncPackage {
+    QString name;
+    QString version;
+    QString description;
+    QString repo;
+    QString fileName;
+    qint64 downloadSize = 0;    // compressed package, bytes
+    qint64 installedSize = 0;   // bytes
+    QStringList groups;
+    QStringList depends;
+    QStringList optDepends;     // names only
+    QStringList provides;
+};
+
+// Readers for the repository databases pacman keeps under <DBPath>sync/.
+// Each <repo>.db is a compressed tar with one "<name>-<version>-<rel>/desc" entry per package.
+namespace SyncDatabase {
+    // Path of a repo's database for the given DBPath (with trailing slash)
+    QString databaseFile(const QString& dbPath, const QString& repo);
+    // The matching file lists database (<repo>.files), present once pacman -Fy has run
+    QString filesDatabaseFile(const QString& dbPath, const QString& repo);
+
+    // Package names in one sync database, read from the entry paths alone; empty if unreadable
+    QStringList readPackageNames(const QString& dbFile);
+
+    // Every package record in one sync database; empty if unreadable
+    QList<SyncPackage> readPackages(const QString& dbFile, const QString& repo);
+
+    // Hands over each package's raw "files" entry from a .files database; false if unreadable
+    bool readFileLists(const QString& filesFile, const std::function<void(const QString& package, const QByteArray& files)>& list);
+
+    // Walks a desc-style file ("%KEY%", one value per line, blank line ends the section),
+    // the format shared by the local and sync databases. Key and value are views into data,
+    // so callers decode only the fields they keep.
+    void forEachDescField(const QByteArray& data, const std::function<void(QByteArrayView key, QByteArrayView value)>& field);
+
+    // Decimal field value, 0 if it isn't one
+    qint64 toNumber(QByteArrayView value);
+    // "python-pip: for installing modules" -> "python-pip"
+    QString optionalDependencyName(QByteArrayView value);
+}
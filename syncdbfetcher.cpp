@@ -0,0 +1,177 @@
+#include "syncdbfetcher.h"
+#include "syncdatabase.h"
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QUrl>
+
+SyncDatabaseFetcher::SyncDatabaseFetcher(QObject* parent)
+: QObject(parent), m_network(new QNetworkAccessManager(this))
+{
+}
+
+static QString etagFile(const QString& target) { return target + ".etag"; }
+
+void SyncDatabaseFetcher::fetch(const QString& dbPath, const QString& systemDbPath, const QStringList& repos, const QMap<QString, QStringList>& servers)
+{
+    if (isRunning()) return;
+
+    m_cancelled = false;
+    m_failedCount = 0;
+    m_downloadedCount = 0;
+    QDir().mkpath(dbPath + "sync");
+
+    for (const QString& repo : repos) {
+        Transfer transfer;
+        transfer.repo = repo;
+        transfer.target = SyncDatabase::databaseFile(dbPath, repo);
+        transfer.servers = servers.value(repo);
+        seedFromSystem(SyncDatabase::databaseFile(systemDbPath, repo), transfer.target);
+        m_transfers.insert(repo, transfer);
+    }
+
+    if (m_transfers.isEmpty()) {
+        emit finished(false, 0);
+        return;
+    }
+    for (const QString& repo : repos) requestNext(repo);
+}
+
+void SyncDatabaseFetcher::cancel()
+{
+    m_cancelled = true;
+    const auto transfers = m_transfers;
+    for (const Transfer& transfer : transfers) {
+        if (transfer.reply) transfer.reply->abort();
+    }
+}
+
+// pacman stamps each database with the server's Last-Modified, so after a pacman -Sy the
+// system copy is a valid starting point and saves downloading what pacman already has
+void SyncDatabaseFetcher::seedFromSystem(const QString& systemFile, const QString& target)
+{
+    QFileInfo system(systemFile);
+    QFileInfo current(target);
+    if (!system.exists() || (current.exists() && current.lastModified() >= system.lastModified())) return;
+
+    QString partial = target + ".part";
+    QFile::remove(partial);
+    if (!QFile::copy(systemFile, partial)) return;
+
+    QFile copy(partial);
+    if (copy.open(QIODevice::ReadWrite)) {
+        copy.setFileTime(system.lastModified(), QFileDevice::FileModificationTime);
+        copy.close();
+    }
+    QFile::remove(target);
+    QFile::rename(partial, target);
+    // The ETag belonged to whatever copy was there before
+    QFile::remove(etagFile(target));
+}
+
+void SyncDatabaseFetcher::requestNext(const QString& repo)
+{
+    Transfer& transfer = m_transfers[repo];
+    transfer.file.reset();
+    transfer.reply = nullptr;
+
+    if (m_cancelled || ++transfer.serverIndex >= transfer.servers.size()) {
+        // A repo without any mirror (e.g. a local file repo pacman manages itself) is only as current as its seed
+        finishTransfer(repo, !m_cancelled && transfer.servers.isEmpty() && QFile::exists(transfer.target));
+        return;
+    }
+
+    QString base = transfer.servers[transfer.serverIndex];
+    while (base.endsWith('/')) base.chop(1);
+    QNetworkRequest request(QUrl(base + "/" + repo + ".db"));
+    request.setTransferTimeout(StallTimeoutMs);
+    // Databases are already compressed; a server adding Content-Encoding must not get them unpacked
+    request.setRawHeader("Accept-Encoding", "identity");
+
+    QFileInfo current(transfer.target);
+    if (current.exists()) {
+        request.setHeader(QNetworkRequest::IfModifiedSinceHeader, current.lastModified().toUTC());
+        QFile etag(etagFile(transfer.target));
+        if (etag.open(QIODevice::ReadOnly)) request.setRawHeader("If-None-Match", etag.readAll().trimmed());
+    }
+
+    QNetworkReply* reply = m_network->get(request);
+    transfer.reply = reply;
+    connect(reply, &QNetworkReply::readyRead, this, [this, repo](){ onReadyRead(repo); });
+    connect(reply, &QNetworkReply::finished, this, [this, repo](){ onFinished(repo); });
+}
+
+// File URLs carry no status; anything that arrived without an error counts as a full body there
+static int statusOf(QNetworkReply* reply)
+{
+    QVariant status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    return status.isValid() ? status.toInt() : 200;
+}
+
+void SyncDatabaseFetcher::onReadyRead(const QString& repo)
+{
+    Transfer& transfer = m_transfers[repo];
+    if (!transfer.reply || statusOf(transfer.reply) != 200) return;
+
+    if (!transfer.file) {
+        transfer.file = std::make_shared<QSaveFile>(transfer.target);
+        if (!transfer.file->open(QIODevice::WriteOnly)) {
+            transfer.reply->abort();
+            return;
+        }
+    }
+    transfer.file->write(transfer.reply->readAll());
+}
+
+void SyncDatabaseFetcher::onFinished(const QString& repo)
+{
+    Transfer& transfer = m_transfers[repo];
+    QNetworkReply* reply = transfer.reply;
+    if (!reply) return;
+    reply->deleteLater();
+
+    int status = statusOf(reply);
+    if (reply->error() == QNetworkReply::NoError && status == 304) {
+        finishTransfer(repo, true);
+        return;
+    }
+    if (reply->error() != QNetworkReply::NoError || status != 200) {
+        if (transfer.file) transfer.file->cancelWriting();
+        requestNext(repo);
+        return;
+    }
+
+    onReadyRead(repo);
+    if (!transfer.file || !transfer.file->commit()) {
+        requestNext(repo);
+        return;
+    }
+
+    // The next request's If-Modified-Since is the file's mtime, so it has to be the server's clock
+    QDateTime lastModified = reply->header(QNetworkRequest::LastModifiedHeader).toDateTime();
+    QFile written(transfer.target);
+    if (lastModified.isValid() && written.open(QIODevice::ReadWrite)) {
+        written.setFileTime(lastModified, QFileDevice::FileModificationTime);
+        written.close();
+    }
+
+    QByteArray etag = reply->rawHeader("ETag");
+    QFile etagOut(etagFile(transfer.target));
+    if (etag.isEmpty() || !etagOut.open(QIODevice::WriteOnly | QIODevice::Truncate)) QFile::remove(etagFile(transfer.target));
+    else etagOut.write(etag);
+
+    ++m_downloadedCount;
+    finishTransfer(repo, true);
+}
+
+void SyncDatabaseFetcher::finishTransfer(const QString& repo, bool ok)
+{
+    m_transfers.remove(repo);
+    if (!ok) ++m_failedCount;
+    if (m_transfers.isEmpty()) emit finished(m_failedCount == 0 && !m_cancelled, m_downloadedCount);
+}
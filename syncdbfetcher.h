@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QHash>
+#include <memory>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QSaveFile;
+
+// Keeps a private copy of the sync databases (<dbPath>sync/<repo>.db) current without root.
+// Every repo is fetched at once; each request is conditional on the copy's mtime and ETag,
+// so a repo that has not changed costs one round trip and no body.
+class SyncDatabaseFetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SyncDatabaseFetcher(QObject* parent = nullptr);
+
+    // servers maps each repo to its mirror URLs in preference order (as in pacman.conf, already
+    // substituted). Wherever systemDbPath holds a newer copy than dbPath, that copy is taken first.
+    void fetch(const QString& dbPath, const QString& systemDbPath, const QStringList& repos, const QMap<QString, QStringList>& servers);
+    void cancel();
+    bool isRunning() const { return !m_transfers.isEmpty(); }
+
+signals:
+    // success is false if any repo could not be refreshed from any of its mirrors
+    void finished(bool success, int downloadedCount);
+
+private:
+    // A mirror that stops sending for this long is given up in favour of the next one
+    static constexpr int StallTimeoutMs = 30 * 1000;
+
+    struct Transfer {
+        QString repo;
+        QString target;
+        QStringList servers;
+        int serverIndex = -1;
+        QNetworkReply* reply = nullptr;
+        std::shared_ptr<QSaveFile> file;
+    };
+
+    void seedFromSystem(const QString& systemFile, const QString& target);
+    void requestNext(const QString& repo);
+    void onReadyRead(const QString& repo);
+    void onFinished(const QString& repo);
+    void finishTransfer(const QString& repo, bool ok);
+
+    QNetworkAccessManager* m_network;
+    QHash<QString, Transfer> m_transfers;
+    bool m_cancelled = false;
+    int m_failedCount = 0;
+    int m_downloadedCount = 0;
+};
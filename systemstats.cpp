@@ -0,0 +1,89 @@
+#include "systemstats.h"
+#include "packagetable.h"
+#include <QFile>
+#include <algorithm>
+#include <numeric>
+
+PackageStats SystemStatistics::packageStats(const PackageTable& table, int largestCount)
+{
+    PackageStats stats;
+    const quint32 rows = table.rowCount();
+    stats.installedCount = int(rows);
+
+    // Straight passes over the flag and size columns
+    for (quint32 row = 0; row < rows; ++row) {
+        if (table.isExplicit(row)) ++stats.explicitCount;
+        else ++stats.dependencyCount;
+        if (table.isForeign(row)) ++stats.foreignCount;
+        stats.installedBytes += table.installedSize(row);
+        if (table.orphanKind(row) != OrphanKind::None) {
+            ++stats.orphanCount;
+            stats.orphanBytes += table.installedSize(row);
+        }
+    }
+
+    QList<quint32> order(rows);
+    std::iota(order.begin(), order.end(), 0);
+    const qsizetype top = std::min<qsizetype>(largestCount, order.size());
+    std::partial_sort(order.begin(), order.begin() + top, order.end(), [&table](quint32 a, quint32 b){
+        return table.installedSize(a) > table.installedSize(b);
+    });
+    for (qsizetype i = 0; i < top; ++i) stats.largest.append({ table.nameString(order[i]), table.installedSize(order[i]) });
+    return stats;
+}
+
+CacheStats SystemStatistics::cacheStats(const QList<CachedPackage>& cache)
+{
+    CacheStats stats;
+    for (const CachedPackage& pkg : cache) {
+        stats.files += pkg.hasSignature ? 2 : 1;
+        stats.bytes += pkg.size + (pkg.hasSignature ? pkg.signatureSize : 0);
+    }
+    return stats;
+}
+
+// "[2024-05-01T10:00:00+0200] [PACMAN] ..." and, from older pacman, "[2019-01-01 12:00] [PACMAN] ..."
+static QDateTime parseLogTime(const QByteArray& line)
+{
+    qsizetype end = line.indexOf(']');
+    if (!line.startsWith('[') || end == -1) return QDateTime();
+    QString stamp = QString::fromLatin1(line.mid(1, end - 1));
+
+    QDateTime time = QDateTime::fromString(stamp, Qt::ISODate);
+    if (!time.isValid()) time = QDateTime::fromString(stamp, "yyyy-MM-dd HH:mm");
+    return time;
+}
+
+QDateTime SystemStatistics::lastFullUpgrade(const QString& logFile)
+{
+    static const QByteArray marker = "[PACMAN] starting full system upgrade";
+    static const qint64 CHUNK_SIZE = 64 * 1024;
+
+    QFile file(logFile);
+    if (!file.open(QIODevice::ReadOnly)) return QDateTime();
+
+    // Chunks are read from the end towards the start; carry holds a line cut by a chunk boundary
+    QByteArray carry;
+    for (qint64 end = file.size(); end > 0; ) {
+        qint64 start = std::max<qint64>(0, end - CHUNK_SIZE);
+        if (!file.seek(start)) return QDateTime();
+        QByteArray chunk = file.read(end - start) + carry;
+        end = start;
+
+        qsizetype firstNewline = chunk.indexOf('\n');
+        if (start > 0) {
+            // The part before the first newline may continue in the previous chunk
+            if (firstNewline == -1) { carry = chunk; continue; }
+            carry = chunk.left(firstNewline);
+            chunk = chunk.mid(firstNewline + 1);
+        } else {
+            carry.clear();
+        }
+
+        qsizetype hit = chunk.lastIndexOf(marker);
+        if (hit == -1) continue;
+        qsizetype lineStart = chunk.lastIndexOf('\n', hit) + 1;
+        return parseLogTime(chunk.mid(lineStart, hit - lineStart));
+    }
+    return QDateTime();
+}
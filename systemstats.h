@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QDateTime>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include "cachescanner.h"
+
+class PackageTable;
+
+struct PackageStats {
+    int installedCount = 0;
+    int explicitCount = 0;
+    int dependencyCount = 0;
+    int foreignCount = 0;
+    qint64 installedBytes = 0;
+    int orphanCount = 0;            // every kind, optional-only included
+    qint64 orphanBytes = 0;
+    QList<QPair<QString, qint64>> largest;  // biggest installed packages, largest first
+};
+
+struct CacheStats {
+    int files = 0;                  // packages and signatures
+    qint64 bytes = 0;
+};
+
+// The dashboard's numbers. Each part comes from its own worker and is flagged once known,
+// so the panel can show what's ready while the rest is still being read.
+struct SystemStats {
+    bool packagesKnown = false;
+    PackageStats packages;
+    bool cacheKnown = false;
+    CacheStats cache;
+    bool upgradeKnown = false;
+    QDateTime lastFullUpgrade;      // invalid if the log records none
+};
+
+namespace SystemStatistics {
+    // Counts and sizes over the installed packages, keeping the largestCount biggest
+    PackageStats packageStats(const PackageTable& table, int largestCount);
+    CacheStats cacheStats(const QList<CachedPackage>& cache);
+
+    // Time of the last "starting full system upgrade" entry (pacman -Syu), read backwards
+    // from the end of the log so only its tail is touched; invalid if there is none
+    QDateTime lastFullUpgrade(const QString& logFile);
+}
@@ -60,6 +60,12 @@ void TerminalWindow::runCommand(const QString& command)
     m_terminal->sendText(command + "\n");
 }
 
+void TerminalWindow::sendInterrupt()
+{
+    if (!m_terminal) return;
+    m_terminal->sendText(QString(QChar(0x03)));
+}
+
 void TerminalWindow::setFocusToTerminal()
 {
     m_terminal->setFocus();
@@ -10,6 +10,8 @@ public:
     explicit TerminalWindow(QWidget *parent = nullptr);
 
     void runCommand(const QString& command);
+    // Ctrl+C: the tty turns it into SIGINT for whatever job is in the foreground
+    void sendInterrupt();
     void setFocusToTerminal();
     void setInputEnabled(bool enabled);
 
@@ -0,0 +1,89 @@
+#include "vercmp.h"
+#include <QtTest>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Versions shaped like what a sync database holds: epochs, dotted releases, git
+// snapshots, dates and the odd suffix, each with a pkgrel
+static QStringList sampleVersions(int count)
+{
+    QRandomGenerator random(42);
+    QStringList versions;
+    versions.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        QString version;
+        switch (random.bounded(5)) {
+        case 0:
+            version = QString("%1.%2.%3").arg(random.bounded(10)).arg(random.bounded(40)).arg(random.bounded(200));
+            break;
+        case 1:
+            version = QString("%1:%2.%3").arg(random.bounded(1, 4)).arg(random.bounded(10)).arg(random.bounded(20));
+            break;
+        case 2:
+            version = QString("r%1.g%2").arg(random.bounded(5000)).arg(random.bounded(0x1000000), 7, 16, QChar('0'));
+            break;
+        case 3:
+            version = QString("2024%1%2").arg(random.bounded(1, 13), 2, 10, QChar('0')).arg(random.bounded(1, 29), 2, 10, QChar('0'));
+            break;
+        default:
+            version = QString("%1.%2%3").arg(random.bounded(5)).arg(random.bounded(20)).arg(QString(random.bounded(2) ? "rc1" : ".arch1"));
+            break;
+        }
+        versions << QString("%1-%2").arg(version).arg(random.bounded(1, 4));
+    }
+    return versions;
+}
+
+class BenchVercmp : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void compareUtf8();
+    void compareQString();
+    void sortQString();
+
+private:
+    QStringList m_versions;
+    std::vector<std::string> m_utf8;
+};
+
+void BenchVercmp::initTestCase()
+{
+    m_versions = sampleVersions(20000);
+    for (const QString& version : m_versions) m_utf8.push_back(version.toStdString());
+}
+
+void BenchVercmp::compareUtf8()
+{
+    int newer = 0;
+    QBENCHMARK {
+        for (size_t i = 1; i < m_utf8.size(); ++i) newer += vercmp(m_utf8[i - 1], m_utf8[i]) > 0;
+    }
+    QVERIFY(newer > 0);
+}
+
+void BenchVercmp::compareQString()
+{
+    int newer = 0;
+    QBENCHMARK {
+        for (qsizetype i = 1; i < m_versions.size(); ++i) newer += vercmp(m_versions[i - 1], m_versions[i]) > 0;
+    }
+    QVERIFY(newer > 0);
+}
+
+void BenchVercmp::sortQString()
+{
+    QStringList sorted;
+    QBENCHMARK {
+        sorted = m_versions;
+        std::sort(sorted.begin(), sorted.end(), [](const QString& a, const QString& b){ return vercmp(a, b) < 0; });
+    }
+    for (qsizetype i = 1; i < sorted.size(); ++i) QVERIFY(vercmp(sorted[i - 1], sorted[i]) <= 0);
+}
+
+QTEST_APPLESS_MAIN(BenchVercmp)
+#include "bench_vercmp.moc"
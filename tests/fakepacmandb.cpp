@@ -0,0 +1,85 @@
+#include "fakepacmandb.h"
+#include <QDir>
+#include <QFile>
+#include <archive.h>
+#include <archive_entry.h>
+#include <memory>
+
+static QByteArray descOf(const FakePacmanDb::Package& pkg, bool local)
+{
+    QByteArray out;
+    auto field = [&out](const char* key, const QStringList& values) {
+        if (values.isEmpty()) return;
+        out += QByteArray("%") + key + "%\n";
+        for (const QString& value : values) out += value.toUtf8() + '\n';
+        out += '\n';
+    };
+
+    field("NAME", {pkg.name});
+    field("VERSION", {pkg.version});
+    if (local) {
+        field("INSTALLDATE", {QString::number(pkg.installDate)});
+        field("SIZE", {QString::number(pkg.installedSize)});
+        field("REASON", {pkg.explicitlyInstalled ? "0" : "1"});
+    } else {
+        field("ISIZE", {QString::number(pkg.installedSize)});
+    }
+    field("GROUPS", pkg.groups);
+    field("DEPENDS", pkg.depends);
+    field("OPTDEPENDS", pkg.optDepends);
+    field("PROVIDES", pkg.provides);
+    return out;
+}
+
+static QByteArray filesOf(const FakePacmanDb::Package& pkg)
+{
+    QByteArray out = "%FILES%\n";
+    for (const QString& file : pkg.files) out += file.toUtf8() + '\n';
+    return out + '\n';
+}
+
+static bool writeFile(const QString& path, const QByteArray& data)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+bool FakePacmanDb::addLocal(const Package& pkg)
+{
+    QString entry = dbPath() + "local/" + pkg.name + "-" + pkg.version;
+    return QDir().mkpath(entry) && writeFile(entry + "/desc", descOf(pkg, true)) && writeFile(entry + "/files", filesOf(pkg));
+}
+
+bool FakePacmanDb::addSync(const QString& repo, const QList<Package>& packages)
+{
+    if (!QDir().mkpath(dbPath() + "sync")) return false;
+
+    // Plain tar; the readers take whatever compression libarchive can undo, none included
+    auto write = [&packages](const QString& path, bool withFiles) {
+        std::unique_ptr<struct archive, decltype(&archive_write_free)> archive(archive_write_new(), archive_write_free);
+        archive_write_set_format_pax_restricted(archive.get());
+        archive_write_add_filter_none(archive.get());
+        if (archive_write_open_filename(archive.get(), QFile::encodeName(path).constData()) != ARCHIVE_OK) return false;
+
+        auto add = [&archive](const QByteArray& name, const QByteArray& data) {
+            struct archive_entry* entry = archive_entry_new();
+            archive_entry_set_pathname(entry, name.constData());
+            archive_entry_set_size(entry, data.size());
+            archive_entry_set_filetype(entry, AE_IFREG);
+            archive_entry_set_perm(entry, 0644);
+            bool ok = archive_write_header(archive.get(), entry) == ARCHIVE_OK
+                   && archive_write_data(archive.get(), data.constData(), data.size()) == data.size();
+            archive_entry_free(entry);
+            return ok;
+        };
+
+        for (const Package& pkg : packages) {
+            QByteArray directory = (pkg.name + "-" + pkg.version).toUtf8();
+            if (!add(directory + "/desc", descOf(pkg, false))) return false;
+            if (withFiles && !add(directory + "/files", filesOf(pkg))) return false;
+        }
+        return archive_write_close(archive.get()) == ARCHIVE_OK;
+    };
+
+    return write(dbPath() + "sync/" + repo + ".db", false) && write(dbPath() + "sync/" + repo + ".files", true);
+}
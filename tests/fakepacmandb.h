@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QTemporaryDir>
+
+// A throwaway pacman DBPath: local/<name>-<version>/{desc,files} as pacman writes them, and
+// sync/<repo>.db and <repo>.files archives laid out the way repo-add makes them
+class FakePacmanDb
+{
+public:
+    struct Package {
+        QString name;
+        QString version = "1.0-1";
+        bool explicitlyInstalled = true;
+        qint64 installedSize = 0;
+        qint64 installDate = 0;
+        QStringList depends;
+        QStringList optDepends;
+        QStringList provides;
+        QStringList groups;
+        // Relative, as pacman lists them; directories end with '/'
+        QStringList files;
+    };
+
+    bool isValid() const { return m_dir.isValid(); }
+    // Ends with '/', like pacman's DBPath
+    QString dbPath() const { return m_dir.path() + "/"; }
+    QString filePath(const QString& name) const { return m_dir.filePath(name); }
+
+    bool addLocal(const Package& pkg);
+    // Writes both <repo>.db and <repo>.files
+    bool addSync(const QString& repo, const QList<Package>& packages);
+
+private:
+    QTemporaryDir m_dir;
+};
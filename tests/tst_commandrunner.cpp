@@ -0,0 +1,108 @@
+#include "commandrunner.h"
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QElapsedTimer>
+#include <sys/types.h>
+
+// Alive and not merely waiting to be reaped
+static bool isRunning(pid_t pid)
+{
+    QFile stat(QString("/proc/%1/stat").arg(pid));
+    if (!stat.open(QIODevice::ReadOnly)) return false;
+    QByteArray line = stat.readAll();
+    qsizetype end = line.lastIndexOf(')');
+    return end >= 0 && end + 2 < line.size() && line.at(end + 2) != 'Z';
+}
+
+class TestCommandRunner : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void headlessQueryReportsOutput();
+    void cancelReachesCommandIgnoringSigint();
+    void deadlineStopsHeadlessJob();
+};
+
+void TestCommandRunner::headlessQueryReportsOutput()
+{
+    CommandRunner runner(nullptr);
+    QString output;
+    int exitCode = -1;
+
+    CommandJob job;
+    job.headless = true;
+    job.captureOutput = true;
+    job.program = "sh";
+    job.arguments = QStringList{"-c", "echo one; echo two; exit 3"};
+    job.callback = [&](QString captured, int code){ output = captured; exitCode = code; };
+    runner.enqueue(job);
+
+    QTRY_COMPARE(exitCode, 3);
+    QCOMPARE(output, QString("one\ntwo\n"));
+    QCOMPARE(runner.activeQueryCount(), 0);
+}
+
+void TestCommandRunner::cancelReachesCommandIgnoringSigint()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString pidFile = dir.filePath("pids");
+
+    CommandRunner runner(nullptr);
+    int exitCode = -1;
+
+    // The shell and its sleep both shrug off SIGINT, so only the later stages can stop them
+    CommandJob job;
+    job.headless = true;
+    job.program = "sh";
+    job.arguments = QStringList{"-c", QString("trap '' INT; sleep 60 & echo $$ $! > '%1.tmp'; mv '%1.tmp' '%1'; wait $!").arg(pidFile)};
+    job.callback = [&](QString, int code){ exitCode = code; };
+    quint64 id = runner.enqueue(job);
+
+    QTRY_VERIFY(QFile::exists(pidFile));
+    QFile file(pidFile);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QList<QByteArray> pids = file.readAll().simplified().split(' ');
+    QCOMPARE(pids.size(), 2);
+    pid_t shell = pids.at(0).toInt();
+    pid_t sleeper = pids.at(1).toInt();
+    QVERIFY(isRunning(shell));
+    QVERIFY(isRunning(sleeper));
+
+    runner.cancel(id);
+
+    // SIGINT changes nothing; the query must still be running rather than reported over
+    QTest::qWait(1000);
+    QCOMPARE(exitCode, -1);
+    QVERIFY(isRunning(shell));
+
+    QTRY_COMPARE_WITH_TIMEOUT(exitCode, CommandRunner::CancelledExitCode, 10000);
+    QTRY_VERIFY_WITH_TIMEOUT(!isRunning(shell), 5000);
+    QTRY_VERIFY_WITH_TIMEOUT(!isRunning(sleeper), 5000);
+}
+
+void TestCommandRunner::deadlineStopsHeadlessJob()
+{
+    CommandRunner runner(nullptr);
+    int exitCode = -1;
+    QElapsedTimer elapsed;
+
+    CommandJob job;
+    job.headless = true;
+    job.program = "sleep";
+    job.arguments = QStringList{"60"};
+    job.timeoutMs = 500;
+    job.callback = [&](QString, int code){ exitCode = code; };
+    elapsed.start();
+    runner.enqueue(job);
+
+    // sleep goes on the first SIGINT, so this is the deadline and not the escalation after it
+    QTRY_COMPARE_WITH_TIMEOUT(exitCode, CommandRunner::TimedOutExitCode, 10000);
+    QVERIFY(elapsed.elapsed() >= 500);
+    QCOMPARE(runner.activeQueryCount(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestCommandRunner)
+#include "tst_commandrunner.moc"
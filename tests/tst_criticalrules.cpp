@@ -0,0 +1,178 @@
+#include "criticalrules.h"
+#include "dependencygraph.h"
+#include "localdatabase.h"
+#include "fakepacmandb.h"
+#include <QtTest>
+
+class TestCriticalRules : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void compile_data();
+    void compile();
+    void lookups();
+    void toggled_data();
+    void toggled();
+
+private:
+    // Sorted names of every package the rules make critical
+    QStringList critical(const QStringList& rules) const;
+
+    FakePacmanDb m_db;
+    std::shared_ptr<LocalDatabase> m_local;
+    std::shared_ptr<const DependencyGraph> m_graph;
+};
+
+void TestCriticalRules::initTestCase()
+{
+    QVERIFY(m_db.isValid());
+
+    auto package = [](const char* name, const QStringList& depends = {}) {
+        FakePacmanDb::Package pkg;
+        pkg.name = name;
+        pkg.depends = depends;
+        return pkg;
+    };
+    auto systemd = package("systemd", {"systemd-libs", "libcap>=2.69", "dbus"});
+    systemd.optDepends = {"cryptsetup: encrypted swap"};
+    auto libcap = package("libcap");
+    libcap.version = "2.69-1";
+    // dbus needs dbus-units, which only dbus-broker-units provides
+    auto units = package("dbus-broker-units");
+    units.provides = {"dbus-units"};
+    auto gcc = package("gcc", {"gcc-libs"});
+    gcc.groups = {"base-devel"};
+    auto make = package("make");
+    make.groups = {"base-devel"};
+
+    const QList<FakePacmanDb::Package> core = {
+        systemd, package("systemd-libs", {"libcap"}), libcap, package("dbus", {"dbus-units"}), units,
+        package("cryptsetup"), package("linux", {"kmod"}), package("linux-lts", {"kmod"}), package("kmod"),
+        gcc, package("gcc-libs"), make,
+    };
+    const QList<FakePacmanDb::Package> extra = { package("git"), package("vim") };
+    for (const FakePacmanDb::Package& pkg : core + extra) QVERIFY(m_db.addLocal(pkg));
+    QVERIFY(m_db.addLocal(package("yay", {"git"})));
+    QVERIFY(m_db.addSync("core", core));
+    QVERIFY(m_db.addSync("extra", extra));
+
+    m_local = LocalDatabase::load(m_db.dbPath(), {"core", "extra"});
+    QCOMPARE(m_local->packages().size(), core.size() + extra.size() + 1);
+    m_graph = DependencyGraph::build(*m_local);
+}
+
+QStringList TestCriticalRules::critical(const QStringList& rules) const
+{
+    auto set = CriticalSet::compile(rules, *m_local, m_graph);
+    QStringList names;
+    for (int node = 0; node < m_graph->nodeCount(); ++node) {
+        if (set->containsNode(node)) names << m_graph->name(node);
+    }
+    names.sort();
+    return names;
+}
+
+void TestCriticalRules::compile_data()
+{
+    QTest::addColumn<QStringList>("rules");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("none") << QStringList{} << QStringList{};
+    QTest::newRow("exact name") << QStringList{"vim"} << QStringList{"vim"};
+    QTest::newRow("exact name is not a prefix") << QStringList{"linux"} << QStringList{"linux"};
+    QTest::newRow("unknown name") << QStringList{"nosuch", "vim"} << QStringList{"vim"};
+
+    QTest::newRow("star") << QStringList{"linux*"} << QStringList{"linux", "linux-lts"};
+    QTest::newRow("question mark") << QStringList{"linux-???"} << QStringList{"linux-lts"};
+    QTest::newRow("character class") << QStringList{"[gv]i*"} << QStringList{"git", "vim"};
+    QTest::newRow("glob matches whole names") << QStringList{"*libs"} << QStringList{"gcc-libs", "systemd-libs"};
+
+    QTest::newRow("group") << QStringList{"group:base-devel"} << QStringList{"gcc", "make"};
+    QTest::newRow("unknown group") << QStringList{"group:base"} << QStringList{};
+    QTest::newRow("repo") << QStringList{"repo:extra"} << QStringList{"git", "vim"};
+    QTest::newRow("repo foreign") << QStringList{"repo:foreign"} << QStringList{"yay"};
+    QTest::newRow("repo aur") << QStringList{"repo:aur"} << QStringList{"yay"};
+    QTest::newRow("repo local") << QStringList{"repo:local"} << QStringList{"yay"};
+
+    // Through a versioned dependency and a provide, but not the optional cryptsetup
+    QTest::newRow("deps") << QStringList{"deps:systemd"}
+                          << QStringList{"dbus", "dbus-broker-units", "libcap", "systemd", "systemd-libs"};
+    QTest::newRow("deps of a foreign package") << QStringList{"deps:yay"} << QStringList{"git", "yay"};
+    QTest::newRow("deps shared") << QStringList{"deps:linux", "deps:linux-lts"} << QStringList{"kmod", "linux", "linux-lts"};
+    QTest::newRow("deps of unknown") << QStringList{"deps:nosuch"} << QStringList{};
+
+    // Exclusions win wherever they are and whatever included the package
+    QTest::newRow("exclude from deps") << QStringList{"deps:systemd", "!libcap"}
+                                       << QStringList{"dbus", "dbus-broker-units", "systemd", "systemd-libs"};
+    QTest::newRow("exclude before include") << QStringList{"!vim", "vim"} << QStringList{};
+    QTest::newRow("exclude glob") << QStringList{"repo:core", "!*libs", "!linux-*", "!group:base-devel"}
+                                  << QStringList{"cryptsetup", "dbus", "dbus-broker-units", "kmod", "libcap", "linux", "systemd"};
+    QTest::newRow("exclude deps") << QStringList{"repo:extra", "!deps:yay"} << QStringList{"vim"};
+
+    QTest::newRow("comments and blanks") << QStringList{"# vim", "", "   ", "  git  ", "#!git", "!  yay", "yay"}
+                                         << QStringList{"git"};
+}
+
+void TestCriticalRules::compile()
+{
+    QFETCH(QStringList, rules);
+    QFETCH(QStringList, expected);
+
+    QCOMPARE(critical(rules), expected);
+}
+
+void TestCriticalRules::lookups()
+{
+    auto set = CriticalSet::compile({"deps:systemd", "vim"}, *m_local, m_graph);
+    QCOMPARE(set->count(), 6);
+    QVERIFY(set->contains("libcap"));
+    QVERIFY(!set->contains("cryptsetup"));
+    QVERIFY(!set->contains("nosuch"));
+    QVERIFY(set->containsNode(m_graph->indexOf("systemd")));
+
+    // Names that aren't installed add no bit
+    QBitArray mask = set->maskOf({"dbus", "git", "vim", "nosuch"});
+    QCOMPARE(mask.count(true), qsizetype(3));
+    QCOMPARE(set->countIn(mask), 2);
+    QCOMPARE(set->countIn(set->maskOf({})), 0);
+}
+
+void TestCriticalRules::toggled_data()
+{
+    QTest::addColumn<QStringList>("rules");
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<bool>("on");
+    QTest::addColumn<QStringList>("expected");
+
+    const QStringList rules = {"linux*", "vim"};
+    QTest::newRow("add a name") << rules << "git" << true << QStringList{"linux*", "vim", "git"};
+    QTest::newRow("add a name twice") << rules << "vim" << true << rules;
+    QTest::newRow("drop a name") << rules << "vim" << false << QStringList{"linux*"};
+    QTest::newRow("drop what isn't there") << rules << "git" << false << rules;
+    QTest::newRow("exclude from a pattern") << rules << "linux-lts" << false << QStringList{"linux*", "vim", "!linux-lts"};
+    QTest::newRow("exclude only once") << QStringList{"linux*", "!linux-lts"} << "linux-lts" << false
+                                       << QStringList{"linux*", "!linux-lts"};
+    QTest::newRow("lift an exclusion") << QStringList{"linux*", "!linux-lts"} << "linux-lts" << true << QStringList{"linux*"};
+    QTest::newRow("name also caught by a pattern") << QStringList{"linux*", "linux"} << "linux" << false
+                                                   << QStringList{"linux*", "!linux"};
+    QTest::newRow("excluded name") << QStringList{"!vim", "vim"} << "vim" << true << QStringList{"vim"};
+    QTest::newRow("through deps") << QStringList{"deps:yay"} << "git" << false << QStringList{"deps:yay", "!git"};
+}
+
+void TestCriticalRules::toggled()
+{
+    QFETCH(QStringList, rules);
+    QFETCH(QString, name);
+    QFETCH(bool, on);
+    QFETCH(QStringList, expected);
+
+    QStringList result = CriticalSet::compile(rules, *m_local, m_graph)->toggled(rules, name, on);
+    QCOMPARE(result, expected);
+    // The new rules say what was asked of them
+    QCOMPARE(CriticalSet::compile(result, *m_local, m_graph)->contains(name), on);
+}
+
+QTEST_GUILESS_MAIN(TestCriticalRules)
+#include "tst_criticalrules.moc"
@@ -0,0 +1,149 @@
+#include "fileindex.h"
+#include "fakepacmandb.h"
+#include <QtTest>
+
+class TestFileIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void search_data();
+    void search();
+    void limit();
+    void emptyQuery();
+    void updatePicksUpNewPackages();
+
+private:
+    // "<path> <package> <repo or -> <path|basename|substring>" per owner, in result order
+    static QStringList describe(const QList<FileOwner>& owners);
+
+    FakePacmanDb m_db;
+    std::shared_ptr<const FileIndex> m_index;
+};
+
+static FakePacmanDb::Package package(const char* name, const QStringList& files)
+{
+    FakePacmanDb::Package pkg;
+    pkg.name = name;
+    pkg.files = files;
+    return pkg;
+}
+
+void TestFileIndex::initTestCase()
+{
+    QVERIFY(m_db.isValid());
+
+    const auto coreutils = package("coreutils", {"usr/", "usr/bin/", "usr/bin/dir", "usr/bin/ls", "usr/share/", "usr/share/doc/",
+                                                 "usr/share/doc/coreutils/", "usr/share/doc/coreutils/README"});
+    QVERIFY(m_db.addLocal(coreutils));
+    QVERIFY(m_db.addLocal(package("bash", {"usr/", "usr/bin/", "usr/bin/bash", "usr/share/", "usr/share/bash-completion/",
+                                           "usr/share/bash-completion/completions/", "usr/share/bash-completion/completions/ls"})));
+    QVERIFY(m_db.addLocal(package("lsof", {"usr/", "usr/bin/", "usr/bin/lsof", "usr/share/man/man8/lsof.8.gz"})));
+
+    // Enough paths for several front-coded blocks, so lookups have to pick the right one
+    QStringList many{"usr/", "usr/share/", "usr/share/many/"};
+    for (int i = 0; i < 100; ++i) many << QString("usr/share/many/file%1").arg(i, 3, 10, QChar('0'));
+    QVERIFY(m_db.addLocal(package("many", many)));
+
+    // The repo's copy of installed coreutils repeats its paths; busybox is only in the repo
+    QVERIFY(m_db.addSync("core", {coreutils, package("busybox", {"usr/", "usr/bin/", "usr/bin/busybox", "usr/lib/",
+                                                                 "usr/lib/busybox/", "usr/lib/busybox/ls"})}));
+
+    m_index = FileIndex::update(m_db.filePath("files.idx"), m_db.dbPath(), {"core"});
+    QVERIFY(m_index);
+    QVERIFY(m_index->entryCount() > 100);
+}
+
+QStringList TestFileIndex::describe(const QList<FileOwner>& owners)
+{
+    static const char* const matches[] = { "path", "basename", "substring" };
+    QStringList result;
+    for (const FileOwner& owner : owners) {
+        result << QString("%1 %2 %3 %4").arg(owner.path, owner.package, owner.isInstalled() ? "-" : owner.repo,
+                                             matches[int(owner.match)]);
+    }
+    return result;
+}
+
+void TestFileIndex::search_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QStringList>("expected");
+
+    // Exact paths answer like pacman -Qo, and the repo copy of an installed owner is dropped
+    QTest::newRow("path") << "/usr/bin/ls" << QStringList{"/usr/bin/ls coreutils - path"};
+    QTest::newRow("repo-only path") << "/usr/bin/busybox" << QStringList{"/usr/bin/busybox busybox core path"};
+    QTest::newRow("path in a later block") << "/usr/share/many/file073" << QStringList{"/usr/share/many/file073 many - path"};
+    QTest::newRow("missing path") << "/usr/bin/nothing" << QStringList{};
+    QTest::newRow("path is never a substring") << "/usr/bin/l" << QStringList{};
+    QTest::newRow("directory") << "/usr/bin/" << QStringList{
+        "/usr/bin/ bash - path", "/usr/bin/ coreutils - path", "/usr/bin/ lsof - path", "/usr/bin/ busybox core path"};
+    QTest::newRow("directory without slash") << "/usr/bin" << QStringList{
+        "/usr/bin/ bash - path", "/usr/bin/ coreutils - path", "/usr/bin/ lsof - path", "/usr/bin/ busybox core path"};
+
+    // A bare name finds files of that name first, then any path containing it
+    QTest::newRow("basename then substring") << "ls" << QStringList{
+        "/usr/bin/ls coreutils - basename",
+        "/usr/lib/busybox/ls busybox core basename",
+        "/usr/share/bash-completion/completions/ls bash - basename",
+        "/usr/bin/lsof lsof - substring",
+        "/usr/share/man/man8/lsof.8.gz lsof - substring"};
+    QTest::newRow("basename only") << "README" << QStringList{"/usr/share/doc/coreutils/README coreutils - basename"};
+    QTest::newRow("basename in a later block") << "file099" << QStringList{"/usr/share/many/file099 many - basename"};
+    // Directories are found by substring only
+    QTest::newRow("directory name") << "busybox" << QStringList{
+        "/usr/bin/busybox busybox core basename",
+        "/usr/lib/busybox/ busybox core substring",
+        "/usr/lib/busybox/ls busybox core substring"};
+    QTest::newRow("substring only") << "oreutil" << QStringList{
+        "/usr/share/doc/coreutils/ coreutils - substring",
+        "/usr/share/doc/coreutils/README coreutils - substring"};
+    // With a '/' in it a query is a path fragment, not a name
+    QTest::newRow("fragment") << "bin/ls" << QStringList{"/usr/bin/ls coreutils - substring", "/usr/bin/lsof lsof - substring"};
+    QTest::newRow("surrounding space") << "  README " << QStringList{"/usr/share/doc/coreutils/README coreutils - basename"};
+    QTest::newRow("no match") << "nothing" << QStringList{};
+}
+
+void TestFileIndex::search()
+{
+    QFETCH(QString, query);
+    QFETCH(QStringList, expected);
+
+    QCOMPARE(describe(m_index->search(query, 50)), expected);
+}
+
+void TestFileIndex::limit()
+{
+    // Basename matches fill the limit before any substring match gets in, and the dropped
+    // repo copy of coreutils' ls doesn't count against it
+    QCOMPARE(describe(m_index->search("ls", 2)),
+             (QStringList{"/usr/bin/ls coreutils - basename", "/usr/lib/busybox/ls busybox core basename"}));
+    QCOMPARE(m_index->search("file", 10).size(), qsizetype(10));
+    QVERIFY(m_index->search("ls", 0).isEmpty());
+}
+
+void TestFileIndex::emptyQuery()
+{
+    QVERIFY(m_index->search("", 50).isEmpty());
+    QVERIFY(m_index->search("   ", 50).isEmpty());
+}
+
+void TestFileIndex::updatePicksUpNewPackages()
+{
+    QVERIFY(m_db.addLocal(package("which", {"usr/", "usr/bin/", "usr/bin/which"})));
+
+    // Everything else comes out of the old index rather than being read again
+    std::shared_ptr<const FileIndex> updated = FileIndex::update(m_db.filePath("files.idx"), m_db.dbPath(), {"core"});
+    QVERIFY(updated);
+    QCOMPARE(updated->entryCount(), m_index->entryCount() + 3);
+    QCOMPARE(describe(updated->search("/usr/bin/which", 50)), QStringList{"/usr/bin/which which - path"});
+    QCOMPARE(describe(updated->search("/usr/bin/ls", 50)), QStringList{"/usr/bin/ls coreutils - path"});
+    QCOMPARE(describe(updated->search("/usr/bin/busybox", 50)), QStringList{"/usr/bin/busybox busybox core path"});
+
+    // The old mapping still answers after the new file replaced it
+    QCOMPARE(describe(m_index->search("/usr/bin/ls", 50)), QStringList{"/usr/bin/ls coreutils - path"});
+}
+
+QTEST_GUILESS_MAIN(TestFileIndex)
+#include "tst_fileindex.moc"
@@ -0,0 +1,247 @@
+#include "packagequery.h"
+#include "packagetable.h"
+#include "localdatabase.h"
+#include "fakepacmandb.h"
+#include <QtTest>
+#include <QDateTime>
+#include <numeric>
+
+Q_DECLARE_METATYPE(PackageQuery::SortKey)
+
+static qint64 localTime(int year, int month, int day, int hour = 0, int minute = 0, int second = 0)
+{
+    return QDateTime(QDate(year, month, day), QTime(hour, minute, second)).toSecsSinceEpoch();
+}
+
+class TestPackageQuery : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void emptyQuery();
+    void filter_data();
+    void filter();
+    void errors_data();
+    void errors();
+    void sort_data();
+    void sort();
+    void runOnSubset();
+    void runCancelled();
+
+private:
+    QStringList names(const QList<quint32>& rows) const;
+    QList<quint32> allRows() const;
+
+    FakePacmanDb m_db;
+    std::shared_ptr<LocalDatabase> m_local;
+    std::shared_ptr<PackageTable> m_table;
+};
+
+// Sizes and install dates sit on either side of the boundaries the queries below test
+void TestPackageQuery::initTestCase()
+{
+    QVERIFY(m_db.isValid());
+
+    auto package = [](const char* name, const char* version, bool explicitly, qint64 size, qint64 date) {
+        FakePacmanDb::Package pkg;
+        pkg.name = name;
+        pkg.version = version;
+        pkg.explicitlyInstalled = explicitly;
+        pkg.installedSize = size;
+        pkg.installDate = date;
+        return pkg;
+    };
+    const QList<FakePacmanDb::Package> packages = {
+        package("acl", "2.3.1-1", false, 300 * 1024, localTime(2023, 12, 31, 23, 59, 59)),
+        package("bash", "5.2.21-1", true, 1024 * 1024, localTime(2024, 1, 1)),
+        package("firefox", "121.0-1", true, 240 * 1024 * 1024, localTime(2024, 1, 1, 23, 59, 59)),
+        package("python-bar", "1.9-1", true, 2048, localTime(2024, 3, 1)),
+        package("python-foo", "1.10-1", true, 4096, localTime(2024, 3, 1)),
+        package("yay", "12.1.0-1", true, 1024 * 1024 + 1, localTime(2024, 1, 2)),
+        package("zlib", "1:1.3-2", false, 1024 * 1024 - 1, localTime(2023, 6, 1, 12)),
+    };
+    for (const FakePacmanDb::Package& pkg : packages) QVERIFY(m_db.addLocal(pkg));
+    QVERIFY(m_db.addSync("core", {packages[0], packages[1], packages[6]}));
+    QVERIFY(m_db.addSync("extra", {packages[2]}));
+
+    m_local = LocalDatabase::load(m_db.dbPath(), {"core", "extra"});
+    QCOMPARE(m_local->packages().size(), packages.size());
+    m_table = PackageTable::fromLocal(*m_local);
+}
+
+void TestPackageQuery::emptyQuery()
+{
+    QVERIFY(PackageQuery::parse("").isEmpty());
+    QVERIFY(PackageQuery::parse(" \t ").isEmpty());
+    // A field with nothing after it adds no term
+    QVERIFY(PackageQuery::parse("name: repo:").isEmpty());
+    QVERIFY(!PackageQuery::parse("bash").isEmpty());
+}
+
+QStringList TestPackageQuery::names(const QList<quint32>& rows) const
+{
+    QStringList result;
+    for (quint32 row : rows) result << m_table->nameString(row);
+    return result;
+}
+
+QList<quint32> TestPackageQuery::allRows() const
+{
+    QList<quint32> rows(m_table->rowCount());
+    std::iota(rows.begin(), rows.end(), 0);
+    return rows;
+}
+
+void TestPackageQuery::filter_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QStringList>("expected");
+
+    const QStringList all = {"acl", "bash", "firefox", "python-bar", "python-foo", "yay", "zlib"};
+    QTest::newRow("empty") << "" << all;
+    QTest::newRow("field without value") << "name:" << all;
+
+    QTest::newRow("word ignores case") << "BA" << QStringList{"bash", "python-bar"};
+    QTest::newRow("lone dash is a word") << "-" << QStringList{"python-bar", "python-foo"};
+    QTest::newRow("negated word") << "-python" << QStringList{"acl", "bash", "firefox", "yay", "zlib"};
+    QTest::newRow("regex") << "/^py.*o$/" << QStringList{"python-foo"};
+    QTest::newRow("name regex") << "name:/^(acl|yay)$/" << QStringList{"acl", "yay"};
+    QTest::newRow("version") << "version:1.10" << QStringList{"python-foo"};
+    QTest::newRow("ver alias") << "ver:1.9" << QStringList{"python-bar"};
+    QTest::newRow("version regex") << "version:/^1:/" << QStringList{"zlib"};
+
+    QTest::newRow("repo") << "repo:core" << QStringList{"acl", "bash", "zlib"};
+    QTest::newRow("repo ignores case") << "repo:EXTRA" << QStringList{"firefox"};
+    QTest::newRow("repo foreign") << "repo:foreign" << QStringList{"python-bar", "python-foo", "yay"};
+    QTest::newRow("repo aur") << "repo:aur" << QStringList{"python-bar", "python-foo", "yay"};
+    QTest::newRow("not foreign") << "-repo:local" << QStringList{"acl", "bash", "firefox", "zlib"};
+
+    QTest::newRow("explicit") << "reason:explicit" << QStringList{"bash", "firefox", "python-bar", "python-foo", "yay"};
+    QTest::newRow("dependency") << "reason:dep" << QStringList{"acl", "zlib"};
+
+    // 1M is 1048576 bytes: bash is exactly that, zlib one byte less, yay one more
+    QTest::newRow("size at least") << "size:1M" << QStringList{"bash", "firefox", "yay"};
+    QTest::newRow("size >") << "size:>1M" << QStringList{"firefox", "yay"};
+    QTest::newRow("size >=") << "size:>=1MiB" << QStringList{"bash", "firefox", "yay"};
+    QTest::newRow("size <") << "size:<1M" << QStringList{"acl", "python-bar", "python-foo", "zlib"};
+    QTest::newRow("size <=") << "size:<=1mb" << QStringList{"acl", "bash", "python-bar", "python-foo", "zlib"};
+    QTest::newRow("size =") << "size:=1M" << QStringList{"bash"};
+    QTest::newRow("size in bytes") << "size:=1048575" << QStringList{"zlib"};
+    QTest::newRow("fractional size") << "size:<=0.5K" << QStringList{};
+    QTest::newRow("fractional size kib") << "size:=2kib" << QStringList{"python-bar"};
+
+    // Dates compare by whole local days: acl is the last second before 2024-01-01, firefox
+    // the last second of it, yay the first second after it
+    QTest::newRow("date <") << "installed:<2024-01-01" << QStringList{"acl", "zlib"};
+    QTest::newRow("date <=") << "installed:<=2024-01-01" << QStringList{"acl", "bash", "firefox", "zlib"};
+    QTest::newRow("date =") << "installed:=2024-01-01" << QStringList{"bash", "firefox"};
+    QTest::newRow("date >") << "installed:>2024-01-01" << QStringList{"python-bar", "python-foo", "yay"};
+    QTest::newRow("date at least") << "installed:2024-01-02" << QStringList{"python-bar", "python-foo", "yay"};
+    QTest::newRow("date alias") << "date:<2024-01-01" << QStringList{"acl", "zlib"};
+
+    QTest::newRow("all terms must match") << "repo:core size:>=1M" << QStringList{"bash"};
+    QTest::newRow("mixed negation") << "reason:explicit installed:<2024-03-01 -fire" << QStringList{"bash", "yay"};
+    QTest::newRow("nothing") << "repo:core repo:extra" << QStringList{};
+}
+
+void TestPackageQuery::filter()
+{
+    QFETCH(QString, query);
+    QFETCH(QStringList, expected);
+
+    PackageQuery parsed = PackageQuery::parse(query);
+    QVERIFY2(parsed.error().isEmpty(), qPrintable(parsed.error()));
+
+    const QList<quint32> rows = parsed.run(*m_table, allRows(), PackageQuery::SortKey::Name, Qt::AscendingOrder, nullptr);
+    QCOMPARE(names(rows), expected);
+
+    QStringList matched;
+    for (quint32 row : allRows()) {
+        if (parsed.matches(*m_table, row)) matched << m_table->nameString(row);
+    }
+    QCOMPARE(matched, expected);
+}
+
+void TestPackageQuery::errors_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QString>("prefix");
+
+    QTest::newRow("unknown field") << "color:red" << "Unknown field \"color\"";
+    QTest::newRow("bad pattern") << "/(/" << "Bad pattern";
+    QTest::newRow("bad field pattern") << "version:/[/" << "Bad pattern";
+    QTest::newRow("bad size") << "size:big" << "Bad size \"big\"";
+    QTest::newRow("size without number") << "size:>" << "Bad size";
+    QTest::newRow("bad date") << "installed:2024-13-01" << "Bad date \"2024-13-01\"";
+    QTest::newRow("bad reason") << "reason:maybe" << "Bad reason \"maybe\"";
+    QTest::newRow("error after good terms") << "bash size:1M colour:red" << "Unknown field";
+}
+
+void TestPackageQuery::errors()
+{
+    QFETCH(QString, query);
+    QFETCH(QString, prefix);
+
+    PackageQuery parsed = PackageQuery::parse(query);
+    QVERIFY2(parsed.error().startsWith(prefix), qPrintable(parsed.error()));
+}
+
+void TestPackageQuery::sort_data()
+{
+    QTest::addColumn<PackageQuery::SortKey>("key");
+    QTest::addColumn<Qt::SortOrder>("order");
+    QTest::addColumn<QStringList>("expected");
+
+    using Key = PackageQuery::SortKey;
+    QTest::newRow("name descending") << Key::Name << Qt::DescendingOrder
+        << QStringList{"zlib", "yay", "python-foo", "python-bar", "firefox", "bash", "acl"};
+    QTest::newRow("size") << Key::Size << Qt::AscendingOrder
+        << QStringList{"python-bar", "python-foo", "acl", "zlib", "bash", "yay", "firefox"};
+    // vercmp, not text: 1.9 < 1.10 and an epoch beats everything
+    QTest::newRow("version") << Key::Version << Qt::AscendingOrder
+        << QStringList{"python-bar", "python-foo", "acl", "bash", "yay", "firefox", "zlib"};
+    // Ties stay in name order both ways round; foreign packages have the empty repo
+    QTest::newRow("repository") << Key::Repository << Qt::AscendingOrder
+        << QStringList{"python-bar", "python-foo", "yay", "acl", "bash", "zlib", "firefox"};
+    QTest::newRow("repository descending") << Key::Repository << Qt::DescendingOrder
+        << QStringList{"firefox", "acl", "bash", "zlib", "python-bar", "python-foo", "yay"};
+    QTest::newRow("install date") << Key::InstallDate << Qt::AscendingOrder
+        << QStringList{"zlib", "acl", "bash", "firefox", "yay", "python-bar", "python-foo"};
+}
+
+void TestPackageQuery::sort()
+{
+    QFETCH(PackageQuery::SortKey, key);
+    QFETCH(Qt::SortOrder, order);
+    QFETCH(QStringList, expected);
+
+    QCOMPARE(names(PackageQuery::parse("").run(*m_table, allRows(), key, order, nullptr)), expected);
+}
+
+void TestPackageQuery::runOnSubset()
+{
+    // Only the given rows are considered, as when a view has already narrowed the table
+    QList<quint32> rows;
+    for (quint32 row : allRows()) {
+        if (m_table->isForeign(row)) rows << row;
+    }
+    PackageQuery query = PackageQuery::parse("size:<1M");
+    QCOMPARE(names(query.run(*m_table, rows, PackageQuery::SortKey::Size, Qt::DescendingOrder, nullptr)),
+             (QStringList{"python-foo", "python-bar"}));
+}
+
+void TestPackageQuery::runCancelled()
+{
+    PackageQuery query = PackageQuery::parse("");
+    QVERIFY(query.run(*m_table, allRows(), PackageQuery::SortKey::Name, Qt::AscendingOrder, [](){ return true; }).isEmpty());
+
+    // Asked again after sorting, so a late cancellation still drops the result
+    int calls = 0;
+    auto lateCancel = [&calls](){ return ++calls > 1; };
+    QVERIFY(query.run(*m_table, allRows(), PackageQuery::SortKey::Size, Qt::AscendingOrder, lateCancel).isEmpty());
+    QCOMPARE(calls, 2);
+}
+
+QTEST_GUILESS_MAIN(TestPackageQuery)
+#include "tst_packagequery.moc"
@@ -0,0 +1,270 @@
+#include "syncdbfetcher.h"
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QNetworkProxy>
+#include <QTemporaryDir>
+#include <QPointer>
+#include <QFile>
+#include <QDir>
+
+// Answers every request with the one canned response, over HTTP/1.1 with the connection
+// closed after each reply. holdAfter keeps the rest of the body back until release().
+class FakeHttpServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    FakeHttpServer()
+    {
+        connect(&m_server, &QTcpServer::newConnection, this, [this](){
+            while (QTcpSocket* socket = m_server.nextPendingConnection()) {
+                auto head = std::make_shared<QByteArray>();
+                connect(socket, &QTcpSocket::readyRead, socket, [this, socket, head](){
+                    head->append(socket->readAll());
+                    if (!head->contains("\r\n\r\n")) return;
+                    requests << head->left(head->indexOf("\r\n\r\n"));
+                    reply(socket);
+                });
+                connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            }
+        });
+    }
+
+    struct Response {
+        int status = 200;
+        QList<std::pair<QByteArray, QByteArray>> headers;
+        QByteArray body;
+        qsizetype holdAfter = -1;
+        // Announce the whole body but close the connection halfway through it
+        bool truncate = false;
+    };
+
+    Response response;
+    QList<QByteArray> requests;
+
+    bool listen() { return m_server.listen(QHostAddress::LocalHost); }
+    QString url() const { return QString("http://127.0.0.1:%1/core/os/x86_64").arg(m_server.serverPort()); }
+
+    QByteArray header(qsizetype request, const QByteArray& name) const
+    {
+        for (const QByteArray& line : requests.value(request).split('\n')) {
+            qsizetype colon = line.indexOf(':');
+            if (colon > 0 && line.left(colon).trimmed().compare(name, Qt::CaseInsensitive) == 0) return line.mid(colon + 1).trimmed();
+        }
+        return QByteArray();
+    }
+
+    void release()
+    {
+        if (!m_held) return;
+        m_held->write(m_rest);
+        m_held->disconnectFromHost();
+    }
+
+signals:
+    void held();
+
+private:
+    void reply(QTcpSocket* socket)
+    {
+        QByteArray out = "HTTP/1.1 " + QByteArray::number(response.status) + " Fake\r\nConnection: close\r\n";
+        for (const auto& [name, value] : response.headers) out += name + ": " + value + "\r\n";
+        if (response.status != 304) out += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+        out += "\r\n";
+
+        if (response.truncate) {
+            socket->write(out + response.body.left(response.body.size() / 2));
+            socket->disconnectFromHost();
+            return;
+        }
+        if (response.holdAfter >= 0) {
+            socket->write(out + response.body.left(response.holdAfter));
+            socket->flush();
+            m_held = socket;
+            m_rest = response.body.mid(response.holdAfter);
+            emit held();
+            return;
+        }
+        socket->write(out + response.body);
+        socket->disconnectFromHost();
+    }
+
+    QTcpServer m_server;
+    QPointer<QTcpSocket> m_held;
+    QByteArray m_rest;
+};
+
+class TestSyncDatabaseFetcher : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void firstFetchStoresValidators();
+    void notModifiedKeepsDatabase();
+    void okReplacesDatabaseAtomically();
+    void failedTransferKeepsDatabase_data();
+    void failedTransferKeepsDatabase();
+
+private:
+    QString dbPath() const { return m_dir->path() + "/"; }
+    QString target() const { return m_dir->filePath("sync/core.db"); }
+    // An existing copy as a previous fetch would have left it
+    void seed(const QByteArray& contents, const QByteArray& etag);
+    // Runs one fetch of "core" against the server; returns the finished() arguments
+    QList<QVariant> fetch();
+
+    static QByteArray readFile(const QString& path);
+
+    std::unique_ptr<QTemporaryDir> m_dir;
+    std::unique_ptr<FakeHttpServer> m_server;
+};
+
+static const QDateTime kServerTime = QDateTime::fromSecsSinceEpoch(1735689600).toUTC();
+static const QByteArray kServerTimeHeader = "Wed, 01 Jan 2025 00:00:00 GMT";
+
+void TestSyncDatabaseFetcher::initTestCase()
+{
+    // Whatever proxy the environment names must not see requests meant for the fake server
+    QNetworkProxy::setApplicationProxy(QNetworkProxy::NoProxy);
+}
+
+void TestSyncDatabaseFetcher::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+    m_server = std::make_unique<FakeHttpServer>();
+    QVERIFY(m_server->listen());
+}
+
+void TestSyncDatabaseFetcher::seed(const QByteArray& contents, const QByteArray& etag)
+{
+    QDir().mkpath(m_dir->filePath("sync"));
+    QFile file(target());
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(contents);
+    QVERIFY(file.setFileTime(kServerTime, QFileDevice::FileModificationTime));
+    file.close();
+
+    QFile sidecar(target() + ".etag");
+    QVERIFY(sidecar.open(QIODevice::WriteOnly));
+    sidecar.write(etag);
+}
+
+QList<QVariant> TestSyncDatabaseFetcher::fetch()
+{
+    SyncDatabaseFetcher fetcher;
+    QSignalSpy spy(&fetcher, &SyncDatabaseFetcher::finished);
+    // No system copy to seed from: the test directory's own sync/ is all there is
+    fetcher.fetch(dbPath(), m_dir->filePath("nonexistent/"), {"core"}, {{"core", {m_server->url()}}});
+    if (spy.isEmpty() && !spy.wait(10000)) return {};
+    return spy.takeFirst();
+}
+
+QByteArray TestSyncDatabaseFetcher::readFile(const QString& path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void TestSyncDatabaseFetcher::firstFetchStoresValidators()
+{
+    m_server->response.body = "database v1";
+    m_server->response.headers = {{"ETag", "\"v1\""}, {"Last-Modified", kServerTimeHeader}};
+
+    QList<QVariant> result = fetch();
+    QCOMPARE(result, (QList<QVariant>{true, 1}));
+
+    QCOMPARE(m_server->requests.size(), 1);
+    QVERIFY(m_server->requests[0].startsWith("GET /core/os/x86_64/core.db "));
+    QVERIFY(m_server->header(0, "If-None-Match").isEmpty());
+    QVERIFY(m_server->header(0, "If-Modified-Since").isEmpty());
+
+    QCOMPARE(readFile(target()), QByteArray("database v1"));
+    QCOMPARE(readFile(target() + ".etag"), QByteArray("\"v1\""));
+    QCOMPARE(QFileInfo(target()).lastModified().toUTC(), kServerTime);
+
+    // The stored validators come back on the next request
+    m_server->response = FakeHttpServer::Response();
+    m_server->response.status = 304;
+    QCOMPARE(fetch(), (QList<QVariant>{true, 0}));
+    QCOMPARE(m_server->header(1, "If-None-Match"), QByteArray("\"v1\""));
+    QCOMPARE(m_server->header(1, "If-Modified-Since"), kServerTimeHeader);
+}
+
+void TestSyncDatabaseFetcher::notModifiedKeepsDatabase()
+{
+    seed("database v1", "\"v1\"");
+    m_server->response.status = 304;
+
+    QCOMPARE(fetch(), (QList<QVariant>{true, 0}));
+    QCOMPARE(m_server->header(0, "If-None-Match"), QByteArray("\"v1\""));
+    QCOMPARE(m_server->header(0, "If-Modified-Since"), kServerTimeHeader);
+
+    QCOMPARE(readFile(target()), QByteArray("database v1"));
+    QCOMPARE(readFile(target() + ".etag"), QByteArray("\"v1\""));
+    QCOMPARE(QFileInfo(target()).lastModified().toUTC(), kServerTime);
+}
+
+void TestSyncDatabaseFetcher::okReplacesDatabaseAtomically()
+{
+    seed("database v1", "\"v1\"");
+    QByteArray body(256 * 1024, 'x');
+    m_server->response.body = body;
+    m_server->response.headers = {{"ETag", "\"v2\""}, {"Last-Modified", "Thu, 02 Jan 2025 00:00:00 GMT"}};
+    m_server->response.holdAfter = 4096;
+
+    SyncDatabaseFetcher fetcher;
+    QSignalSpy finished(&fetcher, &SyncDatabaseFetcher::finished);
+    QSignalSpy held(m_server.get(), &FakeHttpServer::held);
+    fetcher.fetch(dbPath(), m_dir->filePath("nonexistent/"), {"core"}, {{"core", {m_server->url()}}});
+
+    // Halfway through the body the old database is still whole
+    QVERIFY(held.wait(10000));
+    QTest::qWait(200);
+    QVERIFY(finished.isEmpty());
+    QCOMPARE(readFile(target()), QByteArray("database v1"));
+
+    m_server->release();
+    QVERIFY(finished.wait(10000));
+    QCOMPARE(finished.takeFirst(), (QList<QVariant>{true, 1}));
+    QCOMPARE(readFile(target()), body);
+    QCOMPARE(readFile(target() + ".etag"), QByteArray("\"v2\""));
+    QCOMPARE(QFileInfo(target()).lastModified().toUTC(), kServerTime.addDays(1));
+
+    // Nothing of the transfer is left next to it
+    QCOMPARE(QDir(m_dir->filePath("sync")).entryList(QDir::Files), (QStringList{"core.db", "core.db.etag"}));
+}
+
+void TestSyncDatabaseFetcher::failedTransferKeepsDatabase_data()
+{
+    QTest::addColumn<int>("status");
+    QTest::addColumn<bool>("truncate");
+
+    QTest::newRow("server error") << 500 << false;
+    QTest::newRow("not found") << 404 << false;
+    QTest::newRow("connection dropped mid-body") << 200 << true;
+}
+
+void TestSyncDatabaseFetcher::failedTransferKeepsDatabase()
+{
+    QFETCH(int, status);
+    QFETCH(bool, truncate);
+
+    seed("database v1", "\"v1\"");
+    m_server->response.status = status;
+    m_server->response.body = QByteArray(64 * 1024, 'x');
+    m_server->response.headers = {{"ETag", "\"v2\""}};
+    m_server->response.truncate = truncate;
+
+    QCOMPARE(fetch(), (QList<QVariant>{false, 0}));
+    QCOMPARE(readFile(target()), QByteArray("database v1"));
+    QCOMPARE(readFile(target() + ".etag"), QByteArray("\"v1\""));
+    QCOMPARE(QFileInfo(target()).lastModified().toUTC(), kServerTime);
+    QCOMPARE(QDir(m_dir->filePath("sync")).entryList(QDir::Files), (QStringList{"core.db", "core.db.etag"}));
+}
+
+QTEST_GUILESS_MAIN(TestSyncDatabaseFetcher)
+#include "tst_syncdbfetcher.moc"
@@ -0,0 +1,126 @@
+#include "vercmp.h"
+#include <QtTest>
+
+class TestVercmp : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void compare_data();
+    void compare();
+};
+
+// The table from pacman's test/util/vercmptest.sh, plus the cases it leaves out. Every row
+// is checked both ways round, as vercmptest.sh does.
+void TestVercmp::compare_data()
+{
+    QTest::addColumn<QString>("a");
+    QTest::addColumn<QString>("b");
+    QTest::addColumn<int>("expected");
+
+    auto row = [](const char* a, const char* b, int expected){
+        QTest::addRow("%s vs %s", a, b) << QString::fromUtf8(a) << QString::fromUtf8(b) << expected;
+    };
+
+    // All similar length, no pkgrel
+    row("1.5.0", "1.5.0", 0);
+    row("1.5.1", "1.5.0", 1);
+
+    // Mixed length
+    row("1.5.1", "1.5", 1);
+
+    // With pkgrel
+    row("1.5.0-1", "1.5.0-1", 0);
+    row("1.5.0-1", "1.5.0-2", -1);
+    row("1.5.0-1", "1.5.1-1", -1);
+    row("1.5.0-2", "1.5.1-1", -1);
+    row("1.5-1", "1.5.1-1", -1);
+    row("1.5-2", "1.5.1-1", -1);
+    row("1.5-2", "1.5.1-2", -1);
+
+    // A pkgrel on one side only is ignored
+    row("1.5", "1.5-1", 0);
+    row("1.5-1", "1.5", 0);
+    row("1.1-1", "1.1", 0);
+    row("1.0-1", "1.1", -1);
+    row("1.1-1", "1.0", 1);
+
+    // An empty pkgrel after the dash is still a pkgrel, as in alpm_pkg_vercmp()
+    row("1.0-", "1.0", 0);
+    row("1.0-", "1.0-", 0);
+    row("1.0-", "1.0-1", -1);
+    row("1.0-", "1.0-a", 1);
+    row("1:1.0-", "1:1.0-0", -1);
+
+    // Alphanumeric versions
+    row("1.5b-1", "1.5-1", -1);
+    row("1.5b", "1.5", -1);
+    row("1.5b-1", "1.5", -1);
+    row("1.5b", "1.5.1", -1);
+
+    // From the vercmp(8) manual
+    row("1.0a", "1.0alpha", -1);
+    row("1.0alpha", "1.0b", -1);
+    row("1.0b", "1.0beta", -1);
+    row("1.0beta", "1.0rc", -1);
+    row("1.0rc", "1.0", -1);
+
+    // Alpha-dotted versions
+    row("1.5.a", "1.5", 1);
+    row("1.5.b", "1.5.a", 1);
+    row("1.5.1", "1.5.b", 1);
+
+    // Alpha dots and dashes
+    row("1.5.b-1", "1.5.b", 0);
+    row("1.5-1", "1.5.b", -1);
+
+    // Same content, differing separators
+    row("2.0", "2_0", 0);
+    row("2.0_a", "2_0.a", 0);
+    row("2.0a", "2.0.a", -1);
+    row("2___a", "2_a", 1);
+
+    // Epochs
+    row("0:1.0", "0:1.0", 0);
+    row("0:1.0", "0:1.1", -1);
+    row("1:1.0", "0:1.0", 1);
+    row("1:1.0", "0:1.1", 1);
+    row("1:1.0", "2:1.1", -1);
+    row("1:1.0", "0:1.0-1", 1);
+    row("1:1.0-1", "0:1.1-1", 1);
+    row("0:1.0", "1.0", 0);
+    row("0:1.0", "1.1", -1);
+    row("0:1.1", "1.0", 1);
+    row("1:1.0", "1.0", 1);
+    row("1:1.0", "1.1", 1);
+    row("1:1.1", "1.1", 1);
+    row(":1.0", "0:1.0", 0);
+
+    // Numeric runs: by value, leading zeros ignored, no overflow on long runs
+    row("1.10", "1.9", 1);
+    row("1.01", "1.1", 0);
+    row("1.99999999999999999999", "1.100000000000000000000", -1);
+
+    // Non-ASCII bytes are separators, each byte counting towards the separator length
+    row("1.0\xc3\xa9" "1", "1.0..1", 0);
+    row("1.0\xc3\xa9" "1", "1.0.1", 1);
+}
+
+void TestVercmp::compare()
+{
+    QFETCH(QString, a);
+    QFETCH(QString, b);
+    QFETCH(int, expected);
+
+    auto sign = [](int value){ return (value > 0) - (value < 0); };
+
+    QCOMPARE(sign(vercmp(a, b)), expected);
+    QCOMPARE(sign(vercmp(b, a)), -expected);
+
+    QByteArray left = a.toUtf8();
+    QByteArray right = b.toUtf8();
+    QCOMPARE(sign(vercmp(std::string_view(left.constData(), left.size()), std::string_view(right.constData(), right.size()))), expected);
+}
+
+QTEST_APPLESS_MAIN(TestVercmp)
+#include "tst_vercmp.moc"
@@ -0,0 +1,50 @@
+#include "updatecalculator.h"
+#include "localdatabase.h"
+#include "vercmp.h"
+#include <QHash>
+#include <QFile>
+#include <algorithm>
+#include <fnmatch.h>
+
+static bool matchesAny(const QString& value, const QStringList& patterns)
+{
+    QByteArray encoded = QFile::encodeName(value);
+    for (const QString& pattern : patterns) {
+        if (fnmatch(QFile::encodeName(pattern).constData(), encoded.constData(), 0) == 0) return true;
+    }
+    return false;
+}
+
+QList<UpdatePackageInfo> UpdateCalculator::compute(const LocalDatabase& local, const QList<QList<SyncPackage>>& syncRepos,
+                                                   const QStringList& ignorePackages, const QStringList& ignoreGroups)
+{
+    // A name resolves to the first repo that has it, as with pacman
+    QHash<QString, const SyncPackage*> candidates;
+    for (const QList<SyncPackage>& repo : syncRepos) {
+        for (const SyncPackage& pkg : repo) {
+            if (!candidates.contains(pkg.name)) candidates.insert(pkg.name, &pkg);
+        }
+    }
+
+    QList<UpdatePackageInfo> updates;
+    for (const LocalPackage& installed : local.packages()) {
+        const SyncPackage* available = candidates.value(installed.name);
+        if (!available || vercmp(available->version, installed.version) <= 0) continue;
+
+        UpdatePackageInfo info;
+        info.name = installed.name;
+        info.oldVersion = installed.version;
+        info.newVersion = available->version;
+        info.repo = available->repo;
+        info.downloadSize = available->downloadSize;
+        info.installedSizeDelta = available->installedSize - installed.installedSize;
+
+        // IgnoreGroup applies to the groups of either side of the upgrade
+        bool ignoredGroup = std::any_of(available->groups.cbegin(), available->groups.cend(), [&ignoreGroups](const QString& group){ return matchesAny(group, ignoreGroups); })
+                         || std::any_of(installed.groups.cbegin(), installed.groups.cend(), [&ignoreGroups](const QString& group){ return matchesAny(group, ignoreGroups); });
+        info.ignored = matchesAny(installed.name, ignorePackages) || ignoredGroup;
+
+        updates.append(info);
+    }
+    return updates;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include "dashboardwidget.h"
+#include "syncdatabase.h"
+
+class LocalDatabase;
+
+// What pacman -Qu reports, computed from parsed databases: every installed package
+// whose first sync repo carries a newer version.
+class UpdateCalculator
+{
+public:
+    // syncRepos in pacman.conf order; ignorePackages/ignoreGroups may hold globs, as in pacman.conf
+    static QList<UpdatePackageInfo> compute(const LocalDatabase& local, const QList<QList<SyncPackage>>& syncRepos,
+                                            const QStringList& ignorePackages, const QStringList& ignoreGroups);
+};
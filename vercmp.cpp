@@ -0,0 +1,135 @@
+#include "vercmp.h"
+#include <QString>
+#include <QStringEncoder>
+#include <QVarLengthArray>
+
+namespace {
+
+// Locale-independent, like rpmvercmp under the C locale: bytes >= 0x80 are separators
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool isAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+inline bool isAlnum(char c) { return isDigit(c) || isAlpha(c); }
+
+// libalpm's rpmvercmp() over one component (epoch, pkgver or pkgrel)
+int compareSegments(std::string_view a, std::string_view b)
+{
+    if (a == b) return 0;
+
+    size_t one = 0, two = 0;
+    size_t end1 = 0, end2 = 0;
+
+    while (one < a.size() && two < b.size()) {
+        while (one < a.size() && !isAlnum(a[one])) ++one;
+        while (two < b.size() && !isAlnum(b[two])) ++two;
+        if (one == a.size() || two == b.size()) break;
+
+        // Differently long separators decide the comparison on their own
+        if (one - end1 != two - end2) return (one - end1) < (two - end2) ? -1 : 1;
+
+        end1 = one;
+        end2 = two;
+        bool isNumber = isDigit(a[end1]);
+        if (isNumber) {
+            while (end1 < a.size() && isDigit(a[end1])) ++end1;
+            while (end2 < b.size() && isDigit(b[end2])) ++end2;
+        } else {
+            while (end1 < a.size() && isAlpha(a[end1])) ++end1;
+            while (end2 < b.size() && isAlpha(b[end2])) ++end2;
+        }
+
+        // b has a run of the other kind here: a number always beats letters
+        if (two == end2) return isNumber ? 1 : -1;
+
+        std::string_view run1 = a.substr(one, end1 - one);
+        std::string_view run2 = b.substr(two, end2 - two);
+        if (isNumber) {
+            // Numerically, without overflow: drop leading zeros, then longer is bigger
+            while (!run1.empty() && run1.front() == '0') run1.remove_prefix(1);
+            while (!run2.empty() && run2.front() == '0') run2.remove_prefix(1);
+            if (run1.size() != run2.size()) return run1.size() > run2.size() ? 1 : -1;
+        }
+        int rc = run1.compare(run2);
+        if (rc != 0) return rc < 0 ? -1 : 1;
+
+        one = end1;
+        two = end2;
+    }
+
+    bool aDone = one >= a.size();
+    bool bDone = two >= b.size();
+    if (aDone && bDone) return 0;
+
+    // A leftover letter run loses even to nothing ("1.0a" < "1.0"); anything else wins
+    if ((aDone && !isAlpha(b[two])) || (!aDone && isAlpha(a[one]))) return -1;
+    return 1;
+}
+
+struct Evr {
+    std::string_view epoch;
+    std::string_view version;
+    std::string_view release;
+    // "1.0-" has a release, an empty one; "1.0" has none
+    bool hasRelease = false;
+};
+
+// Same split as libalpm's parseEVR(): epoch only if all digits before ':', release after the last '-'
+Evr splitEvr(std::string_view full)
+{
+    Evr evr;
+    size_t digits = 0;
+    while (digits < full.size() && isDigit(full[digits])) ++digits;
+
+    if (digits < full.size() && full[digits] == ':') {
+        evr.epoch = digits > 0 ? full.substr(0, digits) : std::string_view("0");
+        full.remove_prefix(digits + 1);
+    } else {
+        evr.epoch = "0";
+    }
+
+    size_t dash = full.rfind('-');
+    if (dash != std::string_view::npos) {
+        evr.version = full.substr(0, dash);
+        evr.release = full.substr(dash + 1);
+        evr.hasRelease = true;
+    } else {
+        evr.version = full;
+    }
+    return evr;
+}
+
+using Utf8Buffer = QVarLengthArray<char, 256>;
+
+void encodeUtf8(const QString& text, Utf8Buffer& out)
+{
+    QStringEncoder encoder(QStringConverter::Utf8);
+    out.resize(encoder.requiredSpace(text.size()));
+    char* end = encoder.appendToBuffer(out.data(), text);
+    out.resize(end - out.constData());
+}
+
+} // namespace
+
+int vercmp(std::string_view a, std::string_view b)
+{
+    if (a == b) return 0;
+
+    Evr left = splitEvr(a);
+    Evr right = splitEvr(b);
+
+    int result = compareSegments(left.epoch, right.epoch);
+    if (result == 0) {
+        result = compareSegments(left.version, right.version);
+        // A missing pkgrel matches any pkgrel, as it does for pacman. An empty one after a
+        // dash is still compared, so "1.0-" sorts before "1.0-1" like alpm_pkg_vercmp()
+        if (result == 0 && left.hasRelease && right.hasRelease) result = compareSegments(left.release, right.release);
+    }
+    return result;
+}
+
+int vercmp(const QString& a, const QString& b)
+{
+    Utf8Buffer left, right;
+    encodeUtf8(a, left);
+    encodeUtf8(b, right);
+    return vercmp(std::string_view(left.constData(), left.size()), std::string_view(right.constData(), right.size()));
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string_view>
+
+class QString;
+
+// pacman's vercmp(8) semantics: [epoch:]pkgver[-pkgrel], where pkgver and pkgrel are
+// compared run by run (digits numerically, letters bytewise, a number beats letters,
+// a trailing letter run loses to nothing). Returns <0, 0 or >0 as a is older than,
+// equal to or newer than b.
+
+// Works on the raw UTF-8 bytes and never allocates
+int vercmp(std::string_view a, std::string_view b);
+
+// Encodes to UTF-8 on the stack first; only versions over 256 bytes touch the heap
+int vercmp(const QString& a, const QString& b);